@@ -0,0 +1,73 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "arena.h"
+
+namespace badgerdb {
+
+Arena::Arena(const std::size_t chunkSize)
+    : chunkSize(chunkSize),
+      current(0),
+      offset(0),
+      bytesAllocated(0),
+      bytesReserved(0) {
+  // nothing
+}
+
+Arena::~Arena() {
+  release();
+}
+
+void* Arena::allocate(const std::size_t bytes, const std::size_t alignment) {
+  // try the current chunk first, then any recycled chunk after it
+  while (current < chunks.size()) {
+    const Chunk& chunk = chunks[current];
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunk.data);
+    const std::size_t aligned =
+        ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+    if (aligned + bytes <= chunk.size) {
+      offset = aligned + bytes;
+      bytesAllocated += bytes;
+      return chunk.data + aligned;
+    }
+    ++current;
+    offset = 0;
+  }
+
+  // no room left, so get a new chunk (oversized requests get their own)
+  Chunk chunk;
+  chunk.size = bytes + alignment > chunkSize ? bytes + alignment : chunkSize;
+  chunk.data = new char[chunk.size];
+  chunks.push_back(chunk);
+  bytesReserved += chunk.size;
+  current = chunks.size() - 1;
+  offset = 0;
+  return allocate(bytes, alignment);
+}
+
+const char* Arena::copy(const char* data, const std::size_t length) {
+  char* dest = static_cast<char*>(allocate(length, 1));
+  std::memcpy(dest, data, length);
+  return dest;
+}
+
+void Arena::reset() {
+  current = 0;
+  offset = 0;
+  bytesAllocated = 0;
+}
+
+void Arena::release() {
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    delete[] chunks[i].data;
+  }
+  chunks.clear();
+  bytesReserved = 0;
+  reset();
+}
+
+}  // namespace badgerdb
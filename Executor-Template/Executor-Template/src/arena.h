@@ -0,0 +1,211 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Bump allocator for the temporary data of one operator.
+ *
+ * Memory is carved sequentially out of large chunks.  Individual allocations
+ * are never freed; instead the whole arena is reset in one call, after which
+ * its chunks are reused for the next allocations.
+ *
+ * @warning This class is not threadsafe.
+ */
+class Arena {
+ public:
+  /**
+   * Default size of a chunk in bytes.
+   */
+  static const std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  /**
+   * Constructs an empty arena.  No memory is reserved until the first
+   * allocation.
+   *
+   * @param chunkSize  Size of the chunks requested from the system.
+   */
+  explicit Arena(const std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+  /**
+   * Destructor that returns all chunks to the system.
+   */
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * Allocates uninitialized memory.
+   *
+   * @param bytes      Number of bytes to allocate.
+   * @param alignment  Required alignment, a power of two.
+   * @return  Pointer to the memory, valid until the next reset() or release().
+   */
+  void* allocate(const std::size_t bytes,
+                 const std::size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * Copies the given bytes into the arena.
+   *
+   * @param data    Bytes to copy.
+   * @param length  Number of bytes.
+   * @return  Pointer to the copy.
+   */
+  const char* copy(const char* data, const std::size_t length);
+
+  /**
+   * Frees every allocation at once.  Chunks are kept for reuse.
+   */
+  void reset();
+
+  /**
+   * Frees every allocation and returns all chunks to the system.
+   */
+  void release();
+
+  /**
+   * Returns the number of bytes handed out since the last reset.
+   */
+  std::size_t getBytesAllocated() const { return bytesAllocated; }
+
+  /**
+   * Returns the number of bytes held in chunks.
+   */
+  std::size_t getBytesReserved() const { return bytesReserved; }
+
+ private:
+  /**
+   * Chunk of memory obtained from the system.
+   */
+  struct Chunk {
+    char* data;
+    std::size_t size;
+  };
+
+  /**
+   * Size of regular chunks.
+   */
+  std::size_t chunkSize;
+
+  /**
+   * All chunks owned by the arena, in allocation order.
+   */
+  std::vector<Chunk> chunks;
+
+  /**
+   * Index of the chunk currently allocated from.
+   */
+  std::size_t current;
+
+  /**
+   * Offset of the first free byte in the current chunk.
+   */
+  std::size_t offset;
+
+  /**
+   * Bytes handed out since the last reset.
+   */
+  std::size_t bytesAllocated;
+
+  /**
+   * Bytes held in chunks.
+   */
+  std::size_t bytesReserved;
+};
+
+/**
+ * @brief Standard allocator drawing from an Arena, so that node-based
+ * containers can place their nodes in the arena.  Deallocation is a no-op;
+ * the memory is reclaimed when the arena is reset.
+ */
+template <class T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  /**
+   * Arena from which memory is drawn
+   */
+  Arena* arena;
+
+  explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, std::size_t) {
+    // memory is reclaimed by Arena::reset()
+  }
+
+  template <class U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& rhs) const {
+    return arena == rhs.arena;
+  }
+
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& rhs) const {
+    return arena != rhs.arena;
+  }
+};
+
+/**
+ * @brief Non-owning reference to a byte string, typically stored in an Arena.
+ */
+struct ArenaSlice {
+  /**
+   * First byte of the string
+   */
+  const char* data;
+
+  /**
+   * Number of bytes
+   */
+  std::uint32_t length;
+
+  ArenaSlice() : data(NULL), length(0) {}
+
+  ArenaSlice(const char* data, const std::size_t length)
+      : data(data), length(static_cast<std::uint32_t>(length)) {}
+
+  /**
+   * Returns a copy of the bytes as a string
+   */
+  std::string str() const { return std::string(data, length); }
+
+  /**
+   * Orders slices bytewise, like std::string
+   */
+  bool operator<(const ArenaSlice& rhs) const {
+    const int cmp = std::memcmp(data, rhs.data,
+                                length < rhs.length ? length : rhs.length);
+    return cmp < 0 || (cmp == 0 && length < rhs.length);
+  }
+
+  bool operator==(const ArenaSlice& rhs) const {
+    return length == rhs.length && std::memcmp(data, rhs.data, length) == 0;
+  }
+};
+
+}  // namespace badgerdb
@@ -18,6 +18,8 @@
 
 #include <memory>
 #include <iostream>
+#include <sstream>
+#include <cstring>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
@@ -27,9 +29,10 @@
 
 namespace badgerdb {
 
+thread_local std::string BufMgr::pinOwner;
 
 BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
+	: numBufs(bufs), logManager(NULL), trackPins(false) {
 	bufDescTable = new BufDesc[bufs];
 
     for (FrameId i = 0; i < bufs; i++)
@@ -48,12 +51,23 @@ BufMgr::BufMgr(std::uint32_t bufs)
 
 //更新脏页 
 BufMgr::~BufMgr() {
+    //报告未释放的pin 
+    if(trackPins){
+        std::string leaks = reportPins(NULL);
+        if(!leaks.empty()){
+            std::cerr << "BufMgr destroyed with pinned pages:\n" << leaks;
+        }
+    }
 	//若对应页框为dirty， 
     for(unsigned int i = 0; i < numBufs; i++){
         if(bufDescTable[i].dirty == true){
             flushFile(bufDescTable[i].file);
         }
     }
+    //关闭缓冲池持有的文件句柄 
+    for(std::map<std::string, File*>::iterator it = files.begin(); it != files.end(); ++it){
+        delete it->second;
+    }
     delete [] bufDescTable;
     delete [] bufPool;
     delete hashTable;
@@ -67,7 +81,7 @@ void BufMgr::advanceClock()
 
 
 //分配页框 
-void BufMgr::allocBuf(FrameId & frame)
+void BufMgr::allocBuf(FrameId & frame, std::unique_lock<std::mutex>& lock)
 {
 	/*
     思路:
@@ -119,10 +133,15 @@ void BufMgr::allocBuf(FrameId & frame)
             pinned++;
         }
 
+        /*
+        脏页：在池锁外写回后重新扫描，写回期间页框状态可能已变化 
+        */ 
+        else if(bufDescTable[clockHand].dirty == true){
+            cleanFrame(clockHand, lock);
+            pinned = 0;
+        }
+
         else if(bufDescTable[clockHand].refbit == false){
-            if(bufDescTable[clockHand].dirty == true){
-                bufDescTable[clockHand].file->writePage(bufPool[clockHand]);
-            }
             hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
             bufDescTable[clockHand].Clear();
             frame = clockHand;
@@ -134,34 +153,118 @@ void BufMgr::allocBuf(FrameId & frame)
 //将文件从磁盘读入缓冲区 
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  std::unique_lock<std::mutex> lock(mutex);
+  file = registerFile(file);
   FrameId frame;
-    try{
-        hashTable->lookup(file, pageNo, frame);
-        //case1：文件在缓冲池 
+  for(;;){
+    if(findFrame(file, pageNo, frame)){
+        //case1：文件在缓冲池，正在读写盘时等待完成 
+        if(bufDescTable[frame].ioInProgress){
+            ioDone.wait(lock);
+            continue;
+        }
         bufDescTable[frame].refbit = true;
         bufDescTable[frame].pinCnt++;
+        recordPin(frame);
         page = &bufPool[frame];
-
-    }catch(HashNotFoundException e){
-    	//case2：文件不在缓冲池 
-        FrameId frame;
-        allocBuf(frame);
-        //printf("This is frame#: %id\n", frame);
+        return;
+    }
+    //case2：文件不在缓冲池，pin住新页框后在池锁外读盘 
+    allocBuf(frame, lock);
+    //分配页框时可能释放过池锁，其他线程或已读入该页，分到的页框仍空闲 
+    FrameId loaded;
+    if(findFrame(file, pageNo, loaded)){
+        continue;
+    }
+    hashTable->insert(file, pageNo, frame);
+    bufDescTable[frame].Set(file, pageNo);
+    bufDescTable[frame].ioInProgress = true;
+    recordPin(frame);
+    lock.unlock();
+    try{
         bufPool[frame] = file->readPage(pageNo);
-        hashTable->insert(file, pageNo, frame);
-        bufDescTable[frame].Set(file, pageNo);
-        page = &bufPool[frame];
+    }catch(...){
+        lock.lock();
+        hashTable->remove(file, pageNo);
+        bufDescTable[frame].Clear();
+        ioDone.notify_all();
+        throw;
+    }
+    lock.lock();
+    bufDescTable[frame].ioInProgress = false;
+    ioDone.notify_all();
+    page = &bufPool[frame];
+    return;
+  }
+}
+
+//查找页所在页框 
+bool BufMgr::findFrame(File* file, const PageId pageNo, FrameId& frame)
+{
+    try{
+        hashTable->lookup(file, pageNo, frame);
+        return true;
+    }catch(HashNotFoundException& e){
+        return false;
     }
 }
 
+//分配新页并由PageGuard持有pin 
+PageGuard BufMgr::fetchNew(File* file, const LatchMode mode)
+{
+    PageId pageNo;
+    Page* page;
+    allocPage(file, pageNo, page);
+    return latchPage(file, pageNo, page, mode);
+}
+
+//读入页并由PageGuard持有pin 
+PageGuard BufMgr::fetch(File* file, const PageId pageNo, const LatchMode mode)
+{
+    Page* page;
+    readPage(file, pageNo, page);
+    return latchPage(file, pageNo, page, mode);
+}
+
+//读入页并尝试独占latch，latch被占用时返回空PageGuard 
+PageGuard BufMgr::tryFetchExclusive(File* file, const PageId pageNo)
+{
+    Page* page;
+    readPage(file, pageNo, page);
+    RWLatch* latch = &bufDescTable[page - bufPool].latch;
+    if(!latch->tryLockExclusive()){
+        unPinPage(file, pageNo, false);
+        return PageGuard();
+    }
+    return PageGuard(this, file, pageNo, page, latch, LATCH_EXCLUSIVE);
+}
+
+//在池锁外获取页框latch，页已pin，不会被替换 
+PageGuard BufMgr::latchPage(File* file, const PageId pageNo, Page* page, const LatchMode mode)
+{
+    RWLatch* latch = &bufDescTable[page - bufPool].latch;
+    if(mode == LATCH_SHARED){
+        latch->lockShared();
+    }else if(mode == LATCH_EXCLUSIVE){
+        latch->lockExclusive();
+    }
+    return PageGuard(this, file, pageNo, page, latch, mode);
+}
+
 //释放引用 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 {
   FrameId frame;
+    std::lock_guard<std::mutex> lock(mutex);
+    file = findFile(file);
+    if(file == NULL){
+        return;
+    }
     try{
         hashTable->lookup(file, pageNo, frame);
         if(bufDescTable[frame].pinCnt > 0){
             bufDescTable[frame].pinCnt--;
+            releasePin(frame);
             if (dirty == true){
                 bufDescTable[frame].dirty = dirty;
             }
@@ -176,40 +279,185 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 
 
 //将缓冲池内容更新到file，清除缓冲池 
-void BufMgr::flushFile(const File* file)
+void BufMgr::flushFile(const File* caller)
 {
-    for(unsigned int i = 0; i < numBufs; i++){
-        if(bufDescTable[i].file == file){
-            if(bufDescTable[i].pinCnt != 0){
-                throw PagePinnedException("This removing page is already being used", bufDescTable[i].pageNo, bufDescTable[i].frameNo);
-            }
-            if(bufDescTable[i].valid == false){
-                throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, false, bufDescTable[i].refbit);
+    std::unique_lock<std::mutex> lock(mutex);
+    File* file = findFile(caller);
+    if(file == NULL){
+        return;
+    }
+    //逐页写回，写盘时释放池锁，写完后从头重新检查 
+    unsigned int i = 0;
+    while(i < numBufs){
+        if(bufDescTable[i].file != file){
+            i++;
+            continue;
+        }
+        if(bufDescTable[i].ioInProgress){
+            ioDone.wait(lock);
+            i = 0;
+            continue;
+        }
+        if(bufDescTable[i].pinCnt != 0){
+            if(trackPins){
+                std::cerr << "flushFile found pinned pages:\n" << reportPinsLocked(file);
             }
-            if(bufDescTable[i].dirty == true){
-                bufDescTable[i].file->writePage(bufPool[i]);
-                bufDescTable[i].dirty = false;
+            throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
+        }
+        if(bufDescTable[i].valid == false){
+            throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, false, bufDescTable[i].refbit);
+        }
+        if(bufDescTable[i].dirty == true){
+            cleanFrame(i, lock);
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    for(i = 0; i < numBufs; i++){
+        if(bufDescTable[i].file == file){
+            hashTable->remove(file, bufPool[i].page_number());
+            bufDescTable[i].Clear();
+        }
+    }
+    //文件已无缓冲页，关闭句柄 
+    files.erase(file->filename());
+    delete file;
+}
+
+//丢弃文件的所有缓冲页，脏页不写回（用于即将删除的临时文件） 
+void BufMgr::discardFile(const File* caller)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    File* file = findFile(caller);
+    if(file == NULL){
+        return;
+    }
+    //等待该文件页框上进行中的写回完成 
+    for(unsigned int i = 0; i < numBufs; ){
+        if(bufDescTable[i].file == file && bufDescTable[i].ioInProgress){
+            ioDone.wait(lock);
+            i = 0;
+        }else{
+            i++;
+        }
+    }
+    for(unsigned int i = 0; i < numBufs; i++){
+        if(bufDescTable[i].file == file && bufDescTable[i].pinCnt != 0){
+            if(trackPins){
+                std::cerr << "discardFile found pinned pages:\n" << reportPinsLocked(file);
             }
+            throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
+        }
+    }
+    for(unsigned int i = 0; i < numBufs; i++){
+        if(bufDescTable[i].file == file){
             hashTable->remove(file, bufPool[i].page_number());
             bufDescTable[i].Clear();
         }
     }
+    unloggedFiles.erase(file->filename());
+    files.erase(file->filename());
+    delete file;
+}
+
+//写回单个脏页，不清除缓冲，其他线程可继续使用该页 
+void BufMgr::flushPage(File* file, const PageId pageNo)
+{
+    FrameId frame;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        File* owned = findFile(file);
+        if(owned == NULL){
+            return;
+        }
+        try{
+            hashTable->lookup(owned, pageNo, frame);
+        }catch(HashNotFoundException& e){
+            return;
+        }
+        if(bufDescTable[frame].dirty == false){
+            return;
+        }
+        //pin住页框，防止写回期间被替换 
+        bufDescTable[frame].pinCnt++;
+        recordPin(frame);
+    }
+    //共享latch保证写回的不是修改到一半的页，写盘时不持有池锁 
+    bufDescTable[frame].latch.lockShared();
+    bool dirty;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty = bufDescTable[frame].dirty;
+    }
+    if(dirty){
+        try{
+            writeFrame(frame);
+        }catch(...){
+            bufDescTable[frame].latch.unlockShared();
+            unPinPage(file, pageNo, false);
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        bufDescTable[frame].dirty = false;
+        bufDescTable[frame].logged = false;
+    }
+    bufDescTable[frame].latch.unlockShared();
+    unPinPage(file, pageNo, false);
 }
 
 //获取文件的页号和页信息 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 {
     FrameId frame;
-    Page new_page = file->allocatePage();
-    allocBuf(frame);
-    //更新hashtable 
-    hashTable->insert(file,new_page.page_number(), frame);
-    //更新页框信息 
-	bufDescTable[frame].Set(file, new_page.page_number());
-    //获得page信息和frame信息 
+    std::unique_lock<std::mutex> lock(mutex);
+    file = registerFile(file);
+    allocBuf(frame, lock);
+    //先pin住页框，在池锁外分配磁盘页 
+    bufDescTable[frame].Set(file, Page::INVALID_NUMBER);
+    bufDescTable[frame].ioInProgress = true;
+    recordPin(frame);
+    lock.unlock();
+    Page new_page;
+    try{
+        new_page = file->allocatePage();
+    }catch(...){
+        lock.lock();
+        bufDescTable[frame].Clear();
+        ioDone.notify_all();
+        throw;
+    }
+    lock.lock();
 	pageNo = new_page.page_number();
-    bufPool[frame] = new_page; 
+    FrameId loaded;
+    while(findFrame(file, pageNo, loaded) && bufDescTable[loaded].ioInProgress){
+        ioDone.wait(lock);
+    }
+    if(findFrame(file, pageNo, loaded)){
+        //其他线程已从磁盘读入这个新页，改用其页框 
+        bufDescTable[frame].Clear();
+        bufDescTable[loaded].refbit = true;
+        bufDescTable[loaded].pinCnt++;
+        recordPin(loaded);
+        frame = loaded;
+    }else{
+        //更新hashtable和页框信息 
+        hashTable->insert(file, pageNo, frame);
+        bufDescTable[frame].pageNo = pageNo;
+        bufDescTable[frame].ioInProgress = false;
+        bufPool[frame] = new_page;
+    }
+    ioDone.notify_all();
     page = &bufPool[frame];
+    //记录日志，页LSN需随页写回 
+    if(isLoggedLocked(file)){
+        if(!bufDescTable[frame].logged){
+            bufDescTable[frame].recLsn = logManager->getEndLsn();
+            bufDescTable[frame].logged = true;
+        }
+        page->set_lsn(logManager->append(LOG_ALLOC_PAGE, file->filename(), pageNo, 0, ""));
+        bufDescTable[frame].dirty = true;
+    }
 }
 
 //删除文件中的页 
@@ -219,18 +467,320 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 void BufMgr::disposePage(File* file, const PageId PageNo)
 {
     FrameId frame;
+    //释放页前日志须已持久化（WAL规则） 
+    const Lsn lsn = logChange(file, PageNo, NULL, LOG_DISPOSE_PAGE, 0, "");
+    if(lsn != 0){
+        logManager->flush(lsn);
+    }
+    {
+        //先从缓冲池移除，再在池锁外释放磁盘页 
+        std::unique_lock<std::mutex> lock(mutex);
+        File* owned = findFile(file);
+        if(owned != NULL){
+            while(findFrame(owned, PageNo, frame) && bufDescTable[frame].ioInProgress){
+                ioDone.wait(lock);
+            }
+            if(findFrame(owned, PageNo, frame)){
+                bufDescTable[frame].Clear();
+                hashTable->remove(owned, PageNo);
+            }
+        }
+    }
+    file->deletePage(PageNo);
+}
+
+//按物理顺序重连页链表，先写日志并持久化，崩溃后恢复时重做 
+int BufMgr::sortPageLists(File* file)
+{
+    Lsn lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(isLoggedLocked(file)){
+            //重连期间检查点须从该日志记录开始恢复 
+            relinking[file->filename()] = logManager->getEndLsn();
+            lsn = logManager->append(LOG_RELINK_PAGES, file->filename(), Page::INVALID_NUMBER, 0, "");
+        }
+    }
+    int num_written;
     try{
-        hashTable->lookup(file, PageNo, frame);
-        bufDescTable[frame].Clear();
-        file->deletePage(PageNo);
-        hashTable->remove(file, PageNo);
-    }catch(HashNotFoundException e){
-        file->deletePage(PageNo);
+        if(lsn != 0){
+            logManager->flush(lsn);
+        }
+        num_written = file->sortPageLists();
+    }catch(...){
+        std::lock_guard<std::mutex> lock(mutex);
+        relinking.erase(file->filename());
+        throw;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    relinking.erase(file->filename());
+    return num_written;
+}
+
+//开启/关闭pin追踪 
+void BufMgr::setPinTracking(const bool enable)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    trackPins = enable;
+    if(!enable){
+        for(unsigned int i = 0; i < numBufs; i++){
+            bufDescTable[i].pinOwners.clear();
+        }
+    }
+}
+
+//记录pin的持有者 
+void BufMgr::recordPin(FrameId frame)
+{
+    if(trackPins){
+        bufDescTable[frame].pinOwners.push_back(pinOwner.empty() ? "<unknown>" : pinOwner);
+    }
+}
+
+//释放一个pin的持有者记录，优先匹配当前持有者 
+void BufMgr::releasePin(FrameId frame)
+{
+    std::vector<std::string>& owners = bufDescTable[frame].pinOwners;
+    if(owners.empty()){
+        return;
+    }
+    for(std::vector<std::string>::reverse_iterator it = owners.rbegin(); it != owners.rend(); ++it){
+        if(*it == pinOwner){
+            owners.erase(--(it.base()));
+            return;
+        }
+    }
+    owners.pop_back();
+}
+
+//列出仍被pin的页 
+std::string BufMgr::reportPins(const File* file) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return reportPinsLocked(file);
+}
+
+std::string BufMgr::reportPinsLocked(const File* file) const
+{
+    std::stringstream ss;
+    for(unsigned int i = 0; i < numBufs; i++){
+        const BufDesc& desc = bufDescTable[i];
+        if(!desc.valid || desc.pinCnt == 0){
+            continue;
+        }
+        if(file != NULL && desc.file->filename() != file->filename()){
+            continue;
+        }
+        ss << "  file:" << desc.file->filename() << " pageNo:" << desc.pageNo
+           << " frameNo:" << desc.frameNo << " pinCnt:" << desc.pinCnt;
+        if(!desc.pinOwners.empty()){
+            ss << " owners:";
+            for(unsigned int j = 0; j < desc.pinOwners.size(); j++){
+                ss << (j == 0 ? "" : ",") << desc.pinOwners[j];
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+//按文件统计页框占用 
+std::map<std::string, FrameUsage> BufMgr::getFrameUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, FrameUsage> usage;
+    for(unsigned int i = 0; i < numBufs; i++){
+        const BufDesc& desc = bufDescTable[i];
+        if(!desc.valid){
+            continue;
+        }
+        FrameUsage& fileUsage = usage[desc.file->filename()];
+        fileUsage.frames++;
+        if(desc.pinCnt > 0){
+            fileUsage.pinned++;
+        }
+        if(desc.dirty){
+            fileUsage.dirty++;
+        }
+    }
+    return usage;
+}
+
+//获取缓冲池持有的文件句柄，不存在则创建 
+File* BufMgr::registerFile(const File* file)
+{
+    std::map<std::string, File*>::iterator it = files.find(file->filename());
+    if(it != files.end()){
+        return it->second;
+    }
+    File* owned = new File(*file);
+    files[file->filename()] = owned;
+    return owned;
+}
+
+//查找缓冲池持有的文件句柄 
+File* BufMgr::findFile(const File* file) const
+{
+    std::map<std::string, File*>::const_iterator it = files.find(file->filename());
+    return it == files.end() ? NULL : it->second;
+}
+
+//写回页框，先保证日志已持久化到页LSN（WAL规则），调用时不持有池锁 
+void BufMgr::writeFrame(FrameId frame)
+{
+    if(logManager != NULL){
+        logManager->flush(bufPool[frame].lsn());
     }
+    bufDescTable[frame].file->writePage(bufPool[frame]);
+}
+
+//写回未被pin的脏页框：pin住并标记I/O进行中，释放池锁写盘后再标记为干净 
+void BufMgr::cleanFrame(FrameId frame, std::unique_lock<std::mutex>& lock)
+{
+    BufDesc& desc = bufDescTable[frame];
+    desc.pinCnt++;
+    desc.ioInProgress = true;
+    lock.unlock();
+    try{
+        writeFrame(frame);
+    }catch(...){
+        lock.lock();
+        desc.pinCnt--;
+        desc.ioInProgress = false;
+        ioDone.notify_all();
+        throw;
+    }
+    lock.lock();
+    desc.pinCnt--;
+    desc.ioInProgress = false;
+    desc.dirty = false;
+    desc.logged = false;
+    ioDone.notify_all();
+}
+
+//文件是否记录日志 
+bool BufMgr::isLogged(const File* file) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return isLoggedLocked(file);
+}
+
+bool BufMgr::isLoggedLocked(const File* file) const
+{
+    return logManager != NULL && unloggedFiles.count(file->filename()) == 0;
+}
+
+//文件不记录日志（临时文件） 
+void BufMgr::setUnlogged(const File* file)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unloggedFiles.insert(file->filename());
+}
+
+//记录页修改日志并更新页LSN 
+Lsn BufMgr::logChange(File* file, const PageId pageNo, Page* page,
+                      const LogRecordType type, const SlotId slotNo,
+                      const std::string& data)
+{
+    //页首次被修改时记录recLsn，须在追加日志前设置，检查点才不会漏掉该修改 
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!isLoggedLocked(file)){
+            return 0;
+        }
+        if(page != NULL){
+            BufDesc& desc = bufDescTable[page - bufPool];
+            if(!desc.logged){
+                desc.recLsn = logManager->getEndLsn();
+                desc.logged = true;
+            }
+        }
+    }
+    Lsn lsn = logManager->append(type, file->filename(), pageNo, slotNo, data);
+    if(page != NULL){
+        page->set_lsn(lsn);
+    }
+    return lsn;
+}
+
+//脏页表：有未写回日志修改的页及其recLsn 
+std::vector<DirtyPage> BufMgr::getDirtyPages() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<DirtyPage> dirtyPages;
+    for(unsigned int i = 0; i < numBufs; i++){
+        const BufDesc& desc = bufDescTable[i];
+        if(!desc.valid || !desc.logged){
+            continue;
+        }
+        DirtyPage dirtyPage;
+        dirtyPage.filename = desc.file->filename();
+        dirtyPage.pageNo = desc.pageNo;
+        dirtyPage.recLsn = desc.recLsn;
+        dirtyPages.push_back(dirtyPage);
+    }
+    for(std::map<std::string, Lsn>::const_iterator it = relinking.begin(); it != relinking.end(); ++it){
+        DirtyPage dirtyPage;
+        dirtyPage.filename = it->first;
+        dirtyPage.pageNo = Page::INVALID_NUMBER;
+        dirtyPage.recLsn = it->second;
+        dirtyPages.push_back(dirtyPage);
+    }
+    return dirtyPages;
+}
+
+PageGuard::~PageGuard()
+{
+    try{
+        release();
+    }catch(const std::exception& e){
+        std::cerr << "PageGuard could not release page " << pageNo << ": " << e.what() << std::endl;
+    }
+}
+
+//通过PageGuard修改记录并写日志 
+RecordId PageGuard::insertRecord(const std::string& record_data)
+{
+    RecordId rid = write().insertRecord(record_data);
+    bufMgr->logChange(file, pageNo, page, LOG_INSERT, rid.slot_number, record_data);
+    return rid;
+}
+
+RecordId PageGuard::insertMovedRecord(const std::string& record_data, const RecordId& home)
+{
+    RecordId rid = write().insertMovedRecord(record_data, home);
+    std::string data(sizeof(home.page_number) + sizeof(home.slot_number), '\0');
+    std::memcpy(&data[0], &home.page_number, sizeof(home.page_number));
+    std::memcpy(&data[sizeof(home.page_number)], &home.slot_number, sizeof(home.slot_number));
+    bufMgr->logChange(file, pageNo, page, LOG_INSERT_MOVED, rid.slot_number, data + record_data);
+    return rid;
+}
+
+void PageGuard::updateRecord(const RecordId& record_id, const std::string& record_data)
+{
+    write().updateRecord(record_id, record_data);
+    bufMgr->logChange(file, pageNo, page, LOG_UPDATE, record_id.slot_number, record_data);
+}
+
+void PageGuard::deleteRecord(const RecordId& record_id)
+{
+    write().deleteRecord(record_id);
+    bufMgr->logChange(file, pageNo, page, LOG_DELETE, record_id.slot_number, "");
+}
+
+void PageGuard::forwardRecord(const RecordId& record_id, const RecordId& new_location)
+{
+    write().forwardRecord(record_id, new_location);
+    std::string stub(sizeof(new_location.page_number) + sizeof(new_location.slot_number), '\0');
+    std::memcpy(&stub[0], &new_location.page_number, sizeof(new_location.page_number));
+    std::memcpy(&stub[sizeof(new_location.page_number)], &new_location.slot_number,
+                sizeof(new_location.slot_number));
+    bufMgr->logChange(file, pageNo, page, LOG_FORWARD, record_id.slot_number, stub);
 }
 
 void BufMgr::printSelf(void)
 {
+  std::lock_guard<std::mutex> lock(mutex);
   BufDesc* tmpbuf;
 	int validFrames = 0;
 
@@ -8,10 +8,18 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "bufHashTbl.h"
 #include "file.h"
+#include "latch.h"
+#include "log_manager.h"
 
 namespace badgerdb {
 
@@ -20,6 +28,31 @@ namespace badgerdb {
  */
 class BufMgr;
 
+/**
+ * forward declaration of PageGuard class
+ */
+class PageGuard;
+
+/**
+ * @brief How a page fetched through BufMgr::fetch() is latched while pinned
+ */
+enum LatchMode {
+  /**
+   * Not latched; the caller is the only thread using the page
+   */
+  LATCH_NONE,
+
+  /**
+   * Latched shared, for reading
+   */
+  LATCH_SHARED,
+
+  /**
+   * Latched exclusive, for writing
+   */
+  LATCH_EXCLUSIVE
+};
+
 /**
  * @brief Class for maintaining information about buffer pool frames
  */
@@ -62,6 +95,37 @@ class BufDesc {
    */
   bool refbit;
 
+  /**
+   * True if the page has logged changes which are not yet written to disk
+   */
+  bool logged;
+
+  /**
+   * Log offset from which the log holds changes missing from the page on
+   * disk, valid if logged is set
+   */
+  Lsn recLsn;
+
+  /**
+   * True while the page is read into or written from the frame without the
+   * buffer manager's mutex; the frame is pinned meanwhile, and threads
+   * looking the page up wait for the I/O to finish.
+   */
+  bool ioInProgress;
+
+  /**
+   * Owners of the outstanding pins on this frame, one entry per pin.  Only
+   * recorded while pin tracking is enabled in the buffer manager.
+   */
+  std::vector<std::string> pinOwners;
+
+  /**
+   * Reader/writer latch on the contents of the frame, taken by page guards
+   * while the frame is pinned.  Not reset when the frame is reassigned, since
+   * an unpinned frame is never latched.
+   */
+  RWLatch latch;
+
   /**
    * Initialize buffer frame for a new user
    */
@@ -72,6 +136,10 @@ class BufDesc {
     dirty = false;
     refbit = false;
     valid = false;
+    logged = false;
+    recLsn = 0;
+    ioInProgress = false;
+    pinOwners.clear();
   };
 
   /**
@@ -89,6 +157,10 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    logged = false;
+    recLsn = 0;
+    ioInProgress = false;
+    pinOwners.clear();
   }
 
   void Print() {
@@ -101,7 +173,10 @@ class BufDesc {
     std::cout << "valid:" << valid << " ";
     std::cout << "pinCnt:" << pinCnt << " ";
     std::cout << "dirty:" << dirty << " ";
-    std::cout << "refbit:" << refbit << "\n";
+    std::cout << "refbit:" << refbit;
+    for (std::size_t i = 0; i < pinOwners.size(); ++i)
+      std::cout << (i == 0 ? " owners:" : ",") << pinOwners[i];
+    std::cout << "\n";
   }
 
   /**
@@ -140,12 +215,60 @@ struct BufStats {
   BufStats() { clear(); }
 };
 
+/**
+ * @brief Occupancy of the buffer pool by the pages of one file
+ */
+struct FrameUsage {
+  /**
+   * Number of valid frames holding pages of the file
+   */
+  std::uint32_t frames;
+
+  /**
+   * Number of those frames which are currently pinned
+   */
+  std::uint32_t pinned;
+
+  /**
+   * Number of those frames which are dirty
+   */
+  std::uint32_t dirty;
+
+  /**
+   * Clear all values
+   */
+  void clear() { frames = pinned = dirty = 0; }
+
+  /**
+   * Constructor of FrameUsage class
+   */
+  FrameUsage() { clear(); }
+};
+
 /**
  * @brief The central class which manages the buffer pool including frame
  * allocation and deallocation to pages in the file
+ *
+ * All methods may be called from several threads.  The frame table is
+ * protected by one mutex, which is released during disk I/O and log flushes:
+ * the frame is pinned and marked as in I/O first, and published once the
+ * I/O is done, so other threads only wait for the pages actually being read
+ * or written.  The contents of a pinned page are protected by the latch of
+ * its frame, taken by fetching the page with a LatchMode.
  */
 class BufMgr {
  private:
+  /**
+   * Protects the frame table, the hash table, the file handles, the clock
+   * and the statistics
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Signalled whenever a frame finishes its I/O
+   */
+  std::condition_variable ioDone;
+
   /**
    * Current position of clockhand in our buffer pool
    */
@@ -161,6 +284,35 @@ class BufMgr {
    */
   BufHashTbl* hashTable;
 
+  /**
+   * Handles of the files with pages in the buffer pool, keyed by file name.
+   * Frames refer to these handles rather than to the callers' File objects,
+   * so every File object for the same file shares its buffered pages, and
+   * dirty pages can outlive the File object through which they were changed.
+   */
+  std::map<std::string, File*> files;
+
+  /**
+   * Write-ahead log of page changes, NULL if changes are not logged
+   */
+  LogManager* logManager;
+
+  /**
+   * Names of the files whose changes are never logged
+   */
+  std::set<std::string> unloggedFiles;
+
+  /**
+   * Files whose page lists are being relinked by sortPageLists(), with the
+   * log offset of the relink record, reported in the dirty-page table
+   */
+  std::map<std::string, Lsn> relinking;
+
+  /**
+   * isLogged() for callers already holding the mutex
+   */
+  bool isLoggedLocked(const File* file) const;
+
   /**
    * Array of BufDesc objects to hold information corresponding to every frame
    * allocation from 'bufPool' (the buffer pool)
@@ -172,20 +324,108 @@ class BufMgr {
    */
   BufStats bufStats;
 
+  /**
+   * True if the owner of every pin is recorded in the frame descriptors
+   */
+  bool trackPins;
+
+  /**
+   * Owner tag recorded for new pins by the current thread, set through
+   * BufPinScope
+   */
+  static thread_local std::string pinOwner;
+
+  /**
+   * Record the current pin owner against the given frame
+   */
+  void recordPin(FrameId frame);
+
+  /**
+   * Forget one recorded owner of the given frame, preferring the current pin
+   * owner
+   */
+  void releasePin(FrameId frame);
+
+  /**
+   * Get the buffer pool's handle for the given file, creating it if needed
+   */
+  File* registerFile(const File* file);
+
+  /**
+   * Get the buffer pool's handle for the given file, NULL if none of its pages
+   * is buffered
+   */
+  File* findFile(const File* file) const;
+
+  /**
+   * Look up the frame holding a page of a file handle of the buffer pool
+   *
+   * @return  True if the page is buffered
+   */
+  bool findFrame(File* file, const PageId pageNo, FrameId& frame);
+
+  /**
+   * Latch a page pinned by the calling thread in the given mode and wrap
+   * the pin and latch in a guard
+   */
+  PageGuard latchPage(File* file, const PageId pageNo, Page* page,
+                      const LatchMode mode);
+
+  /**
+   * reportPins() for callers already holding the mutex
+   */
+  std::string reportPinsLocked(const File* file) const;
+
+  /**
+   * Write a frame to disk, first flushing the log up to the page LSN.  Called
+   * without the mutex, with the frame pinned so that it is not reassigned,
+   * and with its contents kept from changing by the caller.
+   */
+  void writeFrame(FrameId frame);
+
+  /**
+   * Write a dirty, unpinned frame to disk and mark it clean.  The frame is
+   * pinned and marked as in I/O while the mutex is released for the write,
+   * so the frame table may have changed when this returns.
+   *
+   * @param frame  	Frame to write
+   * @param lock  	Lock holding the mutex
+   */
+  void cleanFrame(FrameId frame, std::unique_lock<std::mutex>& lock);
+
+  /**
+   * Append a change of the given page to the log and stamp the page with the
+   * LSN of the record.  Does nothing if no log is attached or the file is
+   * not logged.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param page  	Changed page in the buffer pool, NULL if the page is gone
+   * @param type  	Kind of change
+   * @param slotNo  Changed slot
+   * @param data  	New record bytes
+   * @return  LSN of the record, 0 if nothing was logged
+   */
+  Lsn logChange(File* file, const PageId pageNo, Page* page,
+                 const LogRecordType type, const SlotId slotNo,
+                 const std::string& data);
+
   /**
    * Advance clock to next frame in the buffer pool
    */
   void advanceClock();
 
   /**
-   * Allocate a free frame.
+   * Allocate a free frame.  A dirty victim is written back with the mutex
+   * released, so the frame table may have changed when this returns.
    *
    * @param frame   	Frame reference, frame ID of allocated frame returned via
    * this variable
+   * @param lock  	Lock holding the mutex
    * @throws BufferExceededException If no such buffer is found which can be
    * allocated
    */
-  void allocBuf(FrameId& frame);
+  void allocBuf(FrameId& frame, std::unique_lock<std::mutex>& lock);
 
  public:
   /**
@@ -216,6 +456,31 @@ class BufMgr {
    */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+  /**
+   * Reads the given page into the buffer pool like readPage(), but returns a
+   * guard owning the pin.  The page is unpinned when the guard is destroyed,
+   * and marked dirty if it was written through the guard.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @param mode  	How the page is latched until the guard releases it
+   * @return  Guard holding the pinned page
+   */
+  PageGuard fetch(File* file, const PageId PageNo,
+                  const LatchMode mode = LATCH_NONE);
+
+  /**
+   * Reads the given page into the buffer pool like fetch(), latched
+   * exclusive, unless another thread holds the latch.  Lets a thread which
+   * already holds a latch take a second one without risking a deadlock.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @return  Guard holding the pinned and latched page, empty if the latch
+   * is held elsewhere
+   */
+  PageGuard tryFetchExclusive(File* file, const PageId PageNo);
+
   /**
    * Unpin a page from memory since it is no longer required for it to remain in
    * memory.
@@ -240,10 +505,22 @@ class BufMgr {
    */
   void allocPage(File* file, PageId& PageNo, Page*& page);
 
+  /**
+   * Allocates a new page in the file like allocPage(), but returns a guard
+   * owning the pin.
+   *
+   * @param file   	File object
+   * @param mode  	How the page is latched until the guard releases it
+   * @return  Guard holding the new page
+   */
+  PageGuard fetchNew(File* file, const LatchMode mode = LATCH_NONE);
+
   /**
    * Writes out all dirty pages of the file to disk.
    * All the frames assigned to the file need to be unpinned from buffer pool
    * before this function can be successfully called. Otherwise Error returned.
+   * If a log is attached, it is flushed up to the page LSN before each page
+   * is written.
    *
    * @param file   	File object
    * @throws  PagePinnedException If any page of the file is pinned in the
@@ -253,16 +530,90 @@ class BufMgr {
    */
   void flushFile(const File* file);
 
+  /**
+   * Drops all pages of the file from the buffer pool without writing them,
+   * for temporary files which are about to be removed.  The file is logged
+   * again if a file of the same name is used later.
+   *
+   * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the
+   * buffer pool
+   */
+  void discardFile(const File* file);
+
+  /**
+   * Writes one page to disk if it is buffered and dirty.  The page stays in
+   * the buffer pool, and other threads may keep using it: it is pinned and
+   * latched shared while it is written, so the calling thread must not hold
+   * it latched exclusive.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   */
+  void flushPage(File* file, const PageId PageNo);
+
   /**
    * Delete page from file and also from buffer pool if present.
    * Since the page is entirely deleted from file, its unnecessary to see if the
-   * page is dirty.
+   * page is dirty.  If the disposal is logged, the log is flushed past it
+   * before the page is freed on disk.
    *
    * @param file   	File object
    * @param PageNo  Page number
    */
   void disposePage(File* file, const PageId PageNo);
 
+  /**
+   * Relink the page lists of the file in physical order through
+   * File::sortPageLists(), which writes the pages directly.  If the file is
+   * logged, the relink is logged and the log flushed first, and until the
+   * relink is done the dirty-page table lists the file's header page from
+   * the relink record on, so that recovery repeats a relink cut short by a
+   * crash.
+   *
+   * @param file   	File object
+   * @return  Number of pages rewritten
+   */
+  int sortPageLists(File* file);
+
+  /**
+   * Attach a write-ahead log.  From then on every change made through a
+   * PageGuard, allocPage() or disposePage() is logged, except for files
+   * marked with setUnlogged(), and dirty pages are
+   * written lazily: on eviction, flushFile() or destruction, each after the
+   * log records describing it.  The log must outlive the buffer manager.
+   *
+   * @param log  	Log to attach, NULL to stop logging
+   */
+  void setLogManager(LogManager* log) { logManager = log; }
+
+  /**
+   * Get the attached write-ahead log, NULL if changes are not logged
+   */
+  LogManager* getLogManager() const { return logManager; }
+
+  /**
+   * Never log the changes to a file, e.g. a temporary file which is not
+   * needed after a crash.  Its pages are still written to it on eviction.
+   *
+   * @param file   	File object
+   */
+  void setUnlogged(const File* file);
+
+  /**
+   * Are the changes to a file logged?  False if no log is attached.
+   *
+   * @param file   	File object
+   */
+  bool isLogged(const File* file) const;
+
+  /**
+   * Get the dirty-page table: every buffered page with logged changes not yet
+   * written to disk, with the LSN of the oldest such change, and the header
+   * page of every file whose page lists are being relinked.
+   */
+  std::vector<DirtyPage> getDirtyPages() const;
+
   /**
    * Print member variable values.
    */
@@ -277,6 +628,284 @@ class BufMgr {
    * Clear buffer pool usage statistics
    */
   void clearBufStats() { bufStats.clear(); }
+
+  /**
+   * Enable or disable recording of pin owners.  When enabled, flushFile() and
+   * the destructor report every outstanding pin together with its owner
+   * before failing on it.
+   *
+   * @param enable  True to record the owner of every new pin
+   */
+  void setPinTracking(const bool enable);
+
+  /**
+   * Is pin tracking enabled?
+   */
+  bool isPinTracking() const { return trackPins; }
+
+  /**
+   * Describe every outstanding pin, one line per pinned frame, with the owners
+   * holding it when pin tracking is enabled.
+   *
+   * @param file   	File object, or NULL to report pins of all files
+   * @return  Report text, empty if no page is pinned
+   */
+  std::string reportPins(const File* file) const;
+
+  /**
+   * Get the number of frames, pinned frames and dirty frames held by each
+   * file in the buffer pool, keyed by file name.
+   */
+  std::map<std::string, FrameUsage> getFrameUsage() const;
+
+  friend class BufPinScope;
+
+  friend class PageGuard;
+};
+
+/**
+ * @brief Scoped owner tag for buffer pins.  While an instance is alive, every
+ * page pinned through the buffer manager is recorded against the given owner
+ * (if pin tracking is enabled).  The previous owner is restored on
+ * destruction.
+ */
+class BufPinScope {
+ private:
+  /**
+   * Buffer manager whose pin owner is set
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Owner to restore on destruction
+   */
+  std::string previousOwner;
+
+ public:
+  /**
+   * Constructor of BufPinScope class
+   *
+   * @param bufMgr 	Buffer manager
+   * @param owner  	Tag identifying the code pinning pages
+   */
+  BufPinScope(BufMgr* bufMgr, const std::string& owner)
+      : bufMgr(bufMgr), previousOwner(bufMgr->pinOwner) {
+    bufMgr->pinOwner = owner;
+  }
+
+  /**
+   * Destructor of BufPinScope class
+   */
+  ~BufPinScope() { bufMgr->pinOwner = previousOwner; }
+};
+
+/**
+ * @brief Move-only handle to a page pinned in the buffer pool.  The page is
+ * unpinned when the handle is destroyed or released, so a pin is never leaked
+ * when an exception unwinds past its holder.
+ */
+class PageGuard {
+ private:
+  /**
+   * Buffer manager holding the pin, NULL if the guard is empty
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * File to which the page belongs
+   */
+  File* file;
+
+  /**
+   * Page number in the file
+   */
+  PageId pageNo;
+
+  /**
+   * Pinned page in the buffer pool
+   */
+  Page* page;
+
+  /**
+   * True if the page has been written through this guard
+   */
+  bool dirty;
+
+  /**
+   * Latch of the frame, held in the given mode until the pin is released
+   */
+  RWLatch* latch;
+
+  /**
+   * Mode in which the latch is held
+   */
+  LatchMode mode;
+
+ public:
+  /**
+   * Constructs an empty guard
+   */
+  PageGuard()
+      : bufMgr(NULL), file(NULL), pageNo(Page::INVALID_NUMBER), page(NULL),
+        dirty(false), latch(NULL), mode(LATCH_NONE) {}
+
+  /**
+   * Constructs a guard taking over a pin, and a latch in the given mode,
+   * already held on the page.  Normally created through BufMgr::fetch().
+   */
+  PageGuard(BufMgr* bufMgr, File* file, const PageId pageNo, Page* page,
+            RWLatch* latch = NULL, const LatchMode mode = LATCH_NONE)
+      : bufMgr(bufMgr), file(file), pageNo(pageNo), page(page), dirty(false),
+        latch(latch), mode(mode) {}
+
+  /**
+   * Move constructor; the other guard is left empty
+   */
+  PageGuard(PageGuard&& other)
+      : bufMgr(other.bufMgr), file(other.file), pageNo(other.pageNo),
+        page(other.page), dirty(other.dirty), latch(other.latch),
+        mode(other.mode) {
+    other.bufMgr = NULL;
+    other.page = NULL;
+    other.mode = LATCH_NONE;
+  }
+
+  /**
+   * Move assignment; the pin held by this guard is released first
+   */
+  PageGuard& operator=(PageGuard&& other) {
+    if (this != &other) {
+      release();
+      bufMgr = other.bufMgr;
+      file = other.file;
+      pageNo = other.pageNo;
+      page = other.page;
+      dirty = other.dirty;
+      latch = other.latch;
+      mode = other.mode;
+      other.bufMgr = NULL;
+      other.page = NULL;
+      other.mode = LATCH_NONE;
+    }
+    return *this;
+  }
+
+  PageGuard(const PageGuard&) = delete;
+  PageGuard& operator=(const PageGuard&) = delete;
+
+  /**
+   * Destructor of PageGuard class, unpins the page.  An error while
+   * unpinning is reported on std::cerr rather than thrown, since the guard may
+   * be destroyed while an exception unwinds.
+   */
+  ~PageGuard();
+
+  /**
+   * Is a page held by this guard?
+   */
+  bool isPinned() const { return bufMgr != NULL; }
+
+  /**
+   * Get the number of the guarded page
+   */
+  PageId pageNumber() const { return pageNo; }
+
+  /**
+   * Get the guarded page for reading
+   */
+  Page& read() const { return *page; }
+
+  /**
+   * Get the guarded page for writing; the page is marked dirty when unpinned
+   */
+  Page& write() {
+    dirty = true;
+    return *page;
+  }
+
+  /**
+   * Mark the page dirty without writing through the guard
+   */
+  void markDirty() { dirty = true; }
+
+  /**
+   * Insert a record into the guarded page, logging the change if the buffer
+   * manager has a write-ahead log
+   *
+   * @param record_data  Bytes of the record
+   * @return  Id of the new record
+   */
+  RecordId insertRecord(const std::string& record_data);
+
+  /**
+   * Insert the moved copy of a record into the guarded page, logging the
+   * change
+   *
+   * @param record_data  Bytes of the record
+   * @param home  	Slot holding the forwarding stub to the copy
+   * @return  Id of the new copy
+   */
+  RecordId insertMovedRecord(const std::string& record_data,
+                             const RecordId& home);
+
+  /**
+   * Replace a record of the guarded page, logging the change
+   *
+   * @param record_id  	Record to replace
+   * @param record_data  New bytes of the record
+   */
+  void updateRecord(const RecordId& record_id, const std::string& record_data);
+
+  /**
+   * Delete a record of the guarded page, logging the change
+   *
+   * @param record_id  	Record to delete
+   */
+  void deleteRecord(const RecordId& record_id);
+
+  /**
+   * Turn a record of the guarded page into a forwarding stub, logging the
+   * change
+   *
+   * @param record_id  	Record which has moved
+   * @param new_location  Record id of the moved record
+   */
+  void forwardRecord(const RecordId& record_id, const RecordId& new_location);
+
+  /**
+   * Latch the page, pinned without a latch, in the given mode until the pin
+   * is released.  Lets a page pinned by one thread be latched by the thread
+   * which reads it, as latches are held per thread.
+   */
+  void acquireLatch(const LatchMode mode) {
+    if (bufMgr == NULL || this->mode != LATCH_NONE) {
+      return;
+    }
+    if (mode == LATCH_SHARED) {
+      latch->lockShared();
+    } else if (mode == LATCH_EXCLUSIVE) {
+      latch->lockExclusive();
+    }
+    this->mode = mode;
+  }
+
+  /**
+   * Unlatch and unpin the page now instead of on destruction
+   */
+  void release() {
+    if (bufMgr != NULL) {
+      BufMgr* owner = bufMgr;
+      bufMgr = NULL;
+      page = NULL;
+      if (mode == LATCH_SHARED) {
+        latch->unlockShared();
+      } else if (mode == LATCH_EXCLUSIVE) {
+        latch->unlockExclusive();
+      }
+      mode = LATCH_NONE;
+      owner->unPinPage(file, pageNo, dirty);
+    }
+  }
 };
 
 }  // namespace badgerdb
@@ -9,7 +9,9 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "partition.h"
 #include "schema.h"
 
 using namespace std;
@@ -46,6 +48,23 @@ class Catalog {
    */
   map<TableId, string> tableFilenames;
 
+  /**
+   * Mapping table id to the partitioning of a partitioned table
+   */
+  map<TableId, PartitionScheme> partitionSchemes;
+
+  /**
+   * Mapping table id to the filenames of the partitions of a partitioned
+   * table
+   */
+  map<TableId, vector<string> > partitionFilenames;
+
+  /**
+   * Mapping the table id of a materialized join view to the ids of its left
+   * and right tables
+   */
+  map<TableId, pair<TableId, TableId> > joinViews;
+
   /**
    * Next available table Id
    */
@@ -105,12 +124,127 @@ class Catalog {
   }
 
   /**
-   * DROP TABLE
+   * PARTITION BY: store the table in one file per partition, named after the
+   * table file with the suffix .p0, .p1, ...
+   *
+   * @throws PartitionException If the partitioning does not fit the table
+   */
+  void setPartitionScheme(const TableId& id, const PartitionScheme& scheme) {
+    scheme.validate(getTableSchema(id));
+    vector<string> filenames;
+    for (int i = 0; i < scheme.getPartitionCount(); ++i) {
+      filenames.push_back(getTableFilename(id) + ".p" + std::to_string(i));
+    }
+    partitionSchemes.erase(id);
+    partitionSchemes.insert(pair<TableId, PartitionScheme>(id, scheme));
+    partitionFilenames[id] = filenames;
+  }
+
+  /**
+   * Is the table partitioned?
+   */
+  bool isPartitioned(const TableId& id) const {
+    return partitionSchemes.find(id) != partitionSchemes.end();
+  }
+
+  /**
+   * Get the partitioning of a partitioned table
+   */
+  const PartitionScheme& getPartitionScheme(const TableId& id) const {
+    return partitionSchemes.at(id);
+  }
+
+  /**
+   * Get the file of a partition
+   */
+  const string& getPartitionFilename(const TableId& id, int partition) const {
+    return partitionFilenames.at(id).at(partition);
+  }
+
+  /**
+   * Get the files holding the tuples of a table: the files of its partitions
+   * if it is partitioned, otherwise the table file
+   */
+  vector<string> getDataFilenames(const TableId& id) const {
+    if (isPartitioned(id)) {
+      return partitionFilenames.at(id);
+    }
+    return vector<string>(1, getTableFilename(id));
+  }
+
+  /**
+   * Get the partitioned table whose table file is the given file.  That file
+   * holds no tuples; they are in the files of the partitions.
+   *
+   * @return  True and the table id if there is such a table
+   */
+  bool findPartitionedTable(const string& filename, TableId& id) const {
+    for (auto it = partitionSchemes.begin(); it != partitionSchemes.end();
+         ++it) {
+      if (getTableFilename(it->first) == filename) {
+        id = it->first;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * CREATE MATERIALIZED VIEW: register a table holding the natural join of
+   * two tables, which is kept current as the tables change
+   */
+  TableId addJoinView(const TableSchema& viewSchema,
+                      const string& viewFilename,
+                      const TableId& leftId,
+                      const TableId& rightId) {
+    const TableId id = addTableSchema(viewSchema, viewFilename);
+    joinViews.insert(pair<TableId, pair<TableId, TableId> >(
+        id, pair<TableId, TableId>(leftId, rightId)));
+    return id;
+  }
+
+  /**
+   * Is the table a materialized join view?
+   */
+  bool isJoinView(const TableId& id) const {
+    return joinViews.find(id) != joinViews.end();
+  }
+
+  /**
+   * Get the ids of the left and right tables of a materialized join view
+   */
+  const pair<TableId, TableId>& getJoinViewInputs(const TableId& id) const {
+    return joinViews.at(id);
+  }
+
+  /**
+   * Get the ids of all materialized join views
+   */
+  vector<TableId> getJoinViews() const {
+    vector<TableId> ids;
+    for (auto it = joinViews.begin(); it != joinViews.end(); ++it) {
+      ids.push_back(it->first);
+    }
+    return ids;
+  }
+
+  /**
+   * DROP TABLE.  Views over the table are no longer maintained.
    */
   void deleteTableSchema(const TableId& id) {
     tableIds.erase(getTableSchema(id).getTableName());
     tableSchemas.erase(id);
     tableFilenames.erase(id);
+    partitionSchemes.erase(id);
+    partitionFilenames.erase(id);
+    joinViews.erase(id);
+    for (auto it = joinViews.begin(); it != joinViews.end();) {
+      if (it->second.first == id || it->second.second == id) {
+        it = joinViews.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
 
   /**
@@ -0,0 +1,32 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_format_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+FileFormatException::FileFormatException(const std::string& name,
+                                         const std::uint32_t version,
+                                         const std::uint32_t expected)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "File " << filename_;
+  if (version == 0) {
+    // no magic number: an unversioned file from an older build, or not a
+    // database file at all
+    ss << " has no on-disk format version";
+  } else {
+    ss << " has on-disk format version " << version;
+  }
+  ss << ", but version " << expected << " is required";
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "join_predicate_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+JoinPredicateException::JoinPredicateException(const std::string& predicate,
+                                               const std::string& reason)
+    : BadgerDbException(""), predicate_(predicate) {
+  std::stringstream ss;
+  ss << "Join predicate " << predicate_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a join predicate does not fit the
+ *        tables it joins.
+ */
+class JoinPredicateException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a join predicate exception for the given predicate.
+   *
+   * @param predicate  Text of the predicate.
+   * @param reason     What is wrong with it.
+   */
+  JoinPredicateException(const std::string& predicate,
+                         const std::string& reason);
+
+  /**
+   * Returns the text of the predicate.
+   */
+  virtual const std::string& predicate() const { return predicate_; }
+
+ protected:
+  /**
+   * Text of the predicate.
+   */
+  const std::string predicate_;
+};
+
+}
@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lock_timeout_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+LockTimeoutException::LockTimeoutException(const std::uint64_t txn,
+                                           const std::string& name,
+                                           const RecordId& rid)
+    : BadgerDbException(""), txn_(txn) {
+  std::stringstream ss;
+  ss << "Transaction " << txn << " timed out waiting for a lock on record ("
+     << rid.page_number << "," << rid.slot_number << ") of file " << name;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,46 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a row lock is not granted within
+ *        the lock timeout, which is taken to mean a deadlock.
+ */
+class LockTimeoutException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a lock timeout exception for the given request.
+   *
+   * @param txn   Transaction requesting the lock.
+   * @param name  Name of the file holding the record.
+   * @param rid   Record to be locked.
+   */
+  LockTimeoutException(const std::uint64_t txn, const std::string& name,
+                       const RecordId& rid);
+
+  /**
+   * Returns the transaction which timed out.
+   */
+  std::uint64_t txn() const { return txn_; }
+
+ protected:
+  /**
+   * Transaction which timed out.
+   */
+  const std::uint64_t txn_;
+};
+
+}
@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the write-ahead log cannot be
+ *        opened, written or synced.
+ */
+class LogException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a log exception for the given log file.
+   *
+   * @param name      Name of the log file.
+   * @param operation Operation which failed.
+   */
+  LogException(const std::string& name, const std::string& operation);
+
+  /**
+   * Returns the name of the log file.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of the log file.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "memory_exceeded_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+MemoryExceededException::MemoryExceededException(const int requested,
+                                                 const int budget)
+    : BadgerDbException(""),
+      pages_requested_(requested),
+      pages_budget_(budget) {
+  std::stringstream ss;
+  ss << "Operator memory exceeded the budget: " << requested
+     << " pages needed, " << budget << " pages available";
+  message_.assign(ss.str());
+}
+
+}
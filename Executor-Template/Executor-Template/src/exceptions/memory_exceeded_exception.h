@@ -0,0 +1,52 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an operator needs more memory than
+ *        its page budget allows.
+ */
+class MemoryExceededException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a memory exceeded exception.
+   *
+   * @param requested   Pages that would be in use after the request.
+   * @param budget      Pages available to the operator.
+   */
+  MemoryExceededException(const int requested, const int budget);
+
+  /**
+   * Returns the pages that would have been in use.
+   */
+  int pages_requested() const { return pages_requested_; }
+
+  /**
+   * Returns the page budget of the operator.
+   */
+  int pages_budget() const { return pages_budget_; }
+
+ protected:
+  /**
+   * Pages that would have been in use.
+   */
+  const int pages_requested_;
+
+  /**
+   * Page budget of the operator.
+   */
+  const int pages_budget_;
+};
+
+}
@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a table is declared with an
+ *        unusable partitioning, or a partitioned table is used as a plain one.
+ */
+class PartitionException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a partition exception for the given table.
+   *
+   * @param table   Name of the table.
+   * @param reason  What is wrong with its partitioning.
+   */
+  PartitionException(const std::string& table, const std::string& reason);
+
+  /**
+   * Returns the name of the table.
+   */
+  virtual const std::string& table() const { return table_; }
+
+ protected:
+  /**
+   * Name of the table.
+   */
+  const std::string table_;
+};
+
+}
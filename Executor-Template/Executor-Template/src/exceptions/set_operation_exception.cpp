@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "set_operation_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+SetOperationException::SetOperationException(const std::string& operation,
+                                             const std::string& reason)
+    : BadgerDbException(""), operation_(operation) {
+  std::stringstream ss;
+  ss << "Set operation " << operation_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
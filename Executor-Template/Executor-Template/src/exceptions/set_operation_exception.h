@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the tables of a set operation
+ *        cannot be compared tuple by tuple.
+ */
+class SetOperationException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a set operation exception for the given operation.
+   *
+   * @param operation  Text of the operation, e.g. r UNION s.
+   * @param reason     What is wrong with it.
+   */
+  SetOperationException(const std::string& operation,
+                        const std::string& reason);
+
+  /**
+   * Returns the text of the operation.
+   */
+  virtual const std::string& operation() const { return operation_; }
+
+ protected:
+  /**
+   * Text of the operation.
+   */
+  const std::string operation_;
+};
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "sort_key_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+SortKeyException::SortKeyException(const std::string& attrName,
+                                   const std::string& reason)
+    : BadgerDbException(""), attrName_(attrName) {
+  std::stringstream ss;
+  ss << "Sort key " << attrName_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an ORDER BY attribute does not
+ *        fit the table it orders.
+ */
+class SortKeyException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a sort key exception for the given attribute.
+   *
+   * @param attrName  Name of the attribute.
+   * @param reason    What is wrong with it.
+   */
+  SortKeyException(const std::string& attrName, const std::string& reason);
+
+  /**
+   * Returns the name of the attribute.
+   */
+  virtual const std::string& attrName() const { return attrName_; }
+
+ protected:
+  /**
+   * Name of the attribute.
+   */
+  const std::string attrName_;
+};
+
+}
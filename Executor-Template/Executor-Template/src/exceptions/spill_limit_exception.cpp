@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "spill_limit_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+SpillLimitException::SpillLimitException(const std::uint64_t requested,
+                                         const std::uint64_t limit)
+    : BadgerDbException(""),
+      bytes_requested_(requested),
+      bytes_limit_(limit) {
+  std::stringstream ss;
+  ss << "Temporary files exceeded the spill limit: " << requested
+     << " bytes needed, " << limit << " bytes allowed";
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,53 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the temporary files of an operator
+ *        would grow past the spill limit.
+ */
+class SpillLimitException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a spill limit exception.
+   *
+   * @param requested   Spill bytes that would be in use after the request.
+   * @param limit       Spill bytes allowed.
+   */
+  SpillLimitException(const std::uint64_t requested, const std::uint64_t limit);
+
+  /**
+   * Returns the spill bytes that would have been in use.
+   */
+  std::uint64_t bytes_requested() const { return bytes_requested_; }
+
+  /**
+   * Returns the spill limit.
+   */
+  std::uint64_t bytes_limit() const { return bytes_limit_; }
+
+ protected:
+  /**
+   * Spill bytes that would have been in use.
+   */
+  const std::uint64_t bytes_requested_;
+
+  /**
+   * Spill bytes allowed.
+   */
+  const std::uint64_t bytes_limit_;
+};
+
+}
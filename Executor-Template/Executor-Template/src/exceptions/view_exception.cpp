@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "view_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+ViewException::ViewException(const std::string& view,
+                             const std::string& reason)
+    : BadgerDbException(""), view_(view) {
+  std::stringstream ss;
+  ss << "Materialized view " << view_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a materialized view cannot be
+ *        defined or maintained.
+ */
+class ViewException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a view exception for the given view.
+   *
+   * @param view    Name of the view.
+   * @param reason  What is wrong with it.
+   */
+  ViewException(const std::string& view, const std::string& reason);
+
+  /**
+   * Returns the name of the view.
+   */
+  virtual const std::string& view() const { return view_; }
+
+ protected:
+  /**
+   * Name of the view.
+   */
+  const std::string view_;
+};
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "window_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+WindowException::WindowException(const std::string& function,
+                                 const std::string& reason)
+    : BadgerDbException(""), function_(function) {
+  std::stringstream ss;
+  ss << "Window function " << function_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
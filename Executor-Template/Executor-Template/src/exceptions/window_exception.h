@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a window function does not
+ *        fit the table it is computed over.
+ */
+class WindowException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a window exception for the given function.
+   *
+   * @param function  Text of the function.
+   * @param reason    What is wrong with it.
+   */
+  WindowException(const std::string& function, const std::string& reason);
+
+  /**
+   * Returns the text of the function.
+   */
+  virtual const std::string& function() const { return function_; }
+
+ protected:
+  /**
+   * Text of the function.
+   */
+  const std::string function_;
+};
+
+}
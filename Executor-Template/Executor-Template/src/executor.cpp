@@ -16,10 +16,18 @@
 #include <sstream>
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 
+#include "exceptions/join_predicate_exception.h"
+#include "exceptions/partition_exception.h"
+#include "exceptions/set_operation_exception.h"
+#include "exceptions/window_exception.h"
+#include "external_sort.h"
 #include "file_iterator.h"
+#include "join_key.h"
 #include "page_iterator.h"
+#include "page_reader.h"
 #include "storage.h"
 
 using namespace std;
@@ -27,58 +35,25 @@ using namespace std;
 namespace badgerdb {
 
 void TableScanner::print() const {
+  print(cout, TextTupleFormatter());
+}
+
+void TableScanner::print(ostream& out, const TupleFormatter& formatter) const {
+  PartitionedTable::checkPlainFile(tableFile);
   badgerdb::File file = badgerdb::File::open(tableFile.filename());
+  BufPinScope pinScope(bufMgr, "TABLE_SCANNER");
+  OutputBuffer buffer(out);
+  formatter.begin(tableSchema, buffer);
   for (badgerdb::FileIterator iter = file.begin(); iter != file.end(); ++iter) {
-    badgerdb::Page page = *iter;
-    badgerdb::Page* buffered_page;
-    bufMgr->readPage(&file, page.page_number(), buffered_page);
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    badgerdb::Page* buffered_page = &guard.read();
 
     for (badgerdb::PageIterator page_iter = buffered_page->begin();
          page_iter != buffered_page->end(); ++page_iter) {
-      string key = *page_iter;
-      string print_key = "(";
-      int current_index = 0;
-      for (int i = 0; i < tableSchema.getAttrCount(); ++i) {
-        switch (tableSchema.getAttrType(i)) {
-          case INT: {
-            int true_value = 0;
-            for (int j = 0; j < 4; ++j) {
-              if (std::string(key, current_index + j, 1)[0] == '\0') {
-                continue;  // \0 is actually representing 0
-              }
-              true_value +=
-                  (std::string(key, current_index + j, 1))[0] * pow(128, 3 - j);
-            }
-            print_key += to_string(true_value);
-            current_index += 4;
-            break;
-          }
-          case CHAR: {
-            int max_len = tableSchema.getAttrMaxSize(i);
-            print_key += std::string(key, current_index, max_len);
-            current_index += max_len;
-            current_index +=
-                (4 - (max_len % 4)) % 4;  // align to the multiple of 4
-            break;
-          }
-          case VARCHAR: {
-            int actual_len = key[current_index];
-            current_index++;
-            print_key += std::string(key, current_index, actual_len);
-            current_index += actual_len;
-            current_index +=
-                (4 - ((actual_len + 1) % 4)) % 4;  // align to the multiple of 4
-            break;
-          }
-        }
-        print_key += ",";
-      }
-      print_key[print_key.size() - 1] = ')';  // change the last ',' to ')'
-      cout << print_key << endl;
+      formatter.format(*page_iter, tableSchema, buffer);
     }
-    bufMgr->unPinPage(&file, page.page_number(), false);
   }
-  bufMgr->flushFile(&file);
+  buffer.flush();
 }
 
 JoinOperator::JoinOperator(const File& leftTableFile,
@@ -93,51 +68,89 @@ JoinOperator::JoinOperator(const File& leftTableFile,
       rightTableSchema(rightTableSchema),
       resultTableSchema(
           createResultTableSchema(leftTableSchema, rightTableSchema)),
+      leftKeyAttrNames(JoinKeyExtractor::naturalKeyAttrNames(leftTableSchema,
+                                                             rightTableSchema)),
+      rightKeyAttrNames(leftKeyAttrNames),
+      leftKeyExtractor(leftTableSchema, leftKeyAttrNames),
+      rightKeyExtractor(rightTableSchema, rightKeyAttrNames),
       catalog(catalog),
       bufMgr(bufMgr),
-      isComplete(false) {
-  // nothing
+      isComplete(false),
+      arena(Page::SIZE) {
+  PartitionedTable::checkPlainFile(leftTableFile, catalog);
+  PartitionedTable::checkPlainFile(rightTableFile, catalog);
 }
 
 TableSchema JoinOperator::createResultTableSchema(
     const TableSchema& leftTableSchema,
     const TableSchema& rightTableSchema) {
-  vector<Attribute> attrs;
+  return createResultTableSchema(
+      leftTableSchema, rightTableSchema,
+      JoinKeyExtractor::naturalKeyAttrNames(leftTableSchema, rightTableSchema));
+}
+
+TableSchema JoinOperator::createResultTableSchema(
+    const TableSchema& leftTableSchema,
+    const TableSchema& rightTableSchema,
+    const vector<string>& rightKeyAttrNames) {
+  // the right key attributes repeat left ones, so only the others are added
+  TableSchema rest(rightTableSchema.getTableName());
+  for (int i = 0; i < rightTableSchema.getAttrCount(); ++i) {
+    if (!count(rightKeyAttrNames.begin(), rightKeyAttrNames.end(),
+               rightTableSchema.getAttrName(i))) {
+      rest.addAttr(Attribute(
+          rightTableSchema.getAttrName(i), rightTableSchema.getAttrType(i),
+          rightTableSchema.getAttrMaxSize(i), rightTableSchema.isAttrNotNull(i),
+          rightTableSchema.isAttrUnique(i)));
+    }
+  }
+  return createConcatenatedTableSchema(leftTableSchema, rest);
+}
 
-  // first add all the left table attrs to the result table
+TableSchema JoinOperator::createConcatenatedTableSchema(
+    const TableSchema& leftTableSchema,
+    const TableSchema& rightTableSchema) {
+  vector<Attribute> attrs;
   for (int k = 0; k < leftTableSchema.getAttrCount(); ++k) {
-    Attribute new_attr = Attribute(
+    attrs.push_back(Attribute(
         leftTableSchema.getAttrName(k), leftTableSchema.getAttrType(k),
         leftTableSchema.getAttrMaxSize(k), leftTableSchema.isAttrNotNull(k),
-        leftTableSchema.isAttrUnique(k));
-    attrs.push_back(new_attr);
+        leftTableSchema.isAttrUnique(k)));
   }
-
-  // test every right table attrs, if it doesn't have the same attr(name and
-  // type) in the left table, then add it to the result table
   for (int i = 0; i < rightTableSchema.getAttrCount(); ++i) {
-    bool has_same = false;
-    for (int j = 0; j < leftTableSchema.getAttrCount(); ++j) {
-      if ((leftTableSchema.getAttrType(j) == rightTableSchema.getAttrType(i)) &&
-          (leftTableSchema.getAttrName(j) == rightTableSchema.getAttrName(i))) {
-        has_same = true;
-      }
-    }
-    if (!has_same) {
-      Attribute new_attr = Attribute(
-          rightTableSchema.getAttrName(i), rightTableSchema.getAttrType(i),
-          rightTableSchema.getAttrMaxSize(i), rightTableSchema.isAttrNotNull(i),
-          rightTableSchema.isAttrUnique(i));
-      attrs.push_back(new_attr);
+    string name = rightTableSchema.getAttrName(i);
+    if (leftTableSchema.hasAttr(name)) {
+      name = rightTableSchema.getTableName() + "." + name;
     }
+    attrs.push_back(Attribute(
+        name, rightTableSchema.getAttrType(i),
+        rightTableSchema.getAttrMaxSize(i), rightTableSchema.isAttrNotNull(i),
+        rightTableSchema.isAttrUnique(i)));
   }
   return TableSchema("TEMP_TABLE", attrs, true);
 }
 
+void JoinOperator::setJoinKeys(const vector<string>& leftKeyAttrNames,
+                               const vector<string>& rightKeyAttrNames) {
+  JoinKeyExtractor::checkKeyAttrs(leftTableSchema, leftKeyAttrNames,
+                                  rightTableSchema, rightKeyAttrNames);
+  this->leftKeyAttrNames = leftKeyAttrNames;
+  this->rightKeyAttrNames = rightKeyAttrNames;
+  leftKeyExtractor = JoinKeyExtractor(leftTableSchema, leftKeyAttrNames);
+  rightKeyExtractor = JoinKeyExtractor(rightTableSchema, rightKeyAttrNames);
+  updateResultTableSchema();
+}
+
+void JoinOperator::updateResultTableSchema() {
+  resultTableSchema = createResultTableSchema(leftTableSchema, rightTableSchema,
+                                              rightKeyAttrNames);
+}
+
 void JoinOperator::printRunningStats() const {
   cout << "# Result Tuples: " << numResultTuples << endl;
   cout << "# Used Buffer Pages: " << numUsedBufPages << endl;
   cout << "# I/Os: " << numIOs << endl;
+  cout << "# Peak Memory Pages: " << memoryTracker.getPeakPages() << endl;
 }
 
  
@@ -162,134 +175,140 @@ vector<Attribute> JoinOperator::getCommonAttributes(
   return common_attrs;
 }
 
-string JoinOperator::joinTuples(string leftTuple,
-                                string rightTuple,
-                                const TableSchema& leftTableSchema,
-                                const TableSchema& rightTableSchema) const {
-  int cur_right_index = 0;  // current substring index in the right table key
-  string result_tuple = leftTuple;
+string JoinOperator::joinTuples(const string& leftTuple,
+                                const string& rightTuple) const {
+  string key;
+  string result_tuple;
+  result_tuple.reserve(leftTuple.size() + rightTuple.size());
+  result_tuple += leftTuple;
+  rightKeyExtractor.extract(rightTuple, key, result_tuple);
+  return result_tuple;
+}
 
-  for (int i = 0; i < rightTableSchema.getAttrCount(); ++i) {
-    bool has_same = false;
-    for (int j = 0; j < leftTableSchema.getAttrCount(); ++j) {
-      if ((leftTableSchema.getAttrType(j) == rightTableSchema.getAttrType(i)) &&
-          (leftTableSchema.getAttrName(j) == rightTableSchema.getAttrName(i))) {
-        has_same = true;
+bool OnePassJoinOperator::execute(int numAvailableBufPages, File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  memoryTracker.reset(numAvailableBufPages);
+
+  // TODO: Implement the one-pass join algorithm (NOT required in project 3)
+
+  isComplete = true;
+  return true;
+}
+
+// offset of each attribute of a tuple, followed by the end of the tuple
+static vector<size_t> attrOffsets(const string& tuple,
+                                  const TableSchema& tableSchema) {
+  vector<size_t> offsets;
+  size_t offset = 0;
+  for (int i = 0; i < tableSchema.getAttrCount(); ++i) {
+    offsets.push_back(offset);
+    switch (tableSchema.getAttrType(i)) {
+      case INT: {
+        offset += 4;
+        break;
+      }
+      case CHAR: {
+        const size_t max_len = tableSchema.getAttrMaxSize(i);
+        offset += max_len + (4 - (max_len % 4)) % 4;
+        break;
+      }
+      case VARCHAR: {
+        const size_t actual_len =
+            offset < tuple.size() ? static_cast<unsigned char>(tuple[offset])
+                                  : 0;
+        offset += 1 + actual_len + (4 - ((actual_len + 1) % 4)) % 4;
+        break;
       }
     }
-    // if the key is only owned by right table, add it to the result tuple
-    switch (rightTableSchema.getAttrType(i)) {
+  }
+  offsets.push_back(offset);
+  return offsets;
+}
+
+// a tuple of the table standing in for a missing one in an outer join.  The
+// key attributes take the values of the paired key attributes of the other
+// tuple; the tuple format has no NULL, so the others are zero or empty.
+static string paddedTuple(const TableSchema& tableSchema,
+                          const vector<string>& keyAttrNames,
+                          const string& other,
+                          const TableSchema& otherSchema,
+                          const vector<string>& otherKeyAttrNames) {
+  const vector<size_t> otherOffsets =
+      other.empty() ? vector<size_t>() : attrOffsets(other, otherSchema);
+  string tuple;
+  for (int i = 0; i < tableSchema.getAttrCount(); ++i) {
+    const size_t k =
+        find(keyAttrNames.begin(), keyAttrNames.end(),
+             tableSchema.getAttrName(i)) - keyAttrNames.begin();
+    if (!other.empty() && k < keyAttrNames.size()) {
+      // paired key attributes are stored alike
+      const int j = otherSchema.getAttrNum(otherKeyAttrNames[k]);
+      tuple.append(other, otherOffsets[j],
+                   otherOffsets[j + 1] - otherOffsets[j]);
+      continue;
+    }
+    switch (tableSchema.getAttrType(i)) {
       case INT: {
-        if (!has_same) {
-          result_tuple += std::string(rightTuple, cur_right_index, 4);
-        }
-        cur_right_index += 4;
+        tuple.append(4, '\0');
         break;
       }
       case CHAR: {
-        int max_len = rightTableSchema.getAttrMaxSize(i);
-        if (!has_same) {
-          result_tuple += std::string(rightTuple, cur_right_index, max_len);
-        }
-        cur_right_index += max_len;
-        unsigned align_ = (4 - (max_len % 4)) % 4;  // align to the multiple of
-                                                    // 4
-        for (int k = 0; k < align_; ++k) {
-          result_tuple += "0";
-          cur_right_index++;
-        }
+        const size_t max_len = tableSchema.getAttrMaxSize(i);
+        tuple.append(max_len + (4 - (max_len % 4)) % 4, '0');
         break;
       }
       case VARCHAR: {
-        int actual_len = rightTuple[cur_right_index];
-        result_tuple += std::string(rightTuple, cur_right_index, 1);
-        cur_right_index++;
-        if (!has_same) {
-          result_tuple += std::string(rightTuple, cur_right_index, actual_len);
-        }
-        cur_right_index += actual_len;
-        unsigned align_ =
-            (4 - ((actual_len + 1) % 4)) % 4;  // align to the multiple of 4
-        for (int k = 0; k < align_; ++k) {
-          result_tuple += "0";
-          cur_right_index++;
-        }
+        tuple.push_back('\0');
+        tuple.append(3, '0');
         break;
       }
     }
   }
-  return result_tuple;
+  return tuple;
 }
 
-bool OnePassJoinOperator::execute(int numAvailableBufPages, File& resultFile) {
-  if (isComplete)
-    return true;
-
-  numResultTuples = 0;
-  numUsedBufPages = 0;
-  numIOs = 0;
+/**
+ * Hash table over one block of the inner table, mapping a join key to the
+ * remaining bytes of each tuple.  Nodes and bytes are kept in the operator's
+ * arena.
+ */
+typedef multimap<ArenaSlice, ArenaSlice, less<ArenaSlice>,
+                 ArenaAllocator<pair<const ArenaSlice, ArenaSlice> > > BlockHashMap;
 
-  // TODO: Implement the one-pass join algorithm (NOT required in project 3)
+/**
+ * Kept in the arena in front of the remaining bytes of a tuple of the inner
+ * table when its tuples without a match are returned: where the tuple is,
+ * and whether a left tuple has matched it.  Inner joins do without.
+ */
+struct BlockEntryHeader {
+  RecordId rid;
+  bool matched;
+};
 
-  isComplete = true;
-  return true;
+// header of the remaining bytes of an inner tuple
+static BlockEntryHeader* headerOf(const ArenaSlice& rest) {
+  return reinterpret_cast<BlockEntryHeader*>(
+      const_cast<char*>(rest.data) - sizeof(BlockEntryHeader));
 }
 
-void handle_tuple(string& hashString, vector<string> sameName, string &tup, string& last ,const TableSchema& tableSchema){
-    last.insert(last.size(), tup);  // 
-    unsigned int already_delete = 0;
-    for(unsigned int i = 0; i < sameName.size(); i++){
-        string comAttr = sameName[i];  // ith common attribution
-        unsigned int rank = tableSchema.getAttrNum(comAttr);
-        int index = 0;
-        for(unsigned int j = 0; j <= rank; j++){
-            DataType dataType = tableSchema.getAttrType(j);
-            if(dataType == 0){  // INT 
-                if(j == rank){
-                    hashString.insert(hashString.size(), 1, tup[index]);  // read the 4 byte from the tuple
-                    hashString.insert(hashString.size(), 1, tup[index + 1]);
-                    hashString.insert(hashString.size(), 1, tup[index + 2]);
-                    hashString.insert(hashString.size(), 1, tup[index + 3]);
-                    last.erase(index - already_delete, 4);
-                    already_delete += 4;
-                }
-                index += 4;
-            }
-            else if(dataType == 1){  // CAHR(n)
-                if(j == rank){
-                    int k = 0;
-                    for(k = 0; k < tableSchema.getAttrMaxSize(j); k++){
-                        hashString += tup[index + k];
-                    }
-                    last.erase(index - already_delete, k);
-                    already_delete += k;
-                }
-                index += tableSchema.getAttrMaxSize(j);
-            }
-            else if(dataType == 2){  // VARCAHR(n)
-                stringstream ss;
-                ss << tup[index];
-                int size  = 0;  // save the length of the value
-                ss >> size;
-                if (j == rank){
-                    int k = 0;
-                    for(k = 0; k < size; k++){
-                        hashString += tup[index + 1 + k];
-                    }
-                    last.erase(index - already_delete, k + 1);
-                    already_delete += k + 1;
-                }
-                index += size + 1;
-            }
-        }
-        if(index % 4 != 0){  // make sure the space is mutiple of 4
-            last.erase(index - already_delete, (4 - (index % 4)));
-            already_delete += 4 - (index % 4);
-            index += 4 - (index % 4);
-
-        }
+void NestedLoopJoinOperator::setJoinMode(const JoinMode mode) {
+  joinMode = mode;
+  updateResultTableSchema();
+}
 
-    }
+void NestedLoopJoinOperator::updateResultTableSchema() {
+  if (joinMode == JOIN_SEMI || joinMode == JOIN_ANTI) {
+    // only the left tuples are returned
+    resultTableSchema = createConcatenatedTableSchema(
+        leftTableSchema, TableSchema(rightTableSchema.getTableName()));
+  } else {
+    JoinOperator::updateResultTableSchema();
+  }
 }
 
 bool NestedLoopJoinOperator::execute(int numAvailableBufPages, File& resultFile) {
@@ -299,134 +318,2103 @@ bool NestedLoopJoinOperator::execute(int numAvailableBufPages, File& resultFile)
     numResultTuples = 0;
     numUsedBufPages = 0;
     numIOs = 0;
-    //ioѾpage 
-    vector<PageId> usedPage;
+    memoryTracker.reset(numAvailableBufPages);
+    // record the pins taken below against this operator
+    BufPinScope pinScope(bufMgr, getOperatorName());
     //bufڴpage 
-    vector<Page> already_in_buf;
-    vector<string> attrname;
-    vector<string> sameName;
-    map<string, vector<string>> hashMap;// recordid -> {hashstirng, last/*contains head*/}
-    
-	//ͬʱҪ 
-    for(int i = 0; i < leftTableSchema.getAttrCount(); i++){
-        attrname.push_back(leftTableSchema.getAttrName(i));
-    }
-    for(int i = 0; i < rightTableSchema.getAttrCount(); i++){
-        if(count(attrname.begin(), attrname.end(), rightTableSchema.getAttrName(i))){
-           sameName.push_back(rightTableSchema.getAttrName(i));
-        }
-    }
-    //first read min(M-1, page.size)'s rightTable
-    //ϵҹϵB(R) > B(S) 
-    //ÿζһRÿζM-1S 
-	badgerdb::File rightfile = badgerdb::File::open(catalog->getTableFilename(catalog->getTableId(rightTableSchema.getTableName())));
-    badgerdb::File leftfile = badgerdb::File::open(catalog->getTableFilename(catalog->getTableId(leftTableSchema.getTableName())));
+    vector<PageGuard> already_in_buf;
+    // scratch buffers reused for every tuple
+    string last, hashString, resultString, outerRest;
+    // the table with fewer pages, by the counts in the file headers, is read
+    // in blocks of up to M - 3 pages; the other one is read a page at a time
+    // for each block, one page ahead of the page probed, next to a frame for
+    // the page of the result being filled
+	badgerdb::File rightfile = badgerdb::File::open(rightTableFile.filename());
+    badgerdb::File leftfile = badgerdb::File::open(leftTableFile.filename());
+    const int leftPages = static_cast<int>(leftfile.getNumUsedPages());
+    const int rightPages = static_cast<int>(rightfile.getNumUsedPages());
+    const bool blockLeft = leftPages < rightPages;
+    badgerdb::File& innerfile = blockLeft ? leftfile : rightfile;
+    badgerdb::File& outerfile = blockLeft ? rightfile : leftfile;
+    const JoinKeyExtractor& innerKeys = blockLeft ? leftKeyExtractor : rightKeyExtractor;
+    const JoinKeyExtractor& outerKeys = blockLeft ? rightKeyExtractor : leftKeyExtractor;
+    memoryTracker.chargeFrames(1);
+    // pages are read on a thread of the reader while the ones before them
+    // are hashed or probed, and latched here once taken
+    PageReader reader(bufMgr, getOperatorName(), readAhead);
+    // the blocks follow each other through the inner table
+    int innerPos = 0;
     int read_page_num = 0;
     int usedPageNum = 0;
-    int sum =  0;
-    
-    //¼ļ 
-    for (FileIterator iter = rightfile.begin(); iter != rightfile.end(); ++iter)
-	{
-        sum++;
+    int sum = blockLeft ? leftPages : rightPages;
+    const int outerPages = blockLeft ? rightPages : leftPages;
+    // arena bytes already charged, and the arena use of the last page read,
+    // plus a page of headroom for chunk fragmentation
+    size_t arenaCharged = 0;
+    size_t pageHeapBytes = 0;
+
+    // what the join mode returns besides the matching pairs
+    const bool semiOrAnti = joinMode == JOIN_SEMI || joinMode == JOIN_ANTI;
+    const bool keepLeft = joinMode == JOIN_LEFT_OUTER || joinMode == JOIN_FULL_OUTER;
+    const bool keepRight = joinMode == JOIN_RIGHT_OUTER || joinMode == JOIN_FULL_OUTER;
+    // tuples without a match returned from the block, and from the table read
+    // a page at a time
+    const bool keepInner = blockLeft ? keepLeft : keepRight;
+    const bool keepOuter = blockLeft ? keepRight : keepLeft;
+    // a semi or anti join decides on the left tuples, wherever they are
+    const bool tracksInner = keepInner || (blockLeft && semiOrAnti);
+    const bool tracksOuter = keepOuter || (!blockLeft && semiOrAnti);
+    // outer tuples matched in some block, by their position in their table
+    vector<bool> outerMatched;
+    size_t bitmapCharged = 0;
+    // right part of the result for a left tuple without a match
+    string nullKey, nullRest, unmatched;
+    if (keepLeft) {
+        rightKeyExtractor.extract(paddedTuple(rightTableSchema, rightKeyAttrNames, "",
+                                              leftTableSchema, leftKeyAttrNames),
+                                  nullKey, nullRest);
     }
-    while(usedPageNum < sum)
+    // an empty inner table still leaves outer tuples without a match
+    bool firstBlock = true;
+    while(usedPageNum < sum ||
+          (firstBlock && (keepOuter || (!blockLeft && joinMode == JOIN_ANTI))))
 	{
-    for (FileIterator iter = rightfile.begin(); iter != rightfile.end(); ++iter)
+    // hashString -> last of every tuple in the current block, kept in the arena
+    BlockHashMap hashMap((less<ArenaSlice>()),
+                         ArenaAllocator<pair<const ArenaSlice, ArenaSlice> >(&arena));
+    // the next page of the block is asked for while the page before it is
+    // hashed, if that page and the hash entries of the pages still to be
+    // hashed fit next to a frame for the outer page and one for the outer
+    // page read ahead
+    bool innerRequested = false;
+    auto requestInner = [&](const size_t pagesToHash) {
+        const size_t heapNeeded = arena.getBytesAllocated() + pagesToHash * pageHeapBytes;
+        if (innerPos == sum ||
+            !memoryTracker.canCharge(3, heapNeeded > arenaCharged ? heapNeeded - arenaCharged : 0))
+            return;
+        memoryTracker.chargeFrames(1);
+        reader.request(&innerfile, innerPos++);
+        innerRequested = true;
+    };
+    // the first page of a block is always read
+    if (innerPos < sum) {
+        memoryTracker.chargeFrames(1);
+        reader.request(&innerfile, innerPos++);
+        innerRequested = true;
+    }
+    while (innerRequested)
 	{
-    	//M-1ҳbreak 
-        if(read_page_num >= numAvailableBufPages - 1)
-            break;
-        PageId pagenum = (*iter).page_number();
-        //Ѿcontinue 
-        if(count(usedPage.begin(), usedPage.end(), pagenum))
+        innerRequested = false;
+        PageGuard guard = reader.take(LATCH_SHARED);
+        if (!guard.isPinned()) {
+            // the page list ends before the count in the file header
+            memoryTracker.releaseFrames(1);
+            sum = innerPos = usedPageNum + read_page_num;
             continue;
-        //page 
-        Page *new_page;
-        bufMgr->readPage(&rightfile, pagenum, new_page);
+        }
+        // the hash entries of a page are only known once one has been hashed
+        if (pageHeapBytes > 0)
+            requestInner(2);
+        Page *new_page = &guard.read();
+        size_t heapBefore = arena.getBytesAllocated();
         //ǰҳÿԪ 
         for (PageIterator page_iter = (*new_page).begin();page_iter != (*new_page).end();++page_iter)
 		{
-            string righttuple = *page_iter;
-            string last, hashString;
-            handle_tuple(hashString, sameName, righttuple, last, rightTableSchema); //get the key(hashString) and the value(last)
-			      if(hashMap.count(hashString) == 1){
-                hashMap[hashString].push_back(last);
+            string innertuple = *page_iter;
+            last.clear();
+            hashString.clear();
+            // a right tuple keeps the attributes it adds to the result, a
+            // left tuple all of them
+            if (blockLeft) {
+                innerKeys.extractKey(innertuple, hashString);
+                last = innertuple;
+            } else {
+                innerKeys.extract(innertuple, hashString, last); //get the key(hashString) and the value(last)
             }
-            else{
-                vector<string> stringList;
-                stringList.push_back(last);
-                hashMap.insert(pair<string, vector<string>> (hashString, stringList));
+            ArenaSlice key(arena.copy(hashString.data(), hashString.size()), hashString.size());
+            ArenaSlice value;
+            if (tracksInner) {
+                char* bytes = static_cast<char*>(arena.allocate(
+                    sizeof(BlockEntryHeader) + last.size(), alignof(BlockEntryHeader)));
+                BlockEntryHeader header = {page_iter.record_id(), false};
+                memcpy(bytes, &header, sizeof(header));
+                memcpy(bytes + sizeof(header), last.data(), last.size());
+                value = ArenaSlice(bytes + sizeof(header), last.size());
+            } else {
+                value = ArenaSlice(arena.copy(last.data(), last.size()), last.size());
             }
-
+            hashMap.insert(pair<const ArenaSlice, ArenaSlice>(key, value));
         }
-        
-        usedPage.push_back(pagenum);
-        already_in_buf.push_back(*new_page);
+        pageHeapBytes = max(arena.getBytesAllocated() - heapBefore,
+                            arena.getBytesReserved() - arenaCharged) + Page::SIZE;
+        memoryTracker.chargeBytes(arena.getBytesReserved() - arenaCharged);
+        arenaCharged = arena.getBytesReserved();
+        if (!innerRequested)
+            requestInner(1);
+
+        already_in_buf.push_back(std::move(guard));
         numIOs++;
         numUsedBufPages++;
         read_page_num++;
     }
     usedPageNum += read_page_num;
+    const bool lastBlock = usedPageNum >= sum;
+    size_t leftPos = 0;
 
-    for (FileIterator iter = leftfile.begin(); iter != leftfile.end(); ++iter)
+    int outerPos = 0;
+    bool outerRequested = false;
+    while (outerRequested || outerPos < outerPages)
 	{
-        Page *left_new_page;
-        Page p = *iter;
-        //ϵÿζһpage 
-		PageId leftPagenum = p.page_number();
-        bufMgr->readPage(&leftfile, leftPagenum, left_new_page);
-        p = *left_new_page;
+        if (!outerRequested) {
+            memoryTracker.chargeFrames(1);
+            reader.request(&outerfile, outerPos++);
+        }
+        outerRequested = false;
+        PageGuard left_guard = reader.take(LATCH_SHARED);
+        // the next outer page is read ahead while this one is probed, unless
+        // the block left no frame for it
+        if (outerPos < outerPages && memoryTracker.canCharge(1, 0)) {
+            memoryTracker.chargeFrames(1);
+            reader.request(&outerfile, outerPos++);
+            outerRequested = true;
+        }
+        if (!left_guard.isPinned()) {
+            // the page list ends before the count in the file header
+            memoryTracker.releaseFrames(1);
+            continue;
+        }
+        Page& p = left_guard.read();
         numUsedBufPages++;
         numIOs++;
         //ǰҳÿԪ 
         for (PageIterator page_iter = p.begin();page_iter != p.end();++page_iter){
-            string lefttuple = *page_iter;
-            string last, hashString;
-            handle_tuple(hashString, sameName, lefttuple, last, leftTableSchema);
-            if(hashMap.count(hashString) == 1){
-                vector<string> same = hashMap[hashString];
-                for(unsigned int i = 0; i < same.size(); i++){
+            string outertuple = *page_iter;
+            hashString.clear();
+            outerRest.clear();
+            if (blockLeft) {
+                outerKeys.extract(outertuple, hashString, outerRest);
+            } else {
+                outerKeys.extractKey(outertuple, hashString);
+            }
+            const ArenaSlice probe(hashString.data(), hashString.size());
+            const size_t pos = leftPos++;
+            if (tracksOuter && pos == outerMatched.size()) {
+                outerMatched.push_back(false);
+            }
+            if (semiOrAnti && !blockLeft) {
+                // the first match decides, and the joined tuple is never built
+                if (!outerMatched[pos] && hashMap.find(probe) != hashMap.end()) {
+                    outerMatched[pos] = true;
+                    if (joinMode == JOIN_SEMI) {
+                        numResultTuples++;
+                        HeapFileManager::insertTuple(outertuple, resultFile, bufMgr);
+                    }
+                }
+                if (joinMode == JOIN_ANTI && lastBlock && !outerMatched[pos]) {
+                    numResultTuples++;
+                    HeapFileManager::insertTuple(outertuple, resultFile, bufMgr);
+                }
+                continue;
+            }
+            pair<BlockHashMap::iterator, BlockHashMap::iterator> same =
+                hashMap.equal_range(probe);
+            for(BlockHashMap::iterator it = same.first; it != same.second; ++it){
+                if (tracksInner) {
+                    headerOf(it->second)->matched = true;
+                }
+                if (semiOrAnti)
+                    continue;
+                numResultTuples++;
+                if (blockLeft) {
+                    resultString.assign(it->second.data, it->second.length);
+                    resultString.append(outerRest);
+                } else {
+                    resultString.assign(outertuple);
+                    resultString.append(it->second.data, it->second.length);
+                }
+                HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
+            }
+            if (keepOuter) {
+                if (same.first != same.second) {
+                    outerMatched[pos] = true;
+                }
+                if (lastBlock && !outerMatched[pos]) {
                     numResultTuples++;
-                    string temp = same[i];
-                    string resultString = lefttuple.insert(lefttuple.size(), temp);
+                    if (blockLeft) {
+                        resultString.assign(paddedTuple(leftTableSchema, leftKeyAttrNames, outertuple,
+                                                        rightTableSchema, rightKeyAttrNames));
+                        resultString.append(outerRest);
+                    } else {
+                        resultString.assign(outertuple);
+                        resultString.append(nullRest);
+                    }
                     HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
                 }
             }
         }
-        bufMgr->unPinPage(&leftfile, leftPagenum, false);
-
+        memoryTracker.releaseFrames(1);
     }
-    for(unsigned int i = 0; i < already_in_buf.size(); i++){
-        bufMgr->unPinPage(&rightfile, already_in_buf[i].page_number(), false);
+    if (tracksInner && blockLeft) {
+        // left tuples of the block returned by their matches
+        for (BlockHashMap::iterator it = hashMap.begin(); it != hashMap.end(); ++it) {
+            if (headerOf(it->second)->matched != (joinMode == JOIN_SEMI))
+                continue;
+            numResultTuples++;
+            resultString.assign(it->second.data, it->second.length);
+            if (keepLeft) {
+                resultString.append(nullRest);
+            }
+            HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
+        }
+    } else if (keepInner) {
+        // right tuples of the block which no left tuple matched
+        for (BlockHashMap::iterator it = hashMap.begin(); it != hashMap.end(); ++it) {
+            if (headerOf(it->second)->matched)
+                continue;
+            const RecordId& rid = headerOf(it->second)->rid;
+            for (size_t i = 0; i < already_in_buf.size(); ++i) {
+                if (already_in_buf[i].pageNumber() == rid.page_number) {
+                    unmatched = already_in_buf[i].read().getRecord(rid);
+                }
+            }
+            numResultTuples++;
+            resultString.assign(paddedTuple(leftTableSchema, leftKeyAttrNames, unmatched,
+                                            rightTableSchema, rightKeyAttrNames));
+            resultString.append(it->second.data, it->second.length);
+            HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
+        }
     }
-    bufMgr->flushFile(&rightfile);
+    firstBlock = false;
+    // unpin the block of the inner table and drop its hash table in one go
+    memoryTracker.releaseFrames(already_in_buf.size());
     already_in_buf.clear();
+    // the bitmap is complete after the first block and stays for the next ones
+    if (tracksOuter) {
+        const size_t bitmapBytes = (outerMatched.size() + 7) / 8;
+        memoryTracker.chargeBytes(bitmapBytes - bitmapCharged);
+        bitmapCharged = bitmapBytes;
+    }
+    hashMap.clear();
+    arena.reset();
     read_page_num = 0;
     }
 
+    arena.release();
+    memoryTracker.releaseBytes(arenaCharged);
+    memoryTracker.releaseBytes(bitmapCharged);
+    memoryTracker.releaseFrames(1);
+
     isComplete = true;
     return true;
 }
 
-BucketId GraceHashJoinOperator::hash(const string& key) const {
-  std::hash<string> strHash;
-  return strHash(key) % numBuckets;
+// is the attribute an INT attribute of the table?
+static bool hasIntAttr(const TableSchema& tableSchema, const string& attrName) {
+  const int attrNum = tableSchema.getAttrNum(attrName);
+  return attrNum >= 0 && tableSchema.getAttrType(attrNum) == INT;
 }
 
-bool GraceHashJoinOperator::execute(int numAvailableBufPages,
-                                    File& resultFile) {
+// partitions of a table which may hold tuples with the attribute in the
+// range, and for each whether it also holds tuples outside the range
+static vector<int> prunePartitions(const PartitionedTable& table,
+                                   const string& attrName,
+                                   const KeyRange& range,
+                                   vector<bool>& filtered) {
+  const PartitionScheme& scheme = table.getPartitionScheme();
+  vector<int> partitions;
+  filtered.clear();
+  if (attrName.empty() || range.isAll() ||
+      !hasIntAttr(table.getTableSchema(), attrName)) {
+    for (int i = 0; i < scheme.getPartitionCount(); ++i) {
+      partitions.push_back(i);
+      filtered.push_back(false);
+    }
+  } else if (scheme.getAttrName() == attrName) {
+    partitions = scheme.prune(range);
+    for (size_t i = 0; i < partitions.size(); ++i) {
+      filtered.push_back(!scheme.isCovered(partitions[i], range));
+    }
+  } else {
+    // not the partition key: every partition has to be filtered
+    for (int i = 0; i < scheme.getPartitionCount(); ++i) {
+      partitions.push_back(i);
+      filtered.push_back(true);
+    }
+  }
+  return partitions;
+}
+
+void PartitionedTableScanner::setKeyRange(const string& attrName,
+                                          const KeyRange& range) {
+  if (!hasIntAttr(table.getTableSchema(), attrName)) {
+    throw PartitionException(table.getTableSchema().getTableName(),
+                             "no INT attribute " + attrName);
+  }
+  rangeAttrName = attrName;
+  this->range = range;
+}
+
+void PartitionedTableScanner::print(ostream& out,
+                                    const TupleFormatter& formatter) const {
+  const TableSchema& tableSchema = table.getTableSchema();
+  vector<bool> filtered;
+  const vector<int> partitions =
+      prunePartitions(table, rangeAttrName, range, filtered);
+  const int attrNum =
+      rangeAttrName.empty() ? -1 : tableSchema.getAttrNum(rangeAttrName);
+  BufPinScope pinScope(bufMgr, "PARTITIONED_TABLE_SCANNER");
+  OutputBuffer buffer(out);
+  formatter.begin(tableSchema, buffer);
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    badgerdb::File file =
+        badgerdb::File::open(table.getPartition(partitions[i]).filename());
+    for (badgerdb::FileIterator iter = file.begin(); iter != file.end();
+         ++iter) {
+      PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+      badgerdb::Page* buffered_page = &guard.read();
+      for (badgerdb::PageIterator page_iter = buffered_page->begin();
+           page_iter != buffered_page->end(); ++page_iter) {
+        const string tuple = *page_iter;
+        if (filtered[i] &&
+            !range.contains(
+                PartitionScheme::getIntAttr(tuple, tableSchema, attrNum))) {
+          continue;
+        }
+        formatter.format(tuple, tableSchema, buffer);
+      }
+    }
+  }
+  buffer.flush();
+  numScannedPartitions = static_cast<int>(partitions.size());
+}
+
+TopKOperator::TopKOperator(const File& tableFile,
+                           const TableSchema& tableSchema,
+                           BufMgr* bufMgr,
+                           const int limit)
+    : tableFile(tableFile),
+      tableSchema(tableSchema),
+      bufMgr(bufMgr),
+      limit(max(limit, 0)),
+      isComplete(false),
+      numResultTuples(0),
+      numUsedBufPages(0),
+      numIOs(0),
+      numScannedTuples(0),
+      numSortedRuns(0) {
+  // nothing
+}
+
+void TopKOperator::setOrderBy(const vector<SortKey>& orderBy) {
+  SortKeyEncoder::checkSortKeys(tableSchema, orderBy);
+  this->orderBy = orderBy;
+}
+
+bool TopKOperator::execute(int numAvailableBufPages, File& resultFile) {
   if (isComplete)
     return true;
 
   numResultTuples = 0;
   numUsedBufPages = 0;
   numIOs = 0;
-
-  // TODO: Implement the Grace hash join algorithm (NOT required in project 3)
+  numScannedTuples = 0;
+  numSortedRuns = 0;
+  memoryTracker.reset(numAvailableBufPages);
+  BufPinScope pinScope(bufMgr, getOperatorName());
+  if (limit > 0) {
+    if (orderBy.empty()) {
+      executeLimit(resultFile);
+    } else {
+      executeTopK(resultFile);
+    }
+  }
+  numUsedBufPages = memoryTracker.getPeakPages();
 
   isComplete = true;
   return true;
 }
 
+void TopKOperator::executeLimit(File& resultFile) {
+  File file = File::open(tableFile.filename());
+  for (FileIterator iter = file.begin();
+       iter != file.end() && numResultTuples < limit; ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    memoryTracker.chargeFrames(1);
+    numIOs++;
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end() && numResultTuples < limit;
+         ++page_iter) {
+      numScannedTuples++;
+      numResultTuples++;
+      HeapFileManager::insertTuple(*page_iter, resultFile, bufMgr);
+    }
+    memoryTracker.releaseFrames(1);
+  }
+}
+
+// a tuple among the best seen so far, and where it is in the table
+struct TopKEntry {
+  string key;
+  size_t position;
+  string tuple;
+};
+
+// orders entries by key, then by position; the heap keeps the last on top
+static bool topKEntryLess(const TopKEntry& lhs, const TopKEntry& rhs) {
+  const int cmp = lhs.key.compare(rhs.key);
+  return cmp < 0 || (cmp == 0 && lhs.position < rhs.position);
+}
+
+static bool topKPositionLess(const TopKEntry& lhs, const TopKEntry& rhs) {
+  return lhs.position < rhs.position;
+}
+
+static size_t topKEntryBytes(const TopKEntry& entry) {
+  return sizeof(TopKEntry) + entry.key.size() + entry.tuple.size();
+}
+
+// a tuple to sort once the heap is given up: the length of its ORDER BY
+// encoding, the encoding, then the tuple
+static void makeTopKRecord(const string& key,
+                           const string& tuple,
+                           string& record) {
+  record.clear();
+  record.push_back(static_cast<char>(key.size() >> 8));
+  record.push_back(static_cast<char>(key.size()));
+  record += key;
+  record += tuple;
+}
+
+static size_t topKRecordKeyLength(const string& record) {
+  return (static_cast<size_t>(static_cast<unsigned char>(record[0])) << 8) |
+         static_cast<unsigned char>(record[1]);
+}
+
+// orders records by their encodings, which are ordered bytewise
+static bool topKRecordLess(const string& lhs, const string& rhs) {
+  return lhs.compare(2, topKRecordKeyLength(lhs), rhs, 2,
+                     topKRecordKeyLength(rhs)) < 0;
+}
+
+void TopKOperator::executeTopK(File& resultFile) {
+  const SortKeyEncoder encoder(tableSchema, orderBy);
+  const size_t k = static_cast<size_t>(limit);
+  vector<TopKEntry> heap;
+  size_t heapBytes = 0;
+  // takes over if the k best tuples do not fit in memory
+  SpillManager spill(bufMgr);
+  std::unique_ptr<ExternalSorter> sorter;
+  string record;
+
+  File file = File::open(tableFile.filename());
+  TopKEntry entry;
+  entry.position = 0;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    memoryTracker.chargeFrames(1);
+    numIOs++;
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end(); ++page_iter, ++entry.position) {
+      numScannedTuples++;
+      entry.tuple = *page_iter;
+      entry.key.clear();
+      encoder.encode(entry.tuple, entry.key);
+      if (sorter) {
+        makeTopKRecord(entry.key, entry.tuple, record);
+        sorter->add(record);
+        continue;
+      }
+      if (heap.size() == k) {
+        // the worst of the k best is on top
+        if (!topKEntryLess(entry, heap.front())) {
+          continue;
+        }
+        pop_heap(heap.begin(), heap.end(), topKEntryLess);
+        heapBytes -= topKEntryBytes(heap.back());
+        memoryTracker.releaseBytes(topKEntryBytes(heap.back()));
+        heap.pop_back();
+      }
+      const size_t bytes = topKEntryBytes(entry);
+      if (!memoryTracker.canCharge(0, bytes)) {
+        // sort what is left of the table along with the heap, which keeps
+        // its tuples in the order of the table for ties
+        sort(heap.begin(), heap.end(), topKPositionLess);
+        memoryTracker.releaseBytes(heapBytes);
+        heapBytes = 0;
+        sorter.reset(new ExternalSorter(&spill, bufMgr, &memoryTracker,
+                                        topKRecordLess));
+        for (size_t i = 0; i < heap.size(); ++i) {
+          makeTopKRecord(heap[i].key, heap[i].tuple, record);
+          sorter->add(record);
+        }
+        heap.clear();
+        makeTopKRecord(entry.key, entry.tuple, record);
+        sorter->add(record);
+        continue;
+      }
+      memoryTracker.chargeBytes(bytes);
+      heapBytes += bytes;
+      heap.push_back(entry);
+      push_heap(heap.begin(), heap.end(), topKEntryLess);
+    }
+    memoryTracker.releaseFrames(1);
+  }
+
+  if (sorter) {
+    File* sorted = sorter->finish();
+    numIOs += sorter->getNumIOs();
+    numSortedRuns = sorter->getNumRuns();
+    memoryTracker.chargeFrames(1);
+    SpillReader reader(&spill, sorted);
+    while (numResultTuples < limit && reader.next(record)) {
+      numResultTuples++;
+      HeapFileManager::insertTuple(
+          record.substr(2 + topKRecordKeyLength(record)), resultFile, bufMgr);
+    }
+    numIOs += reader.getNumPagesRead();
+    reader.close();
+    memoryTracker.releaseFrames(1);
+    return;
+  }
+  sort_heap(heap.begin(), heap.end(), topKEntryLess);
+  for (size_t i = 0; i < heap.size(); ++i) {
+    numResultTuples++;
+    HeapFileManager::insertTuple(heap[i].tuple, resultFile, bufMgr);
+  }
+  memoryTracker.releaseBytes(heapBytes);
+}
+
+void TopKOperator::printRunningStats() const {
+  cout << "# Result Tuples: " << numResultTuples << endl;
+  cout << "# Used Buffer Pages: " << numUsedBufPages << endl;
+  cout << "# I/Os: " << numIOs << endl;
+  cout << "# Scanned Tuples: " << numScannedTuples << endl;
+  cout << "# Sorted Runs: " << numSortedRuns << endl;
+}
+
+string WindowFunction::toString() const {
+  stringstream ss;
+  switch (type) {
+    case WINDOW_ROW_NUMBER:
+      ss << "ROW_NUMBER()";
+      break;
+    case WINDOW_RANK:
+      ss << "RANK()";
+      break;
+    case WINDOW_SUM:
+      ss << "SUM(" << attrName << ")";
+      break;
+    case WINDOW_AVG:
+      ss << "AVG(" << attrName << ")";
+      break;
+    case WINDOW_LAG:
+      ss << "LAG(" << attrName << ", " << offset << ")";
+      break;
+    case WINDOW_LEAD:
+      ss << "LEAD(" << attrName << ", " << offset << ")";
+      break;
+  }
+  ss << " AS " << resultName;
+  return ss.str();
+}
+
+// does the function read a tuple before or after the current one?
+static bool isOffsetFunction(const WindowFunction& function) {
+  return function.type == WINDOW_LAG || function.type == WINDOW_LEAD;
+}
+
+WindowOperator::WindowOperator(const File& tableFile,
+                               const TableSchema& tableSchema,
+                               BufMgr* bufMgr,
+                               const vector<string>& partitionBy,
+                               const vector<SortKey>& orderBy,
+                               const vector<WindowFunction>& functions)
+    : tableFile(tableFile),
+      tableSchema(tableSchema),
+      bufMgr(bufMgr),
+      partitionBy(partitionBy),
+      orderBy(orderBy),
+      functions(functions),
+      resultTableSchema(tableSchema.getTableName()),
+      isComplete(false),
+      numResultTuples(0),
+      numUsedBufPages(0),
+      numIOs(0),
+      numSortedRuns(0),
+      numPartitions(0),
+      inputSorted(false) {
+  vector<SortKey> partitionKeys;
+  for (size_t i = 0; i < partitionBy.size(); ++i) {
+    partitionKeys.push_back(SortKey::asc(partitionBy[i]));
+  }
+  SortKeyEncoder::checkSortKeys(tableSchema, partitionKeys);
+  SortKeyEncoder::checkSortKeys(tableSchema, orderBy);
+
+  vector<Attribute> attrs;
+  for (int k = 0; k < tableSchema.getAttrCount(); ++k) {
+    attrs.push_back(Attribute(
+        tableSchema.getAttrName(k), tableSchema.getAttrType(k),
+        tableSchema.getAttrMaxSize(k), tableSchema.isAttrNotNull(k),
+        tableSchema.isAttrUnique(k)));
+  }
+  for (size_t i = 0; i < functions.size(); ++i) {
+    const WindowFunction& function = functions[i];
+    const string text = function.toString();
+    const bool hasArg =
+        function.type != WINDOW_ROW_NUMBER && function.type != WINDOW_RANK;
+    const int attrNum = hasArg ? tableSchema.getAttrNum(function.attrName) : -1;
+    if (hasArg && attrNum < 0) {
+      throw WindowException(text, tableSchema.getTableName() +
+                                      " has no attribute " +
+                                      function.attrName);
+    }
+    if ((function.type == WINDOW_SUM || function.type == WINDOW_AVG) &&
+        tableSchema.getAttrType(attrNum) != INT) {
+      throw WindowException(text,
+                            function.attrName + " is not an INT attribute");
+    }
+    if (isOffsetFunction(function) && function.offset < 1) {
+      throw WindowException(text, "the offset is not positive");
+    }
+    for (size_t k = 0; k < attrs.size(); ++k) {
+      if (attrs[k].attrName == function.resultName) {
+        throw WindowException(text, "an attribute is already named " +
+                                        function.resultName);
+      }
+    }
+    if (isOffsetFunction(function)) {
+      attrs.push_back(Attribute(function.resultName,
+                                tableSchema.getAttrType(attrNum),
+                                tableSchema.getAttrMaxSize(attrNum)));
+    } else {
+      attrs.push_back(Attribute(function.resultName, INT, 4));
+    }
+  }
+  resultTableSchema = TableSchema("TEMP_TABLE", attrs, true);
+}
+
+// a tuple to sort: the lengths of its PARTITION BY and ORDER BY encodings,
+// the encodings, then the tuple
+static void makeWindowRecord(const string& partitionKey,
+                             const string& orderKey,
+                             const string& tuple,
+                             string& record) {
+  record.clear();
+  record.push_back(static_cast<char>(partitionKey.size() >> 8));
+  record.push_back(static_cast<char>(partitionKey.size()));
+  record.push_back(static_cast<char>(orderKey.size() >> 8));
+  record.push_back(static_cast<char>(orderKey.size()));
+  record += partitionKey;
+  record += orderKey;
+  record += tuple;
+}
+
+static size_t windowRecordLength(const string& record, const size_t at) {
+  return (static_cast<size_t>(static_cast<unsigned char>(record[at])) << 8) |
+         static_cast<unsigned char>(record[at + 1]);
+}
+
+static void parseWindowRecord(const string& record,
+                              string& partitionKey,
+                              string& orderKey,
+                              string& tuple) {
+  const size_t partitionLength = windowRecordLength(record, 0);
+  const size_t orderLength = windowRecordLength(record, 2);
+  partitionKey.assign(record, 4, partitionLength);
+  orderKey.assign(record, 4 + partitionLength, orderLength);
+  tuple.assign(record, 4 + partitionLength + orderLength, string::npos);
+}
+
+// orders records by their encodings, which are ordered bytewise
+static bool windowRecordLess(const string& lhs, const string& rhs) {
+  const size_t lhsLength =
+      windowRecordLength(lhs, 0) + windowRecordLength(lhs, 2);
+  const size_t rhsLength =
+      windowRecordLength(rhs, 0) + windowRecordLength(rhs, 2);
+  return lhs.compare(4, lhsLength, rhs, 4, rhsLength) < 0;
+}
+
+// reads the records of the window operator in order, one pinned page at a
+// time: from the sorted file, or from a table already in order, making the
+// record of each tuple as it is read
+class WindowInput {
+ public:
+  WindowInput(SpillManager* spill, File* sorted)
+      : sorted(new SpillReader(spill, sorted)),
+        bufMgr(NULL),
+        table(NULL),
+        partitionEncoder(NULL),
+        orderEncoder(NULL),
+        numPagesRead(0) {}
+
+  WindowInput(BufMgr* bufMgr,
+              File* table,
+              const SortKeyEncoder* partitionEncoder,
+              const SortKeyEncoder* orderEncoder)
+      : bufMgr(bufMgr),
+        table(table),
+        partitionEncoder(partitionEncoder),
+        orderEncoder(orderEncoder),
+        iter(table->begin()),
+        numPagesRead(0) {}
+
+  bool next(string& record) {
+    if (sorted) {
+      return sorted->next(record);
+    }
+    while (!page.isPinned() || tuple == page.read().end()) {
+      if (page.isPinned()) {
+        page.release();
+        ++iter;
+      }
+      if (iter == table->end()) {
+        return false;
+      }
+      page = bufMgr->fetch(table, iter.page_number(), LATCH_SHARED);
+      ++numPagesRead;
+      tuple = page.read().begin();
+    }
+    const string data = *tuple;
+    ++tuple;
+    partitionKey.clear();
+    orderKey.clear();
+    partitionEncoder->encode(data, partitionKey);
+    orderEncoder->encode(data, orderKey);
+    makeWindowRecord(partitionKey, orderKey, data, record);
+    return true;
+  }
+
+  size_t getNumPagesRead() const {
+    return sorted ? sorted->getNumPagesRead() : numPagesRead;
+  }
+
+  void close() {
+    if (sorted) {
+      sorted->close();
+    }
+    page.release();
+  }
+
+ private:
+  std::unique_ptr<SpillReader> sorted;
+  BufMgr* bufMgr;
+  File* table;
+  const SortKeyEncoder* partitionEncoder;
+  const SortKeyEncoder* orderEncoder;
+  FileIterator iter;
+  PageGuard page;
+  PageIterator tuple;
+  string partitionKey, orderKey;
+  size_t numPagesRead;
+};
+
+// appends an INT attribute, keeping the low 32 bits
+static void appendIntAttr(const std::int64_t value, string& out) {
+  const std::uint32_t bits = static_cast<std::uint32_t>(value);
+  out.push_back(static_cast<char>(bits >> 24));
+  out.push_back(static_cast<char>(bits >> 16));
+  out.push_back(static_cast<char>(bits >> 8));
+  out.push_back(static_cast<char>(bits));
+}
+
+// appends an attribute of a tuple, padded as in a tuple
+static void appendAttr(const JoinKeyExtractor& extractor,
+                       const string& tuple,
+                       string& scratch,
+                       string& out) {
+  scratch.clear();
+  extractor.extractKey(tuple, scratch);
+  out += scratch;
+  out.append((4 - scratch.size() % 4) % 4, '0');
+}
+
+// appends the zero or empty value of an attribute
+static void appendEmptyAttr(const DataType type,
+                            const size_t maxSize,
+                            string& out) {
+  switch (type) {
+    case INT:
+      out.append(4, '\0');
+      break;
+    case CHAR:
+      out.append(maxSize + (4 - maxSize % 4) % 4, '0');
+      break;
+    case VARCHAR:
+      out.push_back('\0');
+      out.append(3, '0');
+      break;
+  }
+}
+
+// the value of an INT attribute of a tuple
+static std::int64_t intAttr(const JoinKeyExtractor& extractor,
+                            const string& tuple,
+                            string& scratch) {
+  scratch.clear();
+  extractor.extractKey(tuple, scratch);
+  if (scratch.size() < 4) {
+    return 0;
+  }
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(scratch.data());
+  return static_cast<std::int32_t>(
+      (static_cast<std::uint32_t>(bytes[0]) << 24) |
+      (static_cast<std::uint32_t>(bytes[1]) << 16) |
+      (static_cast<std::uint32_t>(bytes[2]) << 8) |
+      static_cast<std::uint32_t>(bytes[3]));
+}
+
+bool WindowOperator::execute(int numAvailableBufPages, File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  numSortedRuns = 0;
+  numPartitions = 0;
+  memoryTracker.reset(numAvailableBufPages);
+  BufPinScope pinScope(bufMgr, getOperatorName());
+  // the sorted table, removed when the operator ends or throws
+  SpillManager spill(bufMgr);
+
+  // sort by the partition, then by the ORDER BY attributes left
+  vector<SortKey> partitionKeys, orderKeys;
+  for (size_t i = 0; i < partitionBy.size(); ++i) {
+    partitionKeys.push_back(SortKey::asc(partitionBy[i]));
+  }
+  for (size_t i = 0; i < orderBy.size(); ++i) {
+    if (!count(partitionBy.begin(), partitionBy.end(), orderBy[i].attrName)) {
+      orderKeys.push_back(orderBy[i]);
+    }
+  }
+  const SortKeyEncoder partitionEncoder(tableSchema, partitionKeys);
+  const SortKeyEncoder orderEncoder(tableSchema, orderKeys);
+  string record, partitionKey, orderKey, tuple;
+  File table = File::open(tableFile.filename());
+  File* sorted = NULL;
+  if (!inputSorted) {
+    ExternalSorter sorter(&spill, bufMgr, &memoryTracker, windowRecordLess);
+    for (FileIterator iter = table.begin(); iter != table.end(); ++iter) {
+      PageGuard guard = bufMgr->fetch(&table, iter.page_number(), LATCH_SHARED);
+      memoryTracker.chargeFrames(1);
+      numIOs++;
+      for (PageIterator page_iter = guard.read().begin();
+           page_iter != guard.read().end(); ++page_iter) {
+        tuple = *page_iter;
+        partitionKey.clear();
+        orderKey.clear();
+        partitionEncoder.encode(tuple, partitionKey);
+        orderEncoder.encode(tuple, orderKey);
+        makeWindowRecord(partitionKey, orderKey, tuple, record);
+        sorter.add(record);
+      }
+      memoryTracker.releaseFrames(1);
+    }
+    sorted = sorter.finish();
+    numIOs += sorter.getNumIOs();
+    numSortedRuns = sorter.getNumRuns();
+  }
+
+  // a reader for the current tuple, and one for each distinct offset of LAG
+  // and of LEAD, which stays that many tuples behind or ahead
+  vector<int> lagOffsets, leadOffsets;
+  vector<size_t> readerOf(functions.size(), 0);
+  vector<JoinKeyExtractor> args;
+  for (size_t i = 0; i < functions.size(); ++i) {
+    const WindowFunction& function = functions[i];
+    vector<string> argNames;
+    if (function.type != WINDOW_ROW_NUMBER && function.type != WINDOW_RANK) {
+      argNames.push_back(function.attrName);
+    }
+    args.push_back(JoinKeyExtractor(tableSchema, argNames));
+    if (isOffsetFunction(function)) {
+      vector<int>& offsets =
+          function.type == WINDOW_LAG ? lagOffsets : leadOffsets;
+      readerOf[i] = find(offsets.begin(), offsets.end(), function.offset) -
+                    offsets.begin();
+      if (readerOf[i] == offsets.size()) {
+        offsets.push_back(function.offset);
+      }
+    }
+  }
+  const int numReaders =
+      static_cast<int>(1 + lagOffsets.size() + leadOffsets.size());
+  memoryTracker.chargeFrames(numReaders);
+  vector<std::unique_ptr<WindowInput> > readers;
+  for (int i = 0; i < numReaders; ++i) {
+    readers.push_back(std::unique_ptr<WindowInput>(
+        inputSorted ? new WindowInput(bufMgr, &table, &partitionEncoder,
+                                      &orderEncoder)
+                    : new WindowInput(&spill, sorted)));
+  }
+  WindowInput& current = *readers[0];
+  // LEAD readers start their offset ahead
+  for (size_t k = 0; k < leadOffsets.size(); ++k) {
+    WindowInput& reader = *readers[1 + lagOffsets.size() + k];
+    for (int skipped = 0; skipped < leadOffsets[k] && reader.next(record);
+         ++skipped) {
+    }
+  }
+
+  vector<string> lagTuples(lagOffsets.size());
+  vector<string> leadTuples(leadOffsets.size());
+  vector<bool> leadFound(leadOffsets.size());
+  vector<std::int64_t> sums(functions.size());
+  string previousPartition, previousOrder, otherPartition, otherOrder;
+  string scratch, resultString;
+  size_t index = 0;
+  size_t partitionStart = 0;
+  std::int64_t rowNumber = 0;
+  std::int64_t rank = 0;
+  while (current.next(record)) {
+    parseWindowRecord(record, partitionKey, orderKey, tuple);
+    if (inputSorted && index > 0 &&
+        (partitionKey < previousPartition ||
+         (partitionKey == previousPartition && orderKey < previousOrder))) {
+      for (int i = 0; i < numReaders; ++i) {
+        readers[i]->close();
+      }
+      throw WindowException(getWindowText(),
+                            "the table is not in this order");
+    }
+    const bool newPartition = index == 0 || partitionKey != previousPartition;
+    if (newPartition) {
+      numPartitions++;
+      partitionStart = index;
+      rowNumber = 0;
+      fill(sums.begin(), sums.end(), 0);
+    }
+    rowNumber++;
+    if (newPartition || orderKey != previousOrder) {
+      rank = rowNumber;
+    }
+    for (size_t k = 0; k < lagOffsets.size(); ++k) {
+      if (index >= static_cast<size_t>(lagOffsets[k]) &&
+          readers[1 + k]->next(record)) {
+        parseWindowRecord(record, otherPartition, otherOrder, lagTuples[k]);
+      }
+    }
+    for (size_t k = 0; k < leadOffsets.size(); ++k) {
+      leadFound[k] = readers[1 + lagOffsets.size() + k]->next(record);
+      if (leadFound[k]) {
+        parseWindowRecord(record, otherPartition, otherOrder, leadTuples[k]);
+        leadFound[k] = otherPartition == partitionKey;
+      }
+    }
+
+    resultString.assign(tuple);
+    for (size_t i = 0; i < functions.size(); ++i) {
+      const WindowFunction& function = functions[i];
+      switch (function.type) {
+        case WINDOW_ROW_NUMBER:
+          appendIntAttr(rowNumber, resultString);
+          break;
+        case WINDOW_RANK:
+          appendIntAttr(rank, resultString);
+          break;
+        case WINDOW_SUM:
+          sums[i] += intAttr(args[i], tuple, scratch);
+          appendIntAttr(sums[i], resultString);
+          break;
+        case WINDOW_AVG:
+          sums[i] += intAttr(args[i], tuple, scratch);
+          appendIntAttr(sums[i] / rowNumber, resultString);
+          break;
+        case WINDOW_LAG:
+        case WINDOW_LEAD: {
+          const bool lag = function.type == WINDOW_LAG;
+          const bool found =
+              lag ? index - partitionStart >=
+                        static_cast<size_t>(function.offset)
+                  : leadFound[readerOf[i]];
+          if (found) {
+            appendAttr(args[i],
+                       lag ? lagTuples[readerOf[i]] : leadTuples[readerOf[i]],
+                       scratch, resultString);
+          } else {
+            const int attrNum = tableSchema.getAttrNum(function.attrName);
+            appendEmptyAttr(tableSchema.getAttrType(attrNum),
+                            tableSchema.getAttrMaxSize(attrNum),
+                            resultString);
+          }
+          break;
+        }
+      }
+    }
+    numResultTuples++;
+    HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
+    previousPartition.swap(partitionKey);
+    previousOrder.swap(orderKey);
+    index++;
+  }
+  for (int i = 0; i < numReaders; ++i) {
+    numIOs += readers[i]->getNumPagesRead();
+    readers[i]->close();
+  }
+  memoryTracker.releaseFrames(numReaders);
+  numUsedBufPages = memoryTracker.getPeakPages();
+
+  isComplete = true;
+  return true;
+}
+
+string WindowOperator::getWindowText() const {
+  string text = "OVER (";
+  if (!partitionBy.empty()) {
+    text += "PARTITION BY " + partitionBy[0];
+    for (size_t i = 1; i < partitionBy.size(); ++i) {
+      text += ", " + partitionBy[i];
+    }
+  }
+  if (!orderBy.empty()) {
+    text += string(partitionBy.empty() ? "" : " ") + "ORDER BY " +
+            SortKeyEncoder::toString(orderBy);
+  }
+  return text + ")";
+}
+
+void WindowOperator::printRunningStats() const {
+  cout << "# Result Tuples: " << numResultTuples << endl;
+  cout << "# Used Buffer Pages: " << numUsedBufPages << endl;
+  cout << "# I/Os: " << numIOs << endl;
+  cout << "# Sorted Runs: " << numSortedRuns << endl;
+  cout << "# Partitions: " << numPartitions << endl;
+}
+
+PartitionWiseJoinOperator::PartitionWiseJoinOperator(
+    PartitionedTable& leftTable,
+    PartitionedTable& rightTable,
+    const Catalog* catalog,
+    BufMgr* bufMgr)
+    : leftTable(leftTable),
+      rightTable(rightTable),
+      catalog(catalog),
+      bufMgr(bufMgr),
+      resultTableSchema(JoinOperator::createResultTableSchema(
+          leftTable.getTableSchema(), rightTable.getTableSchema())),
+      leftKeyAttrNames(JoinKeyExtractor::naturalKeyAttrNames(
+          leftTable.getTableSchema(), rightTable.getTableSchema())),
+      rightKeyAttrNames(leftKeyAttrNames),
+      range(KeyRange::all()),
+      isComplete(false),
+      numResultTuples(0),
+      numUsedBufPages(0),
+      numIOs(0),
+      numPartitionJoins(0),
+      numPrunedPartitions(0) {
+  // nothing
+}
+
+void PartitionWiseJoinOperator::setKeyRange(const string& attrName,
+                                            const KeyRange& range) {
+  if (!hasIntAttr(leftTable.getTableSchema(), attrName) &&
+      !hasIntAttr(rightTable.getTableSchema(), attrName)) {
+    throw PartitionException(leftTable.getTableSchema().getTableName(),
+                             "no INT attribute " + attrName);
+  }
+  rangeAttrName = attrName;
+  this->range = range;
+}
+
+void PartitionWiseJoinOperator::setJoinKeys(
+    const vector<string>& leftKeyAttrNames,
+    const vector<string>& rightKeyAttrNames) {
+  JoinKeyExtractor::checkKeyAttrs(leftTable.getTableSchema(), leftKeyAttrNames,
+                                  rightTable.getTableSchema(),
+                                  rightKeyAttrNames);
+  this->leftKeyAttrNames = leftKeyAttrNames;
+  this->rightKeyAttrNames = rightKeyAttrNames;
+  resultTableSchema = JoinOperator::createResultTableSchema(
+      leftTable.getTableSchema(), rightTable.getTableSchema(),
+      rightKeyAttrNames);
+}
+
+bool PartitionWiseJoinOperator::isCoPartitioned() const {
+  const PartitionScheme& leftScheme = leftTable.getPartitionScheme();
+  const PartitionScheme& rightScheme = rightTable.getPartitionScheme();
+  if (!leftScheme.isCompatibleWith(rightScheme)) {
+    return false;
+  }
+  // the partition keys have to be a pair of join attributes, stored the
+  // same way
+  const TableSchema& leftSchema = leftTable.getTableSchema();
+  const TableSchema& rightSchema = rightTable.getTableSchema();
+  for (size_t i = 0; i < leftKeyAttrNames.size(); ++i) {
+    if (leftKeyAttrNames[i] == leftScheme.getAttrName() &&
+        rightKeyAttrNames[i] == rightScheme.getAttrName()) {
+      const int leftAttr = leftSchema.getAttrNum(leftKeyAttrNames[i]);
+      const int rightAttr = rightSchema.getAttrNum(rightKeyAttrNames[i]);
+      return leftSchema.getAttrMaxSize(leftAttr) ==
+             rightSchema.getAttrMaxSize(rightAttr);
+    }
+  }
+  return false;
+}
+
+vector<File*> PartitionWiseJoinOperator::selectPartitions(
+    PartitionedTable& table,
+    SpillManager& spill,
+    vector<int>& partitions) {
+  const TableSchema& tableSchema = table.getTableSchema();
+  vector<bool> filtered;
+  partitions = prunePartitions(table, rangeAttrName, range, filtered);
+  numPrunedPartitions += table.getPartitionCount() - partitions.size();
+  vector<File*> files;
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    File& partition = table.getPartition(partitions[i]);
+    if (!filtered[i]) {
+      files.push_back(&partition);
+      continue;
+    }
+    // copy the tuples in the range into a temporary file
+    const int attrNum = tableSchema.getAttrNum(rangeAttrName);
+    File* copy = spill.create("partition");
+    SpillWriter writer(&spill, copy);
+    for (FileIterator iter = partition.begin(); iter != partition.end();
+         ++iter) {
+      PageGuard guard =
+          bufMgr->fetch(&partition, iter.page_number(), LATCH_SHARED);
+      numIOs++;
+      for (PageIterator page_iter = guard.read().begin();
+           page_iter != guard.read().end(); ++page_iter) {
+        const string tuple = *page_iter;
+        if (range.contains(
+                PartitionScheme::getIntAttr(tuple, tableSchema, attrNum))) {
+          writer.append(tuple);
+        }
+      }
+    }
+    writer.close();
+    numIOs += spill.getNumPages(copy);
+    files.push_back(copy);
+  }
+  return files;
+}
+
+bool PartitionWiseJoinOperator::execute(int numAvailableBufPages,
+                                        File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  numPartitionJoins = 0;
+  numPrunedPartitions = 0;
+  // filtered copies of partitions, removed when the join ends or throws
+  SpillManager spill(bufMgr);
+  vector<int> leftPartitions, rightPartitions;
+  const vector<File*> leftFiles =
+      selectPartitions(leftTable, spill, leftPartitions);
+  const vector<File*> rightFiles =
+      selectPartitions(rightTable, spill, rightPartitions);
+  const bool coPartitioned = isCoPartitioned();
+  for (size_t i = 0; i < leftFiles.size(); ++i) {
+    for (size_t j = 0; j < rightFiles.size(); ++j) {
+      // matching tuples of co-partitioned tables share the partition number
+      if (coPartitioned && leftPartitions[i] != rightPartitions[j]) {
+        continue;
+      }
+      NestedLoopJoinOperator join(*leftFiles[i], *rightFiles[j],
+                                  leftTable.getTableSchema(),
+                                  rightTable.getTableSchema(), catalog, bufMgr);
+      join.setJoinKeys(leftKeyAttrNames, rightKeyAttrNames);
+      join.execute(numAvailableBufPages, resultFile);
+      numResultTuples += join.getNumResultTuples();
+      numIOs += join.getNumIOs();
+      numUsedBufPages = max(numUsedBufPages, join.getNumUsedBufPages());
+      ++numPartitionJoins;
+    }
+  }
+
+  isComplete = true;
+  return true;
+}
+
+void PartitionWiseJoinOperator::printRunningStats() const {
+  cout << "# Result Tuples: " << numResultTuples << endl;
+  cout << "# Used Buffer Pages: " << numUsedBufPages << endl;
+  cout << "# I/Os: " << numIOs << endl;
+  cout << "# Partition Joins: " << numPartitionJoins << endl;
+  cout << "# Pruned Partitions: " << numPrunedPartitions << endl;
+}
+
+string BandPredicate::toString() const {
+  stringstream ss;
+  if (hasLow && hasHigh && low == high) {
+    ss << leftAttrName << " = " << rightAttrName;
+    if (low != 0) {
+      ss << (low > 0 ? " + " : " - ") << (low > 0 ? low : -low);
+    }
+  } else if (hasLow && hasHigh) {
+    ss << leftAttrName << " BETWEEN " << rightAttrName
+       << (low >= 0 ? " + " : " - ") << (low >= 0 ? low : -low) << " AND "
+       << rightAttrName << (high >= 0 ? " + " : " - ")
+       << (high >= 0 ? high : -high);
+  } else if (hasLow) {
+    ss << leftAttrName << " >= " << rightAttrName
+       << (low >= 0 ? " + " : " - ") << (low >= 0 ? low : -low);
+  } else if (hasHigh) {
+    ss << leftAttrName << " <= " << rightAttrName
+       << (high >= 0 ? " + " : " - ") << (high >= 0 ? high : -high);
+  } else {
+    ss << "TRUE";
+  }
+  return ss.str();
+}
+
+BandJoinOperator::BandJoinOperator(const File& leftTableFile,
+                                   const File& rightTableFile,
+                                   const TableSchema& leftTableSchema,
+                                   const TableSchema& rightTableSchema,
+                                   const Catalog* catalog,
+                                   BufMgr* bufMgr,
+                                   const BandPredicate& predicate)
+    : JoinOperator(leftTableFile,
+                   rightTableFile,
+                   leftTableSchema,
+                   rightTableSchema,
+                   catalog,
+                   bufMgr),
+      predicate(predicate),
+      numSortedRuns(0),
+      numBlocks(0) {
+  if (!hasIntAttr(leftTableSchema, predicate.leftAttrName)) {
+    throw JoinPredicateException(
+        predicate.toString(), leftTableSchema.getTableName() +
+                                  " has no INT attribute " +
+                                  predicate.leftAttrName);
+  }
+  if (!hasIntAttr(rightTableSchema, predicate.rightAttrName)) {
+    throw JoinPredicateException(
+        predicate.toString(), rightTableSchema.getTableName() +
+                                  " has no INT attribute " +
+                                  predicate.rightAttrName);
+  }
+  updateResultTableSchema();
+}
+
+void BandJoinOperator::updateResultTableSchema() {
+  resultTableSchema =
+      createConcatenatedTableSchema(leftTableSchema, rightTableSchema);
+}
+
+// orders tuples by an INT attribute
+struct IntAttrLess {
+  const TableSchema* tableSchema;
+  int attrNum;
+
+  bool operator()(const string& lhs, const string& rhs) const {
+    return PartitionScheme::getIntAttr(lhs, *tableSchema, attrNum) <
+           PartitionScheme::getIntAttr(rhs, *tableSchema, attrNum);
+  }
+};
+
+// a left tuple of a block and its join value
+struct BandEntry {
+  std::int64_t key;
+  string tuple;
+};
+
+static bool bandEntryBelow(const BandEntry& entry, const std::int64_t key) {
+  return entry.key < key;
+}
+
+bool BandJoinOperator::execute(int numAvailableBufPages, File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  numSortedRuns = 0;
+  numBlocks = 0;
+  memoryTracker.reset(numAvailableBufPages);
+  BufPinScope pinScope(bufMgr, getOperatorName());
+  // sorted runs, removed when the join ends or throws
+  SpillManager spill(bufMgr);
+
+  const int leftAttr = leftTableSchema.getAttrNum(predicate.leftAttrName);
+  const int rightAttr = rightTableSchema.getAttrNum(predicate.rightAttrName);
+  const IntAttrLess leftLess = {&leftTableSchema, leftAttr};
+  const IntAttrLess rightLess = {&rightTableSchema, rightAttr};
+
+  ExternalSorter leftSorter(&spill, bufMgr, &memoryTracker, leftLess);
+  leftSorter.addFile(leftTableFile);
+  File* left = leftSorter.finish();
+  numIOs += leftSorter.getNumIOs();
+  numSortedRuns += leftSorter.getNumRuns();
+
+  ExternalSorter rightSorter(&spill, bufMgr, &memoryTracker, rightLess);
+  rightSorter.addFile(rightTableFile);
+  File* right = rightSorter.finish();
+  numIOs += rightSorter.getNumIOs();
+  numSortedRuns += rightSorter.getNumRuns();
+  // join value at the start of each page of the sorted right table
+  vector<std::int64_t> rightHeads;
+  for (size_t i = 0; i < rightSorter.getPageHeads().size(); ++i) {
+    rightHeads.push_back(PartitionScheme::getIntAttr(
+        rightSorter.getPageHeads()[i], rightTableSchema, rightAttr));
+  }
+
+  // a page for each reader and one for the result
+  memoryTracker.chargeFrames(3);
+  SpillReader leftReader(&spill, left);
+  SpillReader rightReader(&spill, right);
+  vector<BandEntry> block;
+  string tuple, rightTuple, resultString;
+  bool more = leftReader.next(tuple);
+  while (more) {
+    // as many left tuples as fit next to the pinned pages
+    size_t blockBytes = 0;
+    block.clear();
+    do {
+      const size_t bytes = sizeof(BandEntry) + tuple.size();
+      if (!block.empty() && !memoryTracker.canCharge(0, bytes)) {
+        break;
+      }
+      memoryTracker.chargeBytes(bytes);
+      blockBytes += bytes;
+      BandEntry entry = {
+          PartitionScheme::getIntAttr(tuple, leftTableSchema, leftAttr), tuple};
+      block.push_back(entry);
+      more = leftReader.next(tuple);
+    } while (more);
+    ++numBlocks;
+
+    // right values which can match a left value of the block
+    const bool boundedBelow = predicate.hasHigh;
+    const bool boundedAbove = predicate.hasLow;
+    const std::int64_t rightLow = block.front().key - predicate.high;
+    const std::int64_t rightHigh = block.back().key - predicate.low;
+    // start on the last page beginning below the lowest value, which may
+    // end with it
+    size_t firstPage = 0;
+    if (boundedBelow) {
+      const size_t above =
+          lower_bound(rightHeads.begin(), rightHeads.end(), rightLow) -
+          rightHeads.begin();
+      firstPage = above > 0 ? above - 1 : 0;
+    }
+    rightReader.seek(firstPage);
+    while (rightReader.next(rightTuple)) {
+      const std::int64_t rightKey = PartitionScheme::getIntAttr(
+          rightTuple, rightTableSchema, rightAttr);
+      if (boundedBelow && rightKey < rightLow) {
+        continue;
+      }
+      if (boundedAbove && rightKey > rightHigh) {
+        break;
+      }
+      // left values from right + low to right + high
+      vector<BandEntry>::const_iterator it = block.begin();
+      if (predicate.hasLow) {
+        it = lower_bound(block.begin(), block.end(), rightKey + predicate.low,
+                         bandEntryBelow);
+      }
+      for (; it != block.end() &&
+             (!predicate.hasHigh || it->key <= rightKey + predicate.high);
+           ++it) {
+        numResultTuples++;
+        resultString.assign(it->tuple);
+        resultString.append(rightTuple);
+        HeapFileManager::insertTuple(resultString, resultFile, bufMgr);
+      }
+    }
+    memoryTracker.releaseBytes(blockBytes);
+  }
+  numIOs += leftReader.getNumPagesRead() + rightReader.getNumPagesRead();
+  leftReader.close();
+  rightReader.close();
+  memoryTracker.releaseFrames(3);
+  numUsedBufPages = memoryTracker.getPeakPages();
+
+  isComplete = true;
+  return true;
+}
+
+BucketId GraceHashJoinOperator::hash(const string& key) const {
+  std::hash<string> strHash;
+  return strHash(key) % numBuckets;
+}
+
+bool GraceHashJoinOperator::execute(int numAvailableBufPages,
+                                    File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  memoryTracker.reset(numAvailableBufPages);
+
+  // TODO: Implement the Grace hash join algorithm (NOT required in project 3)
+
+  isComplete = true;
+  return true;
+}
+
+// calls a function on every tuple of an input, one pinned page at a time
+static void scanInput(const OperatorInput& input,
+                      BufMgr* bufMgr,
+                      SpillManager& spill,
+                      MemoryTracker& memoryTracker,
+                      int& numIOs,
+                      const function<void(const string&)>& visit) {
+  if (input.spillFile != NULL) {
+    memoryTracker.chargeFrames(1);
+    SpillReader reader(&spill, input.spillFile);
+    string tuple;
+    while (reader.next(tuple)) {
+      visit(tuple);
+    }
+    numIOs += reader.getNumPagesRead();
+    reader.close();
+    memoryTracker.releaseFrames(1);
+    return;
+  }
+  File file = File::open(input.tableFile->filename());
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    memoryTracker.chargeFrames(1);
+    numIOs++;
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end(); ++page_iter) {
+      visit(*page_iter);
+    }
+    memoryTracker.releaseFrames(1);
+  }
+}
+
+// number of pages of an input, that of a table by its file header alone
+static size_t numPagesOf(const OperatorInput& input) {
+  if (input.spillFile != NULL) {
+    return input.numPages;
+  }
+  return File::open(input.tableFile->filename()).getNumUsedPages();
+}
+
+// partition of a tuple or key: FNV-1a over the depth of the split and the
+// bytes, mixed so that the low bits depend on every byte.  A partition split
+// again thus spreads over the new partitions.
+static int hashPartitionOf(const string& bytes,
+                           const int depth,
+                           const int numParts) {
+  std::uint32_t hash = 2166136261u;
+  hash ^= static_cast<std::uint32_t>(depth);
+  hash *= 16777619u;
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    hash ^= static_cast<unsigned char>(bytes[i]);
+    hash *= 16777619u;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  return static_cast<int>(hash % static_cast<std::uint32_t>(numParts));
+}
+
+bool AdaptiveJoinOperator::execute(int numAvailableBufPages,
+                                   File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  numBuckets = 0;
+  numSpilledBuckets = 0;
+  numRoleReversals = 0;
+  numBlockJoins = 0;
+  memoryTracker.reset(numAvailableBufPages);
+  BufPinScope pinScope(bufMgr, getOperatorName());
+  // buckets written out, removed when the join ends or throws
+  SpillManager spill(bufMgr);
+
+  const OperatorInput left = {&leftTableFile, NULL, 0, 0};
+  const OperatorInput right = {&rightTableFile, NULL, 0, 0};
+  join(left, right, 0, false, spill, resultFile);
+  numUsedBufPages = memoryTracker.getPeakPages();
+
+  isComplete = true;
+  return true;
+}
+
+/**
+ * Bucket of the hash table of the adaptive join: its build tuples by join
+ * key while it is in memory, and once written out, the temporary files of
+ * its build and probe tuples
+ */
+struct AdaptiveBucket {
+  std::unique_ptr<Arena> arena;
+  std::unique_ptr<BlockHashMap> tuples;
+  size_t bytesCharged;
+  std::unique_ptr<SpillWriter> writer;
+  OperatorInput build;
+  OperatorInput probe;
+};
+
+void AdaptiveJoinOperator::join(const OperatorInput& left,
+                                const OperatorInput& right,
+                                const int depth,
+                                const bool builtLeft,
+                                SpillManager& spill,
+                                File& resultFile) {
+  // distinct keys only stay together by chance, so a bucket still written
+  // out after a few passes is joined in blocks
+  const int maxDepth = 8;
+  // the sizes of the tables come from their headers, those of the buckets
+  // from the pass which wrote them; a bucket whose probe tuples turn out
+  // fewer than its build tuples swaps roles
+  const bool buildLeft = numPagesOf(left) < numPagesOf(right);
+  if (depth > 0 && buildLeft != builtLeft) {
+    numRoleReversals++;
+  }
+  const OperatorInput& build = buildLeft ? left : right;
+  const OperatorInput& probe = buildLeft ? right : left;
+  const JoinKeyExtractor& buildKeys =
+      buildLeft ? leftKeyExtractor : rightKeyExtractor;
+  const JoinKeyExtractor& probeKeys =
+      buildLeft ? rightKeyExtractor : leftKeyExtractor;
+
+  // the writers of the buckets may take half the budget at most
+  const int bucketCount =
+      max(2, min(16, (memoryTracker.getBudgetPages() - 2) / 2));
+  if (depth == 0) {
+    numBuckets = bucketCount;
+  }
+  vector<AdaptiveBucket> buckets(bucketCount);
+  for (int i = 0; i < bucketCount; ++i) {
+    // small chunks, as the buckets fill unevenly
+    buckets[i].arena.reset(new Arena(Page::SIZE / 4));
+    buckets[i].tuples.reset(new BlockHashMap(
+        (less<ArenaSlice>()),
+        ArenaAllocator<pair<const ArenaSlice, ArenaSlice> >(
+            buckets[i].arena.get())));
+    buckets[i].bytesCharged = 0;
+    const OperatorInput none = {NULL, NULL, 0, 0};
+    buckets[i].build = none;
+    buckets[i].probe = none;
+  }
+
+  // writes a bucket out from memory; its later build tuples follow it
+  const function<void(AdaptiveBucket&)> evict = [&](AdaptiveBucket& bucket) {
+    memoryTracker.chargeFrames(1);
+    bucket.build.spillFile = spill.create("bucket");
+    bucket.writer.reset(new SpillWriter(&spill, bucket.build.spillFile));
+    for (BlockHashMap::iterator it = bucket.tuples->begin();
+         it != bucket.tuples->end(); ++it) {
+      bucket.writer->append(it->second.str());
+    }
+    bucket.tuples->clear();
+    bucket.arena->release();
+    memoryTracker.releaseBytes(bucket.bytesCharged);
+    bucket.bytesCharged = 0;
+    numSpilledBuckets++;
+  };
+
+  string key;
+  scanInput(build, bufMgr, spill, memoryTracker, numIOs,
+            [&](const string& tuple) {
+              key.clear();
+              buildKeys.extractKey(tuple, key);
+              AdaptiveBucket& bucket =
+                  buckets[hashPartitionOf(key, depth, bucketCount)];
+              if (bucket.writer) {
+                bucket.writer->append(tuple);
+                return;
+              }
+              const ArenaSlice keySlice(
+                  bucket.arena->copy(key.data(), key.size()), key.size());
+              const ArenaSlice tupleSlice(
+                  bucket.arena->copy(tuple.data(), tuple.size()),
+                  tuple.size());
+              bucket.tuples->insert(
+                  pair<const ArenaSlice, ArenaSlice>(keySlice, tupleSlice));
+              // keep a frame for the writer of the next bucket written out
+              while (!bucket.writer &&
+                     !memoryTracker.canCharge(
+                         1, bucket.arena->getBytesReserved() -
+                                bucket.bytesCharged)) {
+                AdaptiveBucket* largest = NULL;
+                for (int i = 0; i < bucketCount; ++i) {
+                  if (!buckets[i].writer &&
+                      (largest == NULL ||
+                       buckets[i].arena->getBytesReserved() >
+                           largest->arena->getBytesReserved())) {
+                    largest = &buckets[i];
+                  }
+                }
+                evict(*largest);
+              }
+              if (!bucket.writer) {
+                memoryTracker.chargeBytes(bucket.arena->getBytesReserved() -
+                                          bucket.bytesCharged);
+                bucket.bytesCharged = bucket.arena->getBytesReserved();
+              }
+            });
+
+  // the probe tuples of a bucket written out follow it
+  int numWriters = 0;
+  for (int i = 0; i < bucketCount; ++i) {
+    AdaptiveBucket& bucket = buckets[i];
+    if (bucket.writer) {
+      bucket.build.numRecords = bucket.writer->getNumRecords();
+      bucket.build.numPages = bucket.writer->getNumPages();
+      numIOs += static_cast<int>(bucket.writer->getNumPages());
+      bucket.probe.spillFile = spill.create("bucket");
+      bucket.writer.reset(new SpillWriter(&spill, bucket.probe.spillFile));
+      numWriters++;
+    }
+  }
+  string matchTuple;
+  scanInput(probe, bufMgr, spill, memoryTracker, numIOs,
+            [&](const string& tuple) {
+              key.clear();
+              probeKeys.extractKey(tuple, key);
+              AdaptiveBucket& bucket =
+                  buckets[hashPartitionOf(key, depth, bucketCount)];
+              if (bucket.writer) {
+                bucket.writer->append(tuple);
+                return;
+              }
+              pair<BlockHashMap::iterator, BlockHashMap::iterator> same =
+                  bucket.tuples->equal_range(
+                      ArenaSlice(key.data(), key.size()));
+              for (BlockHashMap::iterator it = same.first;
+                   it != same.second; ++it) {
+                matchTuple.assign(it->second.data, it->second.length);
+                numResultTuples++;
+                HeapFileManager::insertTuple(
+                    buildLeft ? joinTuples(matchTuple, tuple)
+                              : joinTuples(tuple, matchTuple),
+                    resultFile, bufMgr);
+              }
+            });
+  for (int i = 0; i < bucketCount; ++i) {
+    AdaptiveBucket& bucket = buckets[i];
+    if (bucket.writer) {
+      bucket.probe.numRecords = bucket.writer->getNumRecords();
+      bucket.probe.numPages = bucket.writer->getNumPages();
+      numIOs += static_cast<int>(bucket.writer->getNumPages());
+      bucket.writer.reset();
+    }
+    bucket.tuples->clear();
+    bucket.arena->release();
+    memoryTracker.releaseBytes(bucket.bytesCharged);
+    bucket.bytesCharged = 0;
+  }
+  memoryTracker.releaseFrames(numWriters);
+
+  for (int i = 0; i < bucketCount; ++i) {
+    const AdaptiveBucket& bucket = buckets[i];
+    if (bucket.build.spillFile == NULL) {
+      continue;
+    }
+    if (bucket.build.numRecords > 0 && bucket.probe.numRecords > 0) {
+      const OperatorInput& l = buildLeft ? bucket.build : bucket.probe;
+      const OperatorInput& r = buildLeft ? bucket.probe : bucket.build;
+      // a bucket holding every tuple of a partition was not split by its key
+      const bool unsplit = build.spillFile != NULL &&
+                           bucket.build.numRecords == build.numRecords;
+      if (unsplit || depth + 1 >= maxDepth) {
+        joinBlocks(l, r, buildLeft, spill, resultFile);
+      } else {
+        join(l, r, depth + 1, buildLeft, spill, resultFile);
+      }
+    }
+    spill.remove(bucket.build.spillFile);
+    spill.remove(bucket.probe.spillFile);
+  }
+}
+
+void AdaptiveJoinOperator::joinBlocks(const OperatorInput& left,
+                                      const OperatorInput& right,
+                                      const bool builtLeft,
+                                      SpillManager& spill,
+                                      File& resultFile) {
+  numBlockJoins++;
+  const bool buildLeft = left.numPages < right.numPages;
+  if (buildLeft != builtLeft) {
+    numRoleReversals++;
+  }
+  const OperatorInput& build = buildLeft ? left : right;
+  const OperatorInput& probe = buildLeft ? right : left;
+  const JoinKeyExtractor& buildKeys =
+      buildLeft ? leftKeyExtractor : rightKeyExtractor;
+  const JoinKeyExtractor& probeKeys =
+      buildLeft ? rightKeyExtractor : leftKeyExtractor;
+
+  memoryTracker.chargeFrames(1);
+  SpillReader buildReader(&spill, build.spillFile);
+  multimap<string, string> block;
+  string tuple, key, matchTuple;
+  bool more = buildReader.next(tuple);
+  while (more) {
+    // as many build tuples as fit next to a frame for the probe input
+    size_t blockBytes = 0;
+    do {
+      key.clear();
+      buildKeys.extractKey(tuple, key);
+      const size_t bytes =
+          6 * sizeof(void*) + 2 * sizeof(string) + key.size() + tuple.size();
+      if (!block.empty() && !memoryTracker.canCharge(1, bytes)) {
+        break;
+      }
+      memoryTracker.chargeBytes(bytes);
+      blockBytes += bytes;
+      block.insert(make_pair(key, tuple));
+      more = buildReader.next(tuple);
+    } while (more);
+
+    scanInput(probe, bufMgr, spill, memoryTracker, numIOs,
+              [&](const string& probeTuple) {
+                key.clear();
+                probeKeys.extractKey(probeTuple, key);
+                pair<multimap<string, string>::iterator,
+                     multimap<string, string>::iterator>
+                    same = block.equal_range(key);
+                for (multimap<string, string>::iterator it = same.first;
+                     it != same.second; ++it) {
+                  numResultTuples++;
+                  HeapFileManager::insertTuple(
+                      buildLeft ? joinTuples(it->second, probeTuple)
+                                : joinTuples(probeTuple, it->second),
+                      resultFile, bufMgr);
+                }
+              });
+    block.clear();
+    memoryTracker.releaseBytes(blockBytes);
+  }
+  numIOs += static_cast<int>(buildReader.getNumPagesRead());
+  buildReader.close();
+  memoryTracker.releaseFrames(1);
+}
+
+SetOperator::SetOperator(const File& leftTableFile,
+                         const File& rightTableFile,
+                         const TableSchema& leftTableSchema,
+                         const TableSchema& rightTableSchema,
+                         BufMgr* bufMgr,
+                         const SetOperation operation,
+                         const SetStrategy strategy)
+    : leftTableFile(leftTableFile),
+      rightTableFile(rightTableFile),
+      leftTableSchema(leftTableSchema),
+      rightTableSchema(rightTableSchema),
+      bufMgr(bufMgr),
+      operation(operation),
+      strategy(strategy),
+      resultTableSchema(JoinOperator::createConcatenatedTableSchema(
+          leftTableSchema, TableSchema(rightTableSchema.getTableName()))),
+      isComplete(false),
+      numResultTuples(0),
+      numUsedBufPages(0),
+      numIOs(0),
+      numPartitions(0),
+      numSortedRuns(0),
+      arena(Page::SIZE) {
+  const string text = leftTableSchema.getTableName() + " " +
+                      getOperatorName() + " " +
+                      rightTableSchema.getTableName();
+  if (leftTableSchema.getAttrCount() != rightTableSchema.getAttrCount()) {
+    throw SetOperationException(text,
+                                "the tables differ in number of attributes");
+  }
+  for (int i = 0; i < leftTableSchema.getAttrCount(); ++i) {
+    const string pair = leftTableSchema.getAttrName(i) + " and " +
+                        rightTableSchema.getAttrName(i);
+    if (leftTableSchema.getAttrType(i) != rightTableSchema.getAttrType(i)) {
+      throw SetOperationException(text, pair + " differ in type");
+    }
+    if (leftTableSchema.getAttrType(i) == CHAR &&
+        leftTableSchema.getAttrMaxSize(i) !=
+            rightTableSchema.getAttrMaxSize(i)) {
+      throw SetOperationException(text, pair + " differ in length");
+    }
+  }
+}
+
+string SetOperator::getOperatorName() const {
+  switch (operation) {
+    case SET_UNION:
+      return "UNION";
+    case SET_INTERSECT:
+      return "INTERSECT";
+    case SET_EXCEPT:
+      return "EXCEPT";
+  }
+  return "SET_OPERATION";
+}
+
+bool SetOperator::execute(int numAvailableBufPages, File& resultFile) {
+  if (isComplete)
+    return true;
+
+  numResultTuples = 0;
+  numUsedBufPages = 0;
+  numIOs = 0;
+  numPartitions = 0;
+  numSortedRuns = 0;
+  memoryTracker.reset(numAvailableBufPages);
+  BufPinScope pinScope(bufMgr, getOperatorName());
+  // partitions and sorted runs, removed when the operator ends or throws
+  SpillManager spill(bufMgr);
+
+  const OperatorInput left = {&leftTableFile, NULL, 0, 0};
+  const OperatorInput right = {&rightTableFile, NULL, 0, 0};
+  switch (strategy) {
+    case SET_ONE_PASS:
+      executeOnePass(left, right, spill, resultFile);
+      break;
+    case SET_HASH_PARTITION:
+      // two partitions a pass would read the tables about once per
+      // partition, and fewer pages leave none for the partitions at all
+      if (memoryTracker.getBudgetPages() <= 3) {
+        executeSortMerge(spill, resultFile);
+      } else {
+        executeHashPartition(left, right, 0, spill, resultFile);
+      }
+      break;
+    case SET_SORT_MERGE:
+      executeSortMerge(spill, resultFile);
+      break;
+  }
+  numUsedBufPages = memoryTracker.getPeakPages();
+
+  isComplete = true;
+  return true;
+}
+
+void SetOperator::printRunningStats() const {
+  cout << "# Result Tuples: " << numResultTuples << endl;
+  cout << "# Used Buffer Pages: " << numUsedBufPages << endl;
+  cout << "# I/Os: " << numIOs << endl;
+  cout << "# Peak Memory Pages: " << memoryTracker.getPeakPages() << endl;
+  if (strategy == SET_HASH_PARTITION) {
+    cout << "# Partitions: " << numPartitions << endl;
+  }
+  if (strategy == SET_SORT_MERGE || numSortedRuns > 0) {
+    cout << "# Sorted Runs: " << numSortedRuns << endl;
+  }
+}
+
+vector<OperatorInput> SetOperator::partition(const OperatorInput& input,
+                                             const int depth,
+                                             const int numParts,
+                                             SpillManager& spill) {
+  // a page for each writer, and one for the input
+  memoryTracker.chargeFrames(numParts);
+  vector<File*> files;
+  vector<std::unique_ptr<SpillWriter> > writers;
+  for (int i = 0; i < numParts; ++i) {
+    files.push_back(spill.create("set"));
+    writers.push_back(
+        std::unique_ptr<SpillWriter>(new SpillWriter(&spill, files[i])));
+  }
+  scanInput(input, bufMgr, spill, memoryTracker, numIOs,
+            [&](const string& tuple) {
+              writers[hashPartitionOf(tuple, depth, numParts)]->append(tuple);
+            });
+  vector<OperatorInput> parts;
+  for (int i = 0; i < numParts; ++i) {
+    const OperatorInput part = {NULL, files[i], writers[i]->getNumRecords(),
+                        writers[i]->getNumPages()};
+    parts.push_back(part);
+    numIOs += static_cast<int>(writers[i]->getNumPages());
+    writers[i].reset();
+  }
+  memoryTracker.releaseFrames(numParts);
+  numPartitions += numParts;
+  return parts;
+}
+
+/**
+ * Distinct tuples of a pass of the one-pass algorithm, each with whether it
+ * must not be returned (any more).  Nodes and bytes are kept in the
+ * operator's arena.
+ */
+typedef map<ArenaSlice, bool, less<ArenaSlice>,
+            ArenaAllocator<pair<const ArenaSlice, bool> > > SetHashMap;
+
+void SetOperator::executeOnePass(const OperatorInput& left,
+                                 const OperatorInput& right,
+                                 SpillManager& spill,
+                                 File& resultFile) {
+  SetHashMap tuples((less<ArenaSlice>()),
+                    ArenaAllocator<pair<const ArenaSlice, bool> >(&arena));
+  size_t arenaCharged = 0;
+  // adds a tuple unless it is there already; true if it was new
+  const function<bool(const string&, bool)> add =
+      [&](const string& tuple, const bool done) -> bool {
+        const ArenaSlice probe(tuple.data(), tuple.size());
+        if (tuples.find(probe) != tuples.end()) {
+          return false;
+        }
+        const ArenaSlice key(arena.copy(tuple.data(), tuple.size()),
+                             tuple.size());
+        tuples.insert(pair<const ArenaSlice, bool>(key, done));
+        memoryTracker.chargeBytes(arena.getBytesReserved() - arenaCharged);
+        arenaCharged = arena.getBytesReserved();
+        return true;
+      };
+  const function<void(const string&)> emit = [&](const string& tuple) {
+    numResultTuples++;
+    HeapFileManager::insertTuple(tuple, resultFile, bufMgr);
+  };
+
+  switch (operation) {
+    case SET_UNION: {
+      const function<void(const string&)> addNew = [&](const string& tuple) {
+        if (add(tuple, true)) {
+          emit(tuple);
+        }
+      };
+      scanInput(left, bufMgr, spill, memoryTracker, numIOs, addNew);
+      scanInput(right, bufMgr, spill, memoryTracker, numIOs, addNew);
+      break;
+    }
+    case SET_INTERSECT: {
+      scanInput(right, bufMgr, spill, memoryTracker, numIOs,
+                [&](const string& tuple) { add(tuple, false); });
+      // a left tuple is returned at its first match
+      scanInput(left, bufMgr, spill, memoryTracker, numIOs,
+                [&](const string& tuple) {
+                  const SetHashMap::iterator it =
+                      tuples.find(ArenaSlice(tuple.data(), tuple.size()));
+                  if (it != tuples.end() && !it->second) {
+                    it->second = true;
+                    emit(tuple);
+                  }
+                });
+      break;
+    }
+    case SET_EXCEPT: {
+      // right tuples and left tuples returned are never returned again
+      scanInput(right, bufMgr, spill, memoryTracker, numIOs,
+                [&](const string& tuple) { add(tuple, true); });
+      scanInput(left, bufMgr, spill, memoryTracker, numIOs,
+                [&](const string& tuple) {
+                  if (add(tuple, true)) {
+                    emit(tuple);
+                  }
+                });
+      break;
+    }
+  }
+
+  tuples.clear();
+  arena.release();
+  memoryTracker.releaseBytes(arenaCharged);
+}
+
+size_t SetOperator::estimateHashTableBytes(
+    const OperatorInput& input) const {
+  if (input.spillFile != NULL) {
+    // the bytes of the tuples and a tree node of about six words per tuple
+    return input.numRecords * 6 * sizeof(void*) +
+           input.numPages * Page::SIZE;
+  }
+  // the tuples of a table are not counted before it is read; short tuples
+  // take about three times their pages
+  return 3 * numPagesOf(input) * Page::SIZE;
+}
+
+void SetOperator::executeHashPartition(const OperatorInput& left,
+                                       const OperatorInput& right,
+                                       const int depth,
+                                       SpillManager& spill,
+                                       File& resultFile) {
+  // distinct tuples only stay together by chance, so a partition still too
+  // large after a few splits is processed as it is
+  const int maxDepth = 8;
+  // enough partitions for each to fit next to the page being read, and one
+  // more for an uneven split, at most one per page of the budget but one
+  size_t bytes = estimateHashTableBytes(right);
+  if (operation != SET_INTERSECT) {
+    bytes += estimateHashTableBytes(left);
+  }
+  const size_t capacity =
+      static_cast<size_t>(max(memoryTracker.getBudgetPages() - 1, 1)) *
+      Page::SIZE;
+  const int numParts =
+      max(min(static_cast<int>(bytes / capacity) + 2,
+              memoryTracker.getBudgetPages() - 1),
+          2);
+  const vector<OperatorInput> leftParts = partition(left, depth, numParts, spill);
+  const vector<OperatorInput> rightParts = partition(right, depth, numParts, spill);
+  for (int i = 0; i < numParts; ++i) {
+    const OperatorInput& l = leftParts[i];
+    const OperatorInput& r = rightParts[i];
+    const bool skipped = operation == SET_UNION
+                             ? l.numRecords == 0 && r.numRecords == 0
+                             : l.numRecords == 0 ||
+                                   (operation == SET_INTERSECT &&
+                                    r.numRecords == 0);
+    if (!skipped) {
+      size_t partBytes = estimateHashTableBytes(r);
+      if (operation != SET_INTERSECT) {
+        partBytes += estimateHashTableBytes(l);
+      }
+      // a frame for the page being read
+      if (depth + 1 < maxDepth && !memoryTracker.canCharge(1, partBytes)) {
+        executeHashPartition(l, r, depth + 1, spill, resultFile);
+      } else {
+        executeOnePass(l, r, spill, resultFile);
+      }
+    }
+    spill.remove(l.spillFile);
+    spill.remove(r.spillFile);
+  }
+}
+
+void SetOperator::executeSortMerge(SpillManager& spill, File& resultFile) {
+  // any order brings equal tuples together; bytewise is the cheapest
+  const ExternalSorter::Less byBytes = less<string>();
+  ExternalSorter leftSorter(&spill, bufMgr, &memoryTracker, byBytes);
+  leftSorter.addFile(leftTableFile);
+  File* left = leftSorter.finish();
+  numIOs += leftSorter.getNumIOs();
+  numSortedRuns += leftSorter.getNumRuns();
+
+  ExternalSorter rightSorter(&spill, bufMgr, &memoryTracker, byBytes);
+  rightSorter.addFile(rightTableFile);
+  File* right = rightSorter.finish();
+  numIOs += rightSorter.getNumIOs();
+  numSortedRuns += rightSorter.getNumRuns();
+
+  // a page for each reader
+  memoryTracker.chargeFrames(2);
+  SpillReader leftReader(&spill, left);
+  SpillReader rightReader(&spill, right);
+  string leftTuple, rightTuple, tuple;
+  bool hasLeft = leftReader.next(leftTuple);
+  bool hasRight = rightReader.next(rightTuple);
+  // INTERSECT ends with either table, EXCEPT with the left one
+  while ((hasLeft && (hasRight || operation != SET_INTERSECT)) ||
+         (hasRight && operation == SET_UNION)) {
+    const int order =
+        !hasRight ? -1 : (!hasLeft ? 1 : leftTuple.compare(rightTuple));
+    tuple = order <= 0 ? leftTuple : rightTuple;
+    // skip every copy of the tuple in both tables
+    while (hasLeft && leftTuple == tuple) {
+      hasLeft = leftReader.next(leftTuple);
+    }
+    while (hasRight && rightTuple == tuple) {
+      hasRight = rightReader.next(rightTuple);
+    }
+    const bool returned = operation == SET_UNION ||
+                          (operation == SET_INTERSECT && order == 0) ||
+                          (operation == SET_EXCEPT && order < 0);
+    if (returned) {
+      numResultTuples++;
+      HeapFileManager::insertTuple(tuple, resultFile, bufMgr);
+    }
+  }
+  numIOs += leftReader.getNumPagesRead() + rightReader.getNumPagesRead();
+  leftReader.close();
+  rightReader.close();
+  memoryTracker.releaseFrames(2);
+}
+
 }  // namespace badgerdb
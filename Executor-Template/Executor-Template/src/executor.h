@@ -6,11 +6,21 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+
+#include "arena.h"
 #include "buffer.h"
 #include "catalog.h"
 #include "file.h"
+#include "join_key.h"
+#include "memory_tracker.h"
+#include "partition.h"
 #include "schema.h"
+#include "sort_key.h"
+#include "spill_manager.h"
 #include "storage.h"
+#include "tuple_formatter.h"
 
 using namespace std;
 
@@ -52,48 +62,114 @@ class TableScanner {
    * Print tuples in the table
    */
   void print() const;
+
+  /**
+   * Write tuples in the table to a stream through an output buffer
+   *
+   * @param out        Stream receiving the tuples (stdout, a file or a string
+   *                   stream)
+   * @param formatter  Representation of the tuples (text, CSV, TSV, binary)
+   * @throws PartitionException If the file is the table file of a partitioned
+   *                            table; scan its partitions instead
+   */
+  void print(ostream& out, const TupleFormatter& formatter) const;
 };
 
 /**
- * Join Operator
+ * Scanner of a partitioned table which reads only the partitions which may
+ * hold tuples matching a range predicate on an INT attribute
  */
-class JoinOperator {
- protected:
+class PartitionedTableScanner {
+ private:
   /**
-   * Data file of the left table
+   * Partitioned table
    */
-  const File& leftTableFile;
+  PartitionedTable& table;
 
   /**
-   * Data file of the right table
+   * Buffer pool manager
    */
-  const File& rightTableFile;
+  BufMgr* bufMgr;
 
   /**
-   * Schema of the left table
+   * Attribute restricted by the predicate, empty for none
    */
-  const TableSchema& leftTableSchema;
+  string rangeAttrName;
 
   /**
-   * Schema of the right table
+   * Keys selected by the predicate
    */
-  const TableSchema& rightTableSchema;
+  KeyRange range;
 
   /**
-   * Schema of the result table
+   * Number of partitions read by the last scan
    */
-  TableSchema resultTableSchema;
+  mutable int numScannedPartitions;
+
+ public:
+  PartitionedTableScanner(PartitionedTable& table, BufMgr* bufMgr)
+      : table(table),
+        bufMgr(bufMgr),
+        range(KeyRange::all()),
+        numScannedPartitions(0) {
+    // nothing
+  }
 
   /**
-   * System catalog
+   * Restrict the scan to the tuples whose INT attribute lies in the range
+   *
+   * @throws PartitionException If the table has no such INT attribute
    */
-  const Catalog* catalog;
+  void setKeyRange(const string& attrName, const KeyRange& range);
+
+  /**
+   * Write the selected tuples to a stream through an output buffer
+   */
+  void print(ostream& out, const TupleFormatter& formatter) const;
+
+  /**
+   * Get the number of partitions read by the last scan
+   */
+  int getNumScannedPartitions() const { return numScannedPartitions; }
+};
+
+/**
+ * Operator returning the first k tuples of a table (LIMIT k), in the order of
+ * some of its attributes if given (ORDER BY ... LIMIT k).
+ *
+ * Without an order the scan stops, and unpins its page, as soon as k tuples
+ * are returned.  With an order a single scan keeps the k best tuples seen so
+ * far in a bounded heap instead of sorting the table; only if they do not fit
+ * in the memory budget are the tuples sorted externally.  Tuples which tie
+ * keep the order of the table.
+ */
+class TopKOperator {
+ private:
+  /**
+   * Data file of the table
+   */
+  const File& tableFile;
+
+  /**
+   * Schema of the table
+   */
+  const TableSchema& tableSchema;
 
   /**
    * Buffer pool manager
    */
   BufMgr* bufMgr;
 
+  /**
+   * Number of tuples returned at most
+   */
+  int limit;
+
+  /**
+   * ORDER BY attributes, empty for the order of the table
+   */
+  vector<SortKey> orderBy;
+
   /**
    * Is the executor completed
    */
@@ -114,49 +190,85 @@ class JoinOperator {
    */
   int numIOs;
 
+  /**
+   * Number of tuples of the table read
+   */
+  int numScannedTuples;
+
+  /**
+   * Number of sorted runs written when the heap did not fit in memory
+   */
+  int numSortedRuns;
+
+  /**
+   * Memory charged by the executor against its buffer page budget
+   */
+  MemoryTracker memoryTracker;
+
+  /**
+   * Write the first tuples of the table to the result
+   */
+  void executeLimit(File& resultFile);
+
+  /**
+   * Write the best tuples of the table to the result, in order
+   */
+  void executeTopK(File& resultFile);
+
  public:
   /**
    * Constructor
+   *
+   * @param limit  Number of tuples returned at most.
    */
-  JoinOperator(const File& leftTableFile,
-               const File& rightTableFile,
-               const TableSchema& leftTableSchema,
-               const TableSchema& rightTableSchema,
-               const Catalog* catalog,
-               BufMgr* bufMgr);
+  TopKOperator(const File& tableFile,
+               const TableSchema& tableSchema,
+               BufMgr* bufMgr,
+               const int limit);
 
   /**
-   * Destructor
+   * Get the operator's name
    */
-  ~JoinOperator() {
-    // nothing
-  }
+  string getOperatorName() const { return orderBy.empty() ? "LIMIT" : "TOP_K"; }
 
   /**
-   * Is the algorithm complete?
+   * Order the tuples by the attributes before the first k are taken
+   *
+   * @throws SortKeyException If an attribute is not in the table or named
+   * twice
    */
-  bool isCompleted() const { return isComplete; }
+  void setOrderBy(const vector<SortKey>& orderBy);
 
   /**
-   * Get the operator's name
+   * Get the ORDER BY attributes
    */
-  virtual string getOperatorName() const { return "JOIN"; }
+  const vector<SortKey>& getOrderBy() const { return orderBy; }
 
   /**
-   * Print the running statistics of the executor
+   * Get the number of tuples returned at most
    */
-  virtual void printRunningStats() const;
+  int getLimit() const { return limit; }
 
   /**
-   * Execute the join algorithm
+   * Execute the operator
    * @return If succeeded, return true
    */
-  virtual bool execute(int numAvailableBufPages, File& resultFile) = 0;
+  bool execute(int numAvailableBufPages, File& resultFile);
 
   /**
-   * Get the schema of the result table
+   * Print the running statistics of the executor
    */
-  const TableSchema& getResultTableSchema() const { return resultTableSchema; }
+  void printRunningStats() const;
+
+  /**
+   * Is the algorithm complete?
+   */
+  bool isCompleted() const { return isComplete; }
+
+  /**
+   * Get the schema of the result table, that of the table
+   */
+  const TableSchema& getResultTableSchema() const { return tableSchema; }
 
   /**
    * Get number of result tuples
@@ -174,161 +286,1509 @@ class JoinOperator {
   int getNumIOs() const { return numIOs; }
 
   /**
-   * Create the result schema using the input schemas
+   * Get number of tuples of the table read
    */
-  static TableSchema createResultTableSchema(
-      const TableSchema& leftTableSchema,
-      const TableSchema& rightTableSchema);
+  int getNumScannedTuples() const { return numScannedTuples; }
 
- protected:
   /**
-   * Get common attributes in all input tables
+   * Get number of sorted runs written
    */
-  vector<Attribute> getCommonAttributes(
-      const TableSchema& leftTableSchema,
-      const TableSchema& rightTableSchema) const;
+  int getNumSortedRuns() const { return numSortedRuns; }
 
   /**
-   * Join two tuples
+   * Get the memory accounting of the executor
    */
-  string joinTuples(string leftTuple,
-                    string rightTuple,
-                    const TableSchema& leftTableSchema,
-                    const TableSchema& rightTableSchema) const;
+  const MemoryTracker& getMemoryTracker() const { return memoryTracker; }
 };
 
-class OnePassJoinOperator : public JoinOperator {
- public:
+/**
+ * Functions computed by a window operator
+ */
+enum WindowFunctionType {
   /**
-   * Constructor
+   * Position of the tuple in its partition, from 1
    */
-  OnePassJoinOperator(const File& leftTableFile,
-                      const File& rightTableFile,
-                      const TableSchema& leftTableSchema,
-                      const TableSchema& rightTableSchema,
-                      const Catalog* catalog,
-                      BufMgr* bufMgr)
-      : JoinOperator(leftTableFile,
-                     rightTableFile,
-                     leftTableSchema,
-                     rightTableSchema,
-                     catalog,
-                     bufMgr) {
-    // nothing
-  }
+  WINDOW_ROW_NUMBER,
 
   /**
-   * Destructor
+   * 1 plus the number of tuples of the partition ordered before the tuple;
+   * tuples with equal ORDER BY values share a rank
    */
-  ~OnePassJoinOperator() {
-    // nothing
-  }
+  WINDOW_RANK,
 
   /**
-   * Get oprator's name (overrided)
+   * Sum of an INT attribute over the partition up to the tuple
    */
-  string getOperatorName() const { return "ONE_PASS_JOIN"; }
+  WINDOW_SUM,
 
-  bool execute(int numAvailableBufPages, File& resultFile);
+  /**
+   * Average of an INT attribute over the partition up to the tuple, rounded
+   * toward zero
+   */
+  WINDOW_AVG,
+
+  /**
+   * Value of an attribute some tuples before in the partition
+   */
+  WINDOW_LAG,
+
+  /**
+   * Value of an attribute some tuples after in the partition
+   */
+  WINDOW_LEAD
 };
 
-class NestedLoopJoinOperator : public JoinOperator {
- public:
+/**
+ * Window function and the attribute holding its result
+ */
+struct WindowFunction {
   /**
-   * Constructor
+   * Function computed
    */
-  NestedLoopJoinOperator(const File& leftTableFile,
-                         const File& rightTableFile,
-                         const TableSchema& leftTableSchema,
-                         const TableSchema& rightTableSchema,
-                         const Catalog* catalog,
-                         BufMgr* bufMgr)
-      : JoinOperator(leftTableFile,
-                     rightTableFile,
-                     leftTableSchema,
-                     rightTableSchema,
-                     catalog,
-                     bufMgr) {
-    // nothing
+  WindowFunctionType type;
+
+  /**
+   * Argument of SUM, AVG, LAG and LEAD
+   */
+  string attrName;
+
+  /**
+   * Number of tuples LAG and LEAD look back or ahead
+   */
+  int offset;
+
+  /**
+   * Name of the result attribute
+   */
+  string resultName;
+
+  /**
+   * ROW_NUMBER() AS resultName
+   */
+  static WindowFunction rowNumber(const string& resultName) {
+    WindowFunction function = {WINDOW_ROW_NUMBER, "", 0, resultName};
+    return function;
   }
 
   /**
-   * Destructor
+   * RANK() AS resultName
    */
-  ~NestedLoopJoinOperator() {
-    // nothing
+  static WindowFunction rank(const string& resultName) {
+    WindowFunction function = {WINDOW_RANK, "", 0, resultName};
+    return function;
   }
 
   /**
-   * Get oprator's name (overrided)
+   * SUM(attrName) AS resultName
    */
-  string getOperatorName() const { return "NESTED_LOOP_JOIN"; }
+  static WindowFunction sum(const string& attrName, const string& resultName) {
+    WindowFunction function = {WINDOW_SUM, attrName, 0, resultName};
+    return function;
+  }
 
-  bool execute(int numAvailableBufPages, File& resultFile);
+  /**
+   * AVG(attrName) AS resultName
+   */
+  static WindowFunction avg(const string& attrName, const string& resultName) {
+    WindowFunction function = {WINDOW_AVG, attrName, 0, resultName};
+    return function;
+  }
+
+  /**
+   * LAG(attrName, offset) AS resultName
+   */
+  static WindowFunction lag(const string& attrName,
+                            const int offset,
+                            const string& resultName) {
+    WindowFunction function = {WINDOW_LAG, attrName, offset, resultName};
+    return function;
+  }
+
+  /**
+   * LEAD(attrName, offset) AS resultName
+   */
+  static WindowFunction lead(const string& attrName,
+                             const int offset,
+                             const string& resultName) {
+    WindowFunction function = {WINDOW_LEAD, attrName, offset, resultName};
+    return function;
+  }
+
+  /**
+   * Get the text of the function, e.g. LAG(a, 1) AS prev_a
+   */
+  string toString() const;
 };
 
 /**
- * Bucket Id type
+ * Operator computing window functions over the partitions of a table
+ * (f(...) OVER (PARTITION BY ... ORDER BY ...)).  Each result tuple is a
+ * tuple of the table followed by the results of the functions, which are INT
+ * attributes except for LAG and LEAD, typed like their argument.  The tuple
+ * format has no NULL, so LAG and LEAD give a zero or empty value past the
+ * ends of a partition.  SUM and AVG run over the tuples up to the current one
+ * (ROWS UNBOUNDED PRECEDING), and SUM keeps the low 32 bits of the total.
+ *
+ * The table is sorted by the partition and ORDER BY attributes with the
+ * external sort, and then streamed once.  A table already in that order is
+ * streamed as it is, without the sort, after setInputSorted().  No partition
+ * is held in memory: LAG and LEAD read the sorted file, or the table, through
+ * a reader of their own for each distinct offset, so a frame costs a pinned
+ * page per offset however large its partition is.  Tuples with equal
+ * partition and ORDER BY values keep the order of the table.
  */
-typedef std::uint32_t BucketId;
-
-class GraceHashJoinOperator : public JoinOperator {
+class WindowOperator {
  private:
   /**
-   * Number of buckets
+   * Data file of the table
    */
-  int numBuckets;
+  const File& tableFile;
 
   /**
-   * Hash function from key to bucket Id
+   * Schema of the table
    */
-  BucketId hash(const string& key) const;
+  const TableSchema& tableSchema;
 
- public:
   /**
-   * Constructor
+   * Buffer pool manager
    */
-  GraceHashJoinOperator(const File& leftTableFile,
-                        const File& rightTableFile,
-                        const TableSchema& leftTableSchema,
-                        const TableSchema& rightTableSchema,
-                        const Catalog* catalog,
-                        BufMgr* bufMgr)
-      : JoinOperator(leftTableFile,
-                     rightTableFile,
-                     leftTableSchema,
-                     rightTableSchema,
-                     catalog,
-                     bufMgr) {
-    // nothing
-  }
+  BufMgr* bufMgr;
 
   /**
-   * Destructor
+   * PARTITION BY attributes
    */
-  ~GraceHashJoinOperator() {
-    // nothing
-  }
+  vector<string> partitionBy;
 
   /**
-   * Get oprator's name (overrided)
+   * ORDER BY attributes
    */
-  string getOperatorName() const { return "GRACE_HASH_JOIN"; }
+  vector<SortKey> orderBy;
 
   /**
-   * Print running statistics (overrided)
+   * Functions computed
    */
-  void printRunningStats() const {
-    JoinOperator::printRunningStats();
-    cout << "# Buckets: " << numBuckets << endl;
-  }
+  vector<WindowFunction> functions;
 
   /**
-   * Get number of buckets
+   * Schema of the result table
    */
-  int getNumBuckets() const { return numBuckets; }
+  TableSchema resultTableSchema;
 
-  bool execute(int numAvailableBufPages, File& resultFile);
+  /**
+   * Is the executor completed
+   */
+  bool isComplete;
+
+  /**
+   * Number of result tuples
+   */
+  int numResultTuples;
+
+  /**
+   * Number of buffer pages actually used by the executor
+   */
+  int numUsedBufPages;
+
+  /**
+   * Number of I/Os carried out by the executor
+   */
+  int numIOs;
+
+  /**
+   * Number of sorted runs written
+   */
+  int numSortedRuns;
+
+  /**
+   * Number of partitions
+   */
+  int numPartitions;
+
+  /**
+   * Is the table already in the order of the partition and ORDER BY
+   * attributes?
+   */
+  bool inputSorted;
+
+  /**
+   * Memory charged by the executor against its buffer page budget
+   */
+  MemoryTracker memoryTracker;
+
+  /**
+   * Get the text of the window, e.g. OVER (PARTITION BY a ORDER BY b DESC)
+   */
+  string getWindowText() const;
+
+ public:
+  /**
+   * Constructor
+   *
+   * @throws SortKeyException If an ORDER BY or PARTITION BY attribute is not
+   * in the table or named twice
+   * @throws WindowException If a function has no valid argument or offset,
+   * or its result is named like another attribute
+   */
+  WindowOperator(const File& tableFile,
+                 const TableSchema& tableSchema,
+                 BufMgr* bufMgr,
+                 const vector<string>& partitionBy,
+                 const vector<SortKey>& orderBy,
+                 const vector<WindowFunction>& functions);
+
+  /**
+   * Stream the table as it is, without sorting it, when it is already
+   * ordered by the PARTITION BY attributes, ascending, and then by the ORDER
+   * BY attributes.  execute() throws WindowException at the first tuple out
+   * of that order.
+   */
+  void setInputSorted(const bool inputSorted) {
+    this->inputSorted = inputSorted;
+  }
+
+  /**
+   * Is the table streamed without sorting it?
+   */
+  bool isInputSorted() const { return inputSorted; }
+
+  /**
+   * Get the operator's name
+   */
+  string getOperatorName() const { return "WINDOW"; }
+
+  /**
+   * Execute the operator
+   * @return If succeeded, return true
+   * @throws WindowException If the table is streamed as it is but is not in
+   * order
+   */
+  bool execute(int numAvailableBufPages, File& resultFile);
+
+  /**
+   * Print the running statistics of the executor
+   */
+  void printRunningStats() const;
+
+  /**
+   * Is the algorithm complete?
+   */
+  bool isCompleted() const { return isComplete; }
+
+  /**
+   * Get the schema of the result table
+   */
+  const TableSchema& getResultTableSchema() const { return resultTableSchema; }
+
+  /**
+   * Get number of result tuples
+   */
+  int getNumResultTuples() const { return numResultTuples; }
+
+  /**
+   * Get number of buffer pages used by the executor
+   */
+  int getNumUsedBufPages() const { return numUsedBufPages; }
+
+  /**
+   * Get number of I/Os carried out by the executor
+   */
+  int getNumIOs() const { return numIOs; }
+
+  /**
+   * Get number of sorted runs written
+   */
+  int getNumSortedRuns() const { return numSortedRuns; }
+
+  /**
+   * Get number of partitions
+   */
+  int getNumPartitions() const { return numPartitions; }
+
+  /**
+   * Get the memory accounting of the executor
+   */
+  const MemoryTracker& getMemoryTracker() const { return memoryTracker; }
+};
+
+/**
+ * Tuples returned by a join
+ */
+enum JoinMode {
+  /**
+   * The pairs of matching tuples
+   */
+  JOIN_INNER,
+
+  /**
+   * The pairs, and each left tuple without a match with an empty right part
+   */
+  JOIN_LEFT_OUTER,
+
+  /**
+   * The pairs, and each right tuple without a match with an empty left part
+   */
+  JOIN_RIGHT_OUTER,
+
+  /**
+   * The pairs, and the tuples of both tables without a match
+   */
+  JOIN_FULL_OUTER,
+
+  /**
+   * Each left tuple with a match, once (EXISTS)
+   */
+  JOIN_SEMI,
+
+  /**
+   * Each left tuple without a match (NOT EXISTS)
+   */
+  JOIN_ANTI
+};
+
+/**
+ * Join Operator
+ */
+class JoinOperator {
+ protected:
+  /**
+   * Data file of the left table
+   */
+  const File& leftTableFile;
+
+  /**
+   * Data file of the right table
+   */
+  const File& rightTableFile;
+
+  /**
+   * Schema of the left table
+   */
+  const TableSchema& leftTableSchema;
+
+  /**
+   * Schema of the right table
+   */
+  const TableSchema& rightTableSchema;
+
+  /**
+   * Schema of the result table
+   */
+  TableSchema resultTableSchema;
+
+  /**
+   * Join attributes of the left and the right table, pairwise
+   */
+  vector<string> leftKeyAttrNames;
+  vector<string> rightKeyAttrNames;
+
+  /**
+   * Extractors of the join keys of the left and the right tuples
+   */
+  JoinKeyExtractor leftKeyExtractor;
+  JoinKeyExtractor rightKeyExtractor;
+
+  /**
+   * System catalog
+   */
+  const Catalog* catalog;
+
+  /**
+   * Buffer pool manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Is the executor completed
+   */
+  bool isComplete;
+
+  /**
+   * Number of result tuples
+   */
+  int numResultTuples;
+
+  /**
+   * Number of buffer pages actually used by the executor
+   */
+  int numUsedBufPages;
+
+  /**
+   * Number of I/Os carried out by the executor
+   */
+  int numIOs;
+
+  /**
+   * Memory arena for the hash tables and intermediate tuples built during
+   * execution
+   */
+  Arena arena;
+
+  /**
+   * Memory charged by the executor against its buffer page budget
+   */
+  MemoryTracker memoryTracker;
+
+ public:
+  /**
+   * Constructor
+   *
+   * @throws PartitionException If a file is the table file of a partitioned
+   *                            table; join its partitions instead
+   */
+  JoinOperator(const File& leftTableFile,
+               const File& rightTableFile,
+               const TableSchema& leftTableSchema,
+               const TableSchema& rightTableSchema,
+               const Catalog* catalog,
+               BufMgr* bufMgr);
+
+  /**
+   * Destructor
+   */
+  ~JoinOperator() {
+    // nothing
+  }
+
+  /**
+   * Is the algorithm complete?
+   */
+  bool isCompleted() const { return isComplete; }
+
+  /**
+   * Get the operator's name
+   */
+  virtual string getOperatorName() const { return "JOIN"; }
+
+  /**
+   * Print the running statistics of the executor
+   */
+  virtual void printRunningStats() const;
+
+  /**
+   * Execute the join algorithm
+   * @return If succeeded, return true
+   */
+  virtual bool execute(int numAvailableBufPages, File& resultFile) = 0;
+
+  /**
+   * Get the schema of the result table
+   */
+  const TableSchema& getResultTableSchema() const { return resultTableSchema; }
+
+  /**
+   * Get number of result tuples
+   */
+  int getNumResultTuples() const { return numResultTuples; }
+
+  /**
+   * Get number of buffer pages used by the executor
+   */
+  int getNumUsedBufPages() const { return numUsedBufPages; }
+
+  /**
+   * Get number of I/Os carried out by the executor
+   */
+  int getNumIOs() const { return numIOs; }
+
+  /**
+   * Get the memory accounting of the executor
+   */
+  const MemoryTracker& getMemoryTracker() const { return memoryTracker; }
+
+  /**
+   * Join on the given attributes instead of those named and typed alike in
+   * both tables.  The i-th left attribute is compared with the i-th right
+   * one; the right ones are left out of the result.
+   *
+   * @throws JoinPredicateException If the attributes cannot be paired
+   */
+  void setJoinKeys(const vector<string>& leftKeyAttrNames,
+                   const vector<string>& rightKeyAttrNames);
+
+  /**
+   * Get the join attributes of the left table
+   */
+  const vector<string>& getLeftKeyAttrNames() const { return leftKeyAttrNames; }
+
+  /**
+   * Get the join attributes of the right table
+   */
+  const vector<string>& getRightKeyAttrNames() const {
+    return rightKeyAttrNames;
+  }
+
+  /**
+   * Create the result schema using the input schemas
+   */
+  static TableSchema createResultTableSchema(
+      const TableSchema& leftTableSchema,
+      const TableSchema& rightTableSchema);
+
+  /**
+   * Create the schema of a join on the given right attributes: the left
+   * attributes, then the other right ones, qualified with the name of their
+   * table where they are named like a left one
+   */
+  static TableSchema createResultTableSchema(
+      const TableSchema& leftTableSchema,
+      const TableSchema& rightTableSchema,
+      const vector<string>& rightKeyAttrNames);
+
+  /**
+   * Create the schema of a join which keeps every attribute of both tables,
+   * the left ones first.  A right attribute named like a left one is
+   * qualified with the name of its table, e.g. s.b.
+   */
+  static TableSchema createConcatenatedTableSchema(
+      const TableSchema& leftTableSchema,
+      const TableSchema& rightTableSchema);
+
+ protected:
+  /**
+   * Set the schema of the result table after the join keys changed
+   */
+  virtual void updateResultTableSchema();
+
+  /**
+   * Get common attributes in all input tables
+   */
+  vector<Attribute> getCommonAttributes(
+      const TableSchema& leftTableSchema,
+      const TableSchema& rightTableSchema) const;
+
+  /**
+   * Join two tuples into a tuple of the result schema: the left tuple, then
+   * the right attributes other than the join keys, each with its length byte
+   * and padding
+   */
+  string joinTuples(const string& leftTuple, const string& rightTuple) const;
+};
+
+class OnePassJoinOperator : public JoinOperator {
+ public:
+  /**
+   * Constructor
+   */
+  OnePassJoinOperator(const File& leftTableFile,
+                      const File& rightTableFile,
+                      const TableSchema& leftTableSchema,
+                      const TableSchema& rightTableSchema,
+                      const Catalog* catalog,
+                      BufMgr* bufMgr)
+      : JoinOperator(leftTableFile,
+                     rightTableFile,
+                     leftTableSchema,
+                     rightTableSchema,
+                     catalog,
+                     bufMgr) {
+    // nothing
+  }
+
+  /**
+   * Destructor
+   */
+  ~OnePassJoinOperator() {
+    // nothing
+  }
+
+  /**
+   * Get oprator's name (overrided)
+   */
+  string getOperatorName() const { return "ONE_PASS_JOIN"; }
+
+  bool execute(int numAvailableBufPages, File& resultFile);
+};
+
+class NestedLoopJoinOperator : public JoinOperator {
+ private:
+  /**
+   * Tuples returned by the join
+   */
+  JoinMode joinMode;
+
+  /**
+   * Are pages read ahead on a thread while the ones before them are used?
+   */
+  bool readAhead;
+
+ public:
+  /**
+   * Constructor
+   */
+  NestedLoopJoinOperator(const File& leftTableFile,
+                         const File& rightTableFile,
+                         const TableSchema& leftTableSchema,
+                         const TableSchema& rightTableSchema,
+                         const Catalog* catalog,
+                         BufMgr* bufMgr)
+      : JoinOperator(leftTableFile,
+                     rightTableFile,
+                     leftTableSchema,
+                     rightTableSchema,
+                     catalog,
+                     bufMgr),
+        joinMode(JOIN_INNER),
+        readAhead(true) {
+    // nothing
+  }
+
+  /**
+   * Destructor
+   */
+  ~NestedLoopJoinOperator() {
+    // nothing
+  }
+
+  /**
+   * Get oprator's name (overrided)
+   */
+  string getOperatorName() const { return "NESTED_LOOP_JOIN"; }
+
+  /**
+   * Set the tuples returned by the join.  The outer modes pad a tuple without
+   * a match with zero and empty values, as the tuple format has no NULL; the
+   * semi and anti joins return left tuples only.  Left tuples matched in
+   * one block of the right table are remembered in a bitmap over the left
+   * table, right tuples by a flag in the hash table of their block.
+   */
+  void setJoinMode(const JoinMode mode);
+
+  /**
+   * Get the tuples returned by the join
+   */
+  JoinMode getJoinMode() const { return joinMode; }
+
+  /**
+   * Set whether the pages of the tables are read ahead on a thread of their
+   * own while the pages before them are hashed or probed.  Without it each
+   * page is read when it is used; the result is the same either way.
+   */
+  void setReadAhead(const bool readAhead) { this->readAhead = readAhead; }
+
+  /**
+   * Are the pages of the tables read ahead?
+   */
+  bool isReadAhead() const { return readAhead; }
+
+  bool execute(int numAvailableBufPages, File& resultFile);
+
+ protected:
+  void updateResultTableSchema();
+};
+
+/**
+ * Bucket Id type
+ */
+typedef std::uint32_t BucketId;
+
+class GraceHashJoinOperator : public JoinOperator {
+ private:
+  /**
+   * Number of buckets
+   */
+  int numBuckets;
+
+  /**
+   * Hash function from key to bucket Id
+   */
+  BucketId hash(const string& key) const;
+
+ public:
+  /**
+   * Constructor
+   */
+  GraceHashJoinOperator(const File& leftTableFile,
+                        const File& rightTableFile,
+                        const TableSchema& leftTableSchema,
+                        const TableSchema& rightTableSchema,
+                        const Catalog* catalog,
+                        BufMgr* bufMgr)
+      : JoinOperator(leftTableFile,
+                     rightTableFile,
+                     leftTableSchema,
+                     rightTableSchema,
+                     catalog,
+                     bufMgr) {
+    // nothing
+  }
+
+  /**
+   * Destructor
+   */
+  ~GraceHashJoinOperator() {
+    // nothing
+  }
+
+  /**
+   * Get oprator's name (overrided)
+   */
+  string getOperatorName() const { return "GRACE_HASH_JOIN"; }
+
+  /**
+   * Print running statistics (overrided)
+   */
+  void printRunningStats() const {
+    JoinOperator::printRunningStats();
+    cout << "# Buckets: " << numBuckets << endl;
+  }
+
+  /**
+   * Get number of buckets
+   */
+  int getNumBuckets() const { return numBuckets; }
+
+  bool execute(int numAvailableBufPages, File& resultFile);
+};
+
+/**
+ * Input of a pass of an operator: a table, or a partition of it in a
+ * temporary file
+ */
+struct OperatorInput {
+  /**
+   * Data file of the table, or NULL for a partition
+   */
+  const File* tableFile;
+
+  /**
+   * Temporary file of the partition, or NULL for a table
+   */
+  File* spillFile;
+
+  /**
+   * Number of tuples and pages of the partition
+   */
+  std::size_t numRecords;
+  std::size_t numPages;
+};
+
+/**
+ * Hash join which adapts to the sizes of its tables as it reads them, for
+ * when their sizes are not known well enough to choose between the one-pass,
+ * nested loop and Grace hash joins.
+ *
+ * The hash table is built on the table with fewer pages and split into
+ * buckets by a hash of the join key.  While it fits, the join runs in one
+ * pass.  When it overflows, the largest bucket in memory is written to a
+ * temporary file from memory, so no tuple already read is read again, and
+ * the later tuples of the bucket on either side follow it there.  Each pair
+ * of buckets written out is then joined alike, building on the smaller of
+ * the two, so that a probe side which turns out small swaps roles.  A bucket
+ * which no hash can split, as all its tuples share one key, is joined in
+ * blocks as by the nested loop join.
+ *
+ * Only inner joins are computed.
+ */
+class AdaptiveJoinOperator : public JoinOperator {
+ private:
+  /**
+   * Number of buckets of the first pass
+   */
+  int numBuckets;
+
+  /**
+   * Number of buckets written to temporary files, in every pass
+   */
+  int numSpilledBuckets;
+
+  /**
+   * Number of passes which built on the side their buckets were probed
+   * with in the pass which wrote them
+   */
+  int numRoleReversals;
+
+  /**
+   * Number of pairs of buckets joined in blocks
+   */
+  int numBlockJoins;
+
+  /**
+   * Join two inputs, building on the smaller one
+   *
+   * @param depth      Number of passes which split the inputs before, which
+   *                   seeds the hash of the buckets.
+   * @param builtLeft  Did the pass which wrote the inputs build on the left
+   *                   side?  Ignored for the tables.
+   */
+  void join(const OperatorInput& left,
+            const OperatorInput& right,
+            int depth,
+            bool builtLeft,
+            SpillManager& spill,
+            File& resultFile);
+
+  /**
+   * Join two partitions in blocks of the smaller one as large as the memory
+   * allows
+   *
+   * @param builtLeft  Did the pass which wrote the partitions build on the
+   *                   left side?
+   */
+  void joinBlocks(const OperatorInput& left,
+                  const OperatorInput& right,
+                  bool builtLeft,
+                  SpillManager& spill,
+                  File& resultFile);
+
+ public:
+  /**
+   * Constructor
+   */
+  AdaptiveJoinOperator(const File& leftTableFile,
+                       const File& rightTableFile,
+                       const TableSchema& leftTableSchema,
+                       const TableSchema& rightTableSchema,
+                       const Catalog* catalog,
+                       BufMgr* bufMgr)
+      : JoinOperator(leftTableFile,
+                     rightTableFile,
+                     leftTableSchema,
+                     rightTableSchema,
+                     catalog,
+                     bufMgr),
+        numBuckets(0),
+        numSpilledBuckets(0),
+        numRoleReversals(0),
+        numBlockJoins(0) {
+    // nothing
+  }
+
+  /**
+   * Get oprator's name (overrided)
+   */
+  string getOperatorName() const { return "ADAPTIVE_JOIN"; }
+
+  /**
+   * Print running statistics (overrided)
+   */
+  void printRunningStats() const {
+    JoinOperator::printRunningStats();
+    cout << "# Buckets: " << numBuckets << endl;
+    cout << "# Spilled Buckets: " << numSpilledBuckets << endl;
+    cout << "# Role Reversals: " << numRoleReversals << endl;
+    cout << "# Block Joins: " << numBlockJoins << endl;
+  }
+
+  /**
+   * Get number of buckets of the first pass
+   */
+  int getNumBuckets() const { return numBuckets; }
+
+  /**
+   * Get number of buckets written to temporary files
+   */
+  int getNumSpilledBuckets() const { return numSpilledBuckets; }
+
+  /**
+   * Get number of passes which swapped the roles of the sides
+   */
+  int getNumRoleReversals() const { return numRoleReversals; }
+
+  /**
+   * Get number of pairs of buckets joined in blocks
+   */
+  int getNumBlockJoins() const { return numBlockJoins; }
+
+  bool execute(int numAvailableBufPages, File& resultFile);
+};
+
+/**
+ * Band predicate joining an INT attribute of the left table with one of the
+ * right table: the tuples match if
+ *   right + low <= left <= right + high,
+ * e.g. r.t BETWEEN s.t - k AND s.t + k.  A missing bound makes an inequality
+ * join, e.g. r.t < s.t.
+ */
+struct BandPredicate {
+  /**
+   * Attribute of the left table
+   */
+  string leftAttrName;
+
+  /**
+   * Attribute of the right table
+   */
+  string rightAttrName;
+
+  /**
+   * Is there a lower bound?
+   */
+  bool hasLow;
+
+  /**
+   * Lower bound, relative to the right value
+   */
+  std::int64_t low;
+
+  /**
+   * Is there an upper bound?
+   */
+  bool hasHigh;
+
+  /**
+   * Upper bound, relative to the right value
+   */
+  std::int64_t high;
+
+  /**
+   * left BETWEEN right - width AND right + width
+   */
+  static BandPredicate band(const string& left,
+                            const string& right,
+                            const int width) {
+    return between(left, right, -static_cast<std::int64_t>(width), width);
+  }
+
+  /**
+   * left BETWEEN right + low AND right + high
+   */
+  static BandPredicate between(const string& left,
+                               const string& right,
+                               const std::int64_t low,
+                               const std::int64_t high) {
+    BandPredicate predicate = {left, right, true, low, true, high};
+    return predicate;
+  }
+
+  /**
+   * left = right
+   */
+  static BandPredicate equal(const string& left, const string& right) {
+    return between(left, right, 0, 0);
+  }
+
+  /**
+   * left < right
+   */
+  static BandPredicate less(const string& left, const string& right) {
+    BandPredicate predicate = {left, right, false, 0, true, -1};
+    return predicate;
+  }
+
+  /**
+   * left <= right
+   */
+  static BandPredicate lessEqual(const string& left, const string& right) {
+    BandPredicate predicate = {left, right, false, 0, true, 0};
+    return predicate;
+  }
+
+  /**
+   * left > right
+   */
+  static BandPredicate greater(const string& left, const string& right) {
+    BandPredicate predicate = {left, right, true, 1, false, 0};
+    return predicate;
+  }
+
+  /**
+   * left >= right
+   */
+  static BandPredicate greaterEqual(const string& left, const string& right) {
+    BandPredicate predicate = {left, right, true, 0, false, 0};
+    return predicate;
+  }
+
+  /**
+   * Do the values match?
+   */
+  bool matches(const std::int64_t left, const std::int64_t right) const {
+    return (!hasLow || right + low <= left) &&
+           (!hasHigh || left <= right + high);
+  }
+
+  /**
+   * Get the predicate as text
+   */
+  string toString() const;
+};
+
+/**
+ * Band and inequality join.  Both tables are sorted on their join attribute
+ * with an external merge sort.  The sorted left table is then read in blocks
+ * as large as the memory allows; for each block the sorted right table is
+ * read from the first page which can hold a matching value to the last
+ * value which can match, and the matching left tuples of each right tuple are
+ * found by binary search in the block.  A narrow band thus reads the right
+ * table about once, and no pair of tuples outside the band is compared.
+ *
+ * The result keeps every attribute of both tables
+ * (see createConcatenatedTableSchema()).
+ */
+class BandJoinOperator : public JoinOperator {
+ private:
+  /**
+   * Join predicate
+   */
+  BandPredicate predicate;
+
+  /**
+   * Number of sorted runs written for both tables
+   */
+  int numSortedRuns;
+
+  /**
+   * Number of blocks of the left table
+   */
+  int numBlocks;
+
+ public:
+  /**
+   * Constructor
+   *
+   * @throws JoinPredicateException If an attribute of the predicate is not
+   * an INT attribute of its table
+   */
+  BandJoinOperator(const File& leftTableFile,
+                   const File& rightTableFile,
+                   const TableSchema& leftTableSchema,
+                   const TableSchema& rightTableSchema,
+                   const Catalog* catalog,
+                   BufMgr* bufMgr,
+                   const BandPredicate& predicate);
+
+  /**
+   * Get oprator's name (overrided)
+   */
+  string getOperatorName() const { return "BAND_JOIN"; }
+
+  /**
+   * Print running statistics (overrided)
+   */
+  void printRunningStats() const {
+    JoinOperator::printRunningStats();
+    cout << "# Sorted Runs: " << numSortedRuns << endl;
+    cout << "# Blocks: " << numBlocks << endl;
+  }
+
+  /**
+   * Get the join predicate
+   */
+  const BandPredicate& getPredicate() const { return predicate; }
+
+  /**
+   * Get number of sorted runs
+   */
+  int getNumSortedRuns() const { return numSortedRuns; }
+
+  /**
+   * Get number of blocks of the left table
+   */
+  int getNumBlocks() const { return numBlocks; }
+
+  bool execute(int numAvailableBufPages, File& resultFile);
+
+ protected:
+  /**
+   * Keeps every attribute of both tables, as the predicate joins on values
+   * that differ; join keys are not used
+   */
+  void updateResultTableSchema();
+};
+
+/**
+ * Join of two partitioned tables, one pair of partitions at a time.  Tables
+ * co-partitioned on a join attribute are joined partition by partition with
+ * the same number, so nothing is repartitioned; otherwise every pair of
+ * partitions is joined.  A range predicate on an INT attribute skips the
+ * partitions which cannot match and filters the others into temporary files
+ * where they hold keys outside the range.
+ */
+class PartitionWiseJoinOperator {
+ private:
+  /**
+   * Left and right tables
+   */
+  PartitionedTable& leftTable;
+  PartitionedTable& rightTable;
+
+  /**
+   * System catalog
+   */
+  const Catalog* catalog;
+
+  /**
+   * Buffer pool manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Schema of the result table
+   */
+  TableSchema resultTableSchema;
+
+  /**
+   * Join attributes of the left and the right table, pairwise
+   */
+  vector<string> leftKeyAttrNames;
+  vector<string> rightKeyAttrNames;
+
+  /**
+   * Attribute restricted by the predicate, empty for none
+   */
+  string rangeAttrName;
+
+  /**
+   * Keys selected by the predicate
+   */
+  KeyRange range;
+
+  /**
+   * Is the executor completed
+   */
+  bool isComplete;
+
+  /**
+   * Number of result tuples
+   */
+  int numResultTuples;
+
+  /**
+   * Highest number of buffer pages used by a partition join
+   */
+  int numUsedBufPages;
+
+  /**
+   * Number of I/Os carried out by the executor
+   */
+  int numIOs;
+
+  /**
+   * Number of pairs of partitions joined
+   */
+  int numPartitionJoins;
+
+  /**
+   * Number of partitions skipped by the predicate
+   */
+  int numPrunedPartitions;
+
+  /**
+   * Get the partitions of a table to join, pruned by the predicate, each
+   * filtered into a temporary file if it holds keys outside the range
+   */
+  vector<File*> selectPartitions(PartitionedTable& table,
+                                 SpillManager& spill,
+                                 vector<int>& partitions);
+
+ public:
+  /**
+   * Constructor
+   */
+  PartitionWiseJoinOperator(PartitionedTable& leftTable,
+                            PartitionedTable& rightTable,
+                            const Catalog* catalog,
+                            BufMgr* bufMgr);
+
+  /**
+   * Get the operator's name
+   */
+  string getOperatorName() const { return "PARTITION_WISE_JOIN"; }
+
+  /**
+   * Restrict the join to the tuples whose INT attribute lies in the range
+   *
+   * @throws PartitionException If neither table has such an INT attribute
+   */
+  void setKeyRange(const string& attrName, const KeyRange& range);
+
+  /**
+   * Join on the given attributes, see JoinOperator::setJoinKeys()
+   *
+   * @throws JoinPredicateException If the attributes cannot be paired
+   */
+  void setJoinKeys(const vector<string>& leftKeyAttrNames,
+                   const vector<string>& rightKeyAttrNames);
+
+  /**
+   * Are the tables co-partitioned on a pair of join attributes?
+   */
+  bool isCoPartitioned() const;
+
+  /**
+   * Execute the join
+   * @return If succeeded, return true
+   */
+  bool execute(int numAvailableBufPages, File& resultFile);
+
+  /**
+   * Print the running statistics of the executor
+   */
+  void printRunningStats() const;
+
+  /**
+   * Is the algorithm complete?
+   */
+  bool isCompleted() const { return isComplete; }
+
+  /**
+   * Get the schema of the result table
+   */
+  const TableSchema& getResultTableSchema() const { return resultTableSchema; }
+
+  /**
+   * Get number of result tuples
+   */
+  int getNumResultTuples() const { return numResultTuples; }
+
+  /**
+   * Get number of buffer pages used by the executor
+   */
+  int getNumUsedBufPages() const { return numUsedBufPages; }
+
+  /**
+   * Get number of I/Os carried out by the executor
+   */
+  int getNumIOs() const { return numIOs; }
+
+  /**
+   * Get number of pairs of partitions joined
+   */
+  int getNumPartitionJoins() const { return numPartitionJoins; }
+
+  /**
+   * Get number of partitions skipped by the predicate
+   */
+  int getNumPrunedPartitions() const { return numPrunedPartitions; }
+};
+
+/**
+ * Set operation between two tables
+ */
+enum SetOperation {
+  /**
+   * The tuples of either table
+   */
+  SET_UNION,
+
+  /**
+   * The tuples of the left table which are also in the right one
+   */
+  SET_INTERSECT,
+
+  /**
+   * The tuples of the left table which are not in the right one
+   */
+  SET_EXCEPT
+};
+
+/**
+ * Algorithm of a set operation
+ */
+enum SetStrategy {
+  /**
+   * One pass over each table with the distinct tuples in an in-memory hash
+   * table: those of the right table, and for UNION and EXCEPT also those
+   * returned.  Throws MemoryExceededException if they do not fit.
+   */
+  SET_ONE_PASS,
+
+  /**
+   * Both tables split by a hash of their tuples into as many partitions as
+   * there are buffer pages but one; each pair of partitions is processed in
+   * one pass, or split again if it does not fit.  With 3 pages or fewer the
+   * tables are sorted and merged as by SET_SORT_MERGE instead.
+   */
+  SET_HASH_PARTITION,
+
+  /**
+   * Both tables sorted with an external merge sort, then merged
+   */
+  SET_SORT_MERGE
+};
+
+/**
+ * UNION, INTERSECT or EXCEPT of two tables with the same attribute types.
+ * Tuples are compared as a whole, byte for byte, which is exact as equal
+ * values are always stored alike.  As in SQL without ALL, the result holds
+ * no duplicates; its attributes are named after those of the left table.
+ *
+ * The operator reads the tables once in one pass, and otherwise partitions or
+ * sorts them against the same buffer page budget as the joins, instead of
+ * joining them on every attribute and removing duplicates afterwards.
+ */
+class SetOperator {
+ private:
+  /**
+   * Data files of the left and the right table
+   */
+  const File& leftTableFile;
+  const File& rightTableFile;
+
+  /**
+   * Schemas of the left and the right table
+   */
+  const TableSchema& leftTableSchema;
+  const TableSchema& rightTableSchema;
+
+  /**
+   * Buffer pool manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Operation carried out
+   */
+  SetOperation operation;
+
+  /**
+   * Algorithm used
+   */
+  SetStrategy strategy;
+
+  /**
+   * Schema of the result table
+   */
+  TableSchema resultTableSchema;
+
+  /**
+   * Is the executor completed
+   */
+  bool isComplete;
+
+  /**
+   * Number of result tuples
+   */
+  int numResultTuples;
+
+  /**
+   * Number of buffer pages actually used by the executor
+   */
+  int numUsedBufPages;
+
+  /**
+   * Number of I/Os carried out by the executor
+   */
+  int numIOs;
+
+  /**
+   * Number of partitions written for both tables
+   */
+  int numPartitions;
+
+  /**
+   * Number of sorted runs written for both tables
+   */
+  int numSortedRuns;
+
+  /**
+   * Memory arena for the hash tables of the one-pass algorithm
+   */
+  Arena arena;
+
+  /**
+   * Memory charged by the executor against its buffer page budget
+   */
+  MemoryTracker memoryTracker;
+
+  /**
+   * Split an input into partitions by a hash of its tuples, seeded with the
+   * depth of the split
+   */
+  vector<OperatorInput> partition(const OperatorInput& input,
+                                  int depth,
+                                  int numParts,
+                                  SpillManager& spill);
+
+  /**
+   * Estimate the heap bytes an input takes in the hash table of the one-pass
+   * algorithm if none of its tuples repeat
+   */
+  size_t estimateHashTableBytes(const OperatorInput& input) const;
+
+  void executeOnePass(const OperatorInput& left,
+                      const OperatorInput& right,
+                      SpillManager& spill,
+                      File& resultFile);
+
+  void executeHashPartition(const OperatorInput& left,
+                            const OperatorInput& right,
+                            int depth,
+                            SpillManager& spill,
+                            File& resultFile);
+
+  void executeSortMerge(SpillManager& spill, File& resultFile);
+
+ public:
+  /**
+   * Constructor
+   *
+   * @throws SetOperationException If the tables differ in the number or
+   * types of their attributes, or in the length of a CHAR attribute
+   */
+  SetOperator(const File& leftTableFile,
+              const File& rightTableFile,
+              const TableSchema& leftTableSchema,
+              const TableSchema& rightTableSchema,
+              BufMgr* bufMgr,
+              SetOperation operation,
+              SetStrategy strategy);
+
+  /**
+   * Get the operator's name, e.g. UNION
+   */
+  string getOperatorName() const;
+
+  /**
+   * Execute the operation
+   * @return If succeeded, return true
+   */
+  bool execute(int numAvailableBufPages, File& resultFile);
+
+  /**
+   * Print the running statistics of the executor
+   */
+  void printRunningStats() const;
+
+  /**
+   * Is the algorithm complete?
+   */
+  bool isCompleted() const { return isComplete; }
+
+  /**
+   * Get the operation carried out
+   */
+  SetOperation getOperation() const { return operation; }
+
+  /**
+   * Get the algorithm used
+   */
+  SetStrategy getStrategy() const { return strategy; }
+
+  /**
+   * Get the schema of the result table
+   */
+  const TableSchema& getResultTableSchema() const { return resultTableSchema; }
+
+  /**
+   * Get number of result tuples
+   */
+  int getNumResultTuples() const { return numResultTuples; }
+
+  /**
+   * Get number of buffer pages used by the executor
+   */
+  int getNumUsedBufPages() const { return numUsedBufPages; }
+
+  /**
+   * Get number of I/Os carried out by the executor
+   */
+  int getNumIOs() const { return numIOs; }
+
+  /**
+   * Get number of partitions written for both tables
+   */
+  int getNumPartitions() const { return numPartitions; }
+
+  /**
+   * Get number of sorted runs written for both tables
+   */
+  int getNumSortedRuns() const { return numSortedRuns; }
+
+  /**
+   * Get the memory accounting of the executor
+   */
+  const MemoryTracker& getMemoryTracker() const { return memoryTracker; }
 };
 
 }  // namespace badgerdb
\ No newline at end of file
@@ -0,0 +1,188 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "external_sort.h"
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+
+#include "file_iterator.h"
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Heap bytes charged for a tuple held in memory
+ */
+std::size_t tupleBytes(const std::string& tuple) {
+  return sizeof(std::string) + tuple.size();
+}
+
+/**
+ * Orders the readers of a merge by their current tuple, the earlier run
+ * first among equal tuples.  std::priority_queue keeps the greatest on top,
+ * so the order is reversed.
+ */
+struct MergeOrder {
+  const ExternalSorter::Less* less;
+  const std::vector<std::string>* current;
+
+  bool operator()(const std::size_t lhs, const std::size_t rhs) const {
+    const std::string& l = (*current)[lhs];
+    const std::string& r = (*current)[rhs];
+    if ((*less)(r, l)) {
+      return true;
+    }
+    return !(*less)(l, r) && rhs < lhs;
+  }
+};
+
+}  // namespace
+
+ExternalSorter::ExternalSorter(SpillManager* spill,
+                               BufMgr* bufMgr,
+                               MemoryTracker* memoryTracker,
+                               const Less& less)
+    : spill(spill),
+      bufMgr(bufMgr),
+      memoryTracker(memoryTracker),
+      less(less),
+      bytesCharged(0),
+      numRuns(0),
+      numMergePasses(0),
+      numIOs(0) {
+  // nothing
+}
+
+ExternalSorter::~ExternalSorter() {
+  memoryTracker->releaseBytes(bytesCharged);
+}
+
+void ExternalSorter::add(const std::string& tuple) {
+  // keep a page for the writer of the run
+  if (!tuples.empty() &&
+      !memoryTracker->canCharge(1, tupleBytes(tuple))) {
+    writeRun();
+  }
+  memoryTracker->chargeBytes(tupleBytes(tuple));
+  bytesCharged += tupleBytes(tuple);
+  tuples.push_back(tuple);
+}
+
+void ExternalSorter::addFile(const File& input) {
+  File file = File::open(input.filename());
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    memoryTracker->chargeFrames(1);
+    ++numIOs;
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end(); ++page_iter) {
+      add(*page_iter);
+    }
+    memoryTracker->releaseFrames(1);
+  }
+}
+
+File* ExternalSorter::finish() {
+  if (runs.empty() || !tuples.empty()) {
+    writeRun();
+  }
+  // merge groups of adjacent runs, so that equal tuples keep their order
+  while (runs.size() > 1) {
+    const int fanIn = memoryTracker->getBudgetPages() -
+                      memoryTracker->getUsedPages() - 1;
+    const std::size_t groupSize =
+        static_cast<std::size_t>(std::max(fanIn, 2));
+    std::vector<File*> merged;
+    const bool last = runs.size() <= groupSize;
+    for (std::size_t i = 0; i < runs.size(); i += groupSize) {
+      const std::size_t end = std::min(runs.size(), i + groupSize);
+      const std::vector<File*> group(runs.begin() + i, runs.begin() + end);
+      merged.push_back(group.size() == 1 ? group[0] : merge(group, last));
+    }
+    runs.swap(merged);
+    ++numMergePasses;
+  }
+  File* result = runs[0];
+  runs.clear();
+  return result;
+}
+
+void ExternalSorter::writeRun() {
+  std::stable_sort(tuples.begin(), tuples.end(), less);
+  File* run = spill->create("run");
+  pageHeads.clear();
+  {
+    SpillWriter writer(spill, run);
+    memoryTracker->chargeFrames(1);
+    for (std::size_t i = 0; i < tuples.size(); ++i) {
+      const std::size_t pages = writer.getNumPages();
+      writer.append(tuples[i]);
+      if (writer.getNumPages() != pages) {
+        pageHeads.push_back(tuples[i]);
+      }
+    }
+    memoryTracker->releaseFrames(1);
+    numIOs += writer.getNumPages();
+  }
+  tuples.clear();
+  memoryTracker->releaseBytes(bytesCharged);
+  bytesCharged = 0;
+  runs.push_back(run);
+  ++numRuns;
+}
+
+File* ExternalSorter::merge(const std::vector<File*>& inputs,
+                            const bool last) {
+  // one pinned page per reader and one for the writer
+  memoryTracker->chargeFrames(static_cast<int>(inputs.size()) + 1);
+  std::vector<std::unique_ptr<SpillReader> > readers;
+  std::vector<std::string> current(inputs.size());
+  MergeOrder order = {&less, &current};
+  std::priority_queue<std::size_t, std::vector<std::size_t>, MergeOrder>
+      heap(order);
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    readers.push_back(
+        std::unique_ptr<SpillReader>(new SpillReader(spill, inputs[i])));
+    if (readers[i]->next(current[i])) {
+      heap.push(i);
+    }
+  }
+
+  File* output = spill->create("run");
+  if (last) {
+    pageHeads.clear();
+  }
+  {
+    SpillWriter writer(spill, output);
+    while (!heap.empty()) {
+      const std::size_t i = heap.top();
+      heap.pop();
+      const std::size_t pages = writer.getNumPages();
+      writer.append(current[i]);
+      if (last && writer.getNumPages() != pages) {
+        pageHeads.push_back(current[i]);
+      }
+      if (readers[i]->next(current[i])) {
+        heap.push(i);
+      }
+    }
+    numIOs += writer.getNumPages();
+  }
+  for (std::size_t i = 0; i < readers.size(); ++i) {
+    numIOs += readers[i]->getNumPagesRead();
+    readers[i].reset();
+    spill->remove(inputs[i]);
+  }
+  memoryTracker->releaseFrames(static_cast<int>(inputs.size()) + 1);
+  return output;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,173 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "memory_tracker.h"
+#include "spill_manager.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Sorts tuples with an external merge sort.
+ *
+ * Tuples are gathered in memory until the memory budget is used up; each such
+ * run is sorted and written to a temporary file.  The runs are then merged,
+ * as many at a time as there are buffer pages left for readers, until one
+ * file holds all tuples in order.  Equal tuples keep the order in which they
+ * were added.
+ *
+ * The tuples held in memory and the pinned pages are charged to the memory
+ * tracker of the calling operator, so the sort uses what is left of its
+ * budget.  The runs and the result are files of the given SpillManager.
+ */
+class ExternalSorter {
+ public:
+  /**
+   * Ordering of the tuples
+   */
+  typedef std::function<bool(const std::string&, const std::string&)> Less;
+
+  /**
+   * Constructor
+   *
+   * @param spill          Manager of the temporary files.
+   * @param bufMgr         Buffer manager.
+   * @param memoryTracker  Tracker of the memory of the calling operator.
+   * @param less           Ordering of the tuples.
+   */
+  ExternalSorter(SpillManager* spill,
+                 BufMgr* bufMgr,
+                 MemoryTracker* memoryTracker,
+                 const Less& less);
+
+  /**
+   * Destructor that releases the memory still charged
+   */
+  ~ExternalSorter();
+
+  ExternalSorter(const ExternalSorter&) = delete;
+  ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+  /**
+   * Adds a tuple to the sort.
+   *
+   * @throws MemoryExceededException If not even one tuple fits in memory
+   */
+  void add(const std::string& tuple);
+
+  /**
+   * Adds every tuple of a heap file to the sort.
+   */
+  void addFile(const File& file);
+
+  /**
+   * Merges the runs into one sorted file.  The sorter can be used again
+   * afterwards.
+   *
+   * @return  Temporary file of the spill manager, read with a SpillReader
+   * @throws MemoryExceededException If fewer than two runs can be merged at
+   * a time
+   */
+  File* finish();
+
+  /**
+   * Get the first tuple of each page of the last sorted file, an index for
+   * SpillReader::seek()
+   */
+  const std::vector<std::string>& getPageHeads() const { return pageHeads; }
+
+  /**
+   * Get the number of runs written
+   */
+  int getNumRuns() const { return numRuns; }
+
+  /**
+   * Get the number of merge passes
+   */
+  int getNumMergePasses() const { return numMergePasses; }
+
+  /**
+   * Get the number of pages read and written
+   */
+  int getNumIOs() const { return numIOs; }
+
+ private:
+  /**
+   * Sorts the tuples in memory and writes them to a new run.
+   */
+  void writeRun();
+
+  /**
+   * Merges runs into a new run.
+   */
+  File* merge(const std::vector<File*>& inputs, const bool last);
+
+  /**
+   * Manager of the temporary files
+   */
+  SpillManager* spill;
+
+  /**
+   * Buffer manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Tracker of the memory of the calling operator
+   */
+  MemoryTracker* memoryTracker;
+
+  /**
+   * Ordering of the tuples
+   */
+  Less less;
+
+  /**
+   * Tuples of the current run
+   */
+  std::vector<std::string> tuples;
+
+  /**
+   * Heap bytes charged for the tuples of the current run
+   */
+  std::size_t bytesCharged;
+
+  /**
+   * Runs written so far
+   */
+  std::vector<File*> runs;
+
+  /**
+   * First tuple of each page of the last sorted file
+   */
+  std::vector<std::string> pageHeads;
+
+  /**
+   * Number of runs written
+   */
+  int numRuns;
+
+  /**
+   * Number of merge passes
+   */
+  int numMergePasses;
+
+  /**
+   * Number of pages read and written
+   */
+  int numIOs;
+};
+
+}  // namespace badgerdb
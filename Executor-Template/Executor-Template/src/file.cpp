@@ -7,14 +7,23 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
 #include <cassert>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
@@ -23,8 +32,13 @@
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+File::HandleMap File::open_files_;
 File::CountMap File::open_counts_;
+std::mutex File::registry_mutex_;
+
+File::Handle::~Handle() {
+  ::close(fd);
+}
 
 File File::create(const std::string& filename) {
   return File(filename, true /* create_new */);
@@ -38,7 +52,8 @@ void File::remove(const std::string& filename) {
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
   }
-  if (isOpen(filename)) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  if (open_counts_.find(filename) != open_counts_.end()) {
     throw FileOpenException(filename);
   }
   std::remove(filename.c_str());
@@ -48,6 +63,7 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
+  std::lock_guard<std::mutex> lock(registry_mutex_);
   return open_counts_.find(filename) != open_counts_.end();
 }
 
@@ -64,7 +80,8 @@ bool File::exists(const std::string& filename) {
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+    handle_(other.handle_) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
   ++open_counts_[filename_];
 }
 
@@ -82,13 +99,55 @@ File::~File() {
 }
 
 Page File::allocatePage() {
+  std::lock_guard<std::mutex> lock(handle_->structure);
+  FileHeader header = readHeader();
+  return allocatePageLocked(
+      header, header.num_free_pages > 0 ? header.first_free_page
+                                        : header.num_pages);
+}
+
+Page File::allocatePage(const PageId page_number) {
+  std::lock_guard<std::mutex> lock(handle_->structure);
   FileHeader header = readHeader();
+  if (page_number < header.num_pages &&
+      readPageHeader(page_number).current_page_number !=
+          Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  // pages skipped over at the end of the file become free pages
+  while (header.num_pages < page_number) {
+    Page free_page;
+    free_page.set_next_page_number(header.first_free_page);
+    writePage(header.num_pages, free_page);
+    header.first_free_page = header.num_pages;
+    ++header.num_free_pages;
+    ++header.num_pages;
+  }
+  return allocatePageLocked(header, page_number);
+}
+
+Page File::allocatePageLocked(FileHeader& header, const PageId page_number) {
   Page new_page;
   Page existing_page;
-  if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+  if (page_number < header.num_pages) {
+    new_page = readPage(page_number, true /* allow_free */);
+    // unlink the page from the free list
+    if (header.first_free_page == page_number) {
+      header.first_free_page = new_page.next_page_number();
+    } else {
+      PageId previous = header.first_free_page;
+      PageId next = readPageHeader(previous).next_page_number;
+      while (next != page_number) {
+        assert(next != Page::INVALID_NUMBER);
+        previous = next;
+        next = readPageHeader(previous).next_page_number;
+      }
+      Page previous_page = readPage(previous, true /* allow_free */);
+      previous_page.set_next_page_number(new_page.next_page_number());
+      writePage(previous, previous_page);
+    }
+    new_page.set_page_number(page_number);
+    new_page.set_next_page_number(Page::INVALID_NUMBER);
     --header.num_free_pages;
 
     if (header.first_used_page == Page::INVALID_NUMBER ||
@@ -118,6 +177,7 @@ Page File::allocatePage() {
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   } else {
+    assert(page_number == header.num_pages);
     new_page.set_page_number(header.num_pages);
     if (header.first_used_page == Page::INVALID_NUMBER) {
       header.first_used_page = new_page.page_number();
@@ -156,9 +216,11 @@ Page File::readPage(const PageId page_number) const {
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  // one read of the whole page, header and data together
+  char buffer[Page::SIZE];
+  readAt(buffer, Page::SIZE, pagePosition(page_number));
+  std::memcpy(&page.header_, buffer, sizeof(page.header_));
+  page.data_.assign(buffer + sizeof(page.header_), Page::DATA_SIZE);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -167,6 +229,9 @@ Page File::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void File::writePage(const Page& new_page) {
+  // The next page pointer read below must not change before the page is
+  // written back, or an allocatePage() linking this page would be lost.
+  std::lock_guard<std::mutex> lock(handle_->structure);
   PageHeader header = readPageHeader(new_page.page_number());
   if (header.current_page_number == Page::INVALID_NUMBER) {
     // Page has been deleted since it was read.
@@ -182,6 +247,7 @@ void File::writePage(const Page& new_page) {
 }
 
 void File::deletePage(const PageId page_number) {
+  std::lock_guard<std::mutex> lock(handle_->structure);
   FileHeader header = readHeader();
   Page existing_page = readPage(page_number);
   Page previous_page;
@@ -211,6 +277,44 @@ void File::deletePage(const PageId page_number) {
   writeHeader(header);
 }
 
+int File::sortPageLists() {
+  std::lock_guard<std::mutex> lock(handle_->structure);
+  FileHeader header = readHeader();
+  // Sort the pages by their own headers rather than by following the links,
+  // which a relink cut short by a crash may have left broken or cyclic.
+  std::vector<PageId> used_pages;
+  std::vector<PageId> free_pages;
+  for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+    if (readPageHeader(page_number).current_page_number !=
+        Page::INVALID_NUMBER) {
+      used_pages.push_back(page_number);
+    } else {
+      free_pages.push_back(page_number);
+    }
+  }
+  int num_written = relinkPageList(used_pages);
+  num_written += relinkPageList(free_pages);
+  const PageId first_used_page =
+      used_pages.empty() ? Page::INVALID_NUMBER : used_pages.front();
+  const PageId first_free_page =
+      free_pages.empty() ? Page::INVALID_NUMBER : free_pages.front();
+  if (header.first_used_page != first_used_page ||
+      header.first_free_page != first_free_page ||
+      header.num_free_pages != free_pages.size()) {
+    header.first_used_page = first_used_page;
+    header.first_free_page = first_free_page;
+    header.num_free_pages = free_pages.size();
+    writeHeader(header);
+  }
+  return num_written;
+}
+
+PageId File::getNumUsedPages() const {
+  std::lock_guard<std::mutex> lock(handle_->structure);
+  const FileHeader header = readHeader();
+  return header.num_pages - 1 /* header */ - header.num_free_pages;
+}
+
 FileIterator File::begin() {
   const FileHeader& header = readHeader();
   return FileIterator(this, header.first_used_page);
@@ -225,44 +329,61 @@ File::File(const std::string& name, const bool create_new) : filename_(name) {
 
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FORMAT_MAGIC, FORMAT_VERSION, 1 /* num_pages */,
+                         0 /* first_used_page */, 0 /* num_free_pages */,
+                         0 /* first_free_page */};
     writeHeader(header);
+  } else {
+    const FileHeader header = readHeader();
+    if (header.magic != FORMAT_MAGIC || header.version != FORMAT_VERSION) {
+      close();
+      throw FileFormatException(
+          filename_, header.magic == FORMAT_MAGIC ? header.version : 0,
+          FORMAT_VERSION);
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    handle_ = open_files_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
-    const bool already_exists = exists(filename_);
+    int flags = O_RDWR;
     if (create_new) {
-      // Error if we try to overwrite an existing file.
-      if (already_exists) {
+      // Error if we try to overwrite an existing file; O_EXCL makes the check
+      // and the creation one step.
+      flags |= O_CREAT | O_EXCL | O_TRUNC;
+    }
+    int fd;
+    do {
+      fd = ::open(filename_.c_str(), flags, 0644);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+      if (create_new && errno == EEXIST) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
-    } else {
-      // Error if we try to open a file that doesn't exist.
-      if (!already_exists) {
+      if (errno == ENOENT) {
+        // Error if we try to open a file that doesn't exist (or to create one
+        // in a directory that doesn't).
         throw FileNotFoundException(filename_);
       }
+      // e.g. no permission or out of descriptors: the file may well exist
+      throw FileIOException(filename_, create_new ? "create" : "open", errno);
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    handle_ = std::make_shared<Handle>(fd);
+    open_files_[filename_] = handle_;
     open_counts_[filename_] = 1;
   }
 }
 
 void File::close() {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
   --open_counts_[filename_];
-  stream_.reset();
+  handle_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_files_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
@@ -273,33 +394,88 @@ void File::writePage(const PageId page_number, const Page& new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  // one write of the whole page, so a concurrent reader of the page sees
+  // either the old or the new copy of the header together with its data
+  char buffer[Page::SIZE];
+  std::memcpy(buffer, &header, sizeof(header));
+  std::memcpy(buffer + sizeof(header), new_page.data_.data(),
+              Page::DATA_SIZE);
+  writeAt(buffer, Page::SIZE, pagePosition(page_number));
+}
+
+int File::relinkPageList(const std::vector<PageId>& pages) {
+  int num_written = 0;
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    const PageId next_page_number =
+        i + 1 < pages.size() ? pages[i + 1] : Page::INVALID_NUMBER;
+    Page page = readPage(pages[i], true /* allow_free */);
+    if (page.next_page_number() != next_page_number) {
+      page.set_next_page_number(next_page_number);
+      writePage(pages[i], page);
+      ++num_written;
+    }
+  }
+  return num_written;
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  readAt(&header, sizeof(header), 0 /* offset */);
 
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  writeAt(&header, sizeof(header), 0 /* offset */);
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  readAt(&header, sizeof(header), pagePosition(page_number));
 
   return header;
 }
 
+void File::readAt(void* data, const std::size_t length,
+                  const std::streamoff offset) const {
+  char* out = static_cast<char*>(data);
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(handle_->fd, out + done, length - done,
+                              static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw FileIOException(filename_, "read", errno);
+    }
+    if (n == 0) {
+      break;  // end of file
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  std::memset(out + done, 0, length - done);
+}
+
+void File::writeAt(const void* data, const std::size_t length,
+                   const std::streamoff offset) {
+  const char* in = static_cast<const char*>(data);
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(handle_->fd, in + done, length - done,
+                               static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw FileIOException(filename_, "write", errno);
+    }
+    if (n == 0) {
+      // no progress without an error, e.g. a full device
+      throw FileIOException(filename_, "write", ENOSPC);
+    }
+    done += static_cast<std::size_t>(n);
+  }
+}
+
 }
@@ -7,10 +7,12 @@
 
 #pragma once
 
-#include <fstream>
+#include <ios>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "page.h"
 
@@ -22,6 +24,17 @@ namespace badgerdb {
  * @brief Header metadata for files on disk which contain pages.
  */
     struct FileHeader {
+        /**
+         * File::FORMAT_MAGIC, marking a database file.
+         */
+        std::uint32_t magic;
+
+        /**
+         * On-disk format of the file header and pages, File::FORMAT_VERSION
+         * for files written by this build.
+         */
+        std::uint32_t version;
+
         /**
          * Number of pages allocated in the file.
          */
@@ -60,18 +73,40 @@ namespace badgerdb {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the same
+ * underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_files_ map) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again.
+ *
+ * Files may be opened, copied and closed from several threads.  Pages are read
+ * and written at their offset with a single positioned call (pread/pwrite),
+ * so the File objects of one file keep no shared seek position and parallel
+ * scans neither disturb nor wait for each other.  Changes to the file header
+ * and to the list of used pages (allocatePage(), deletePage() and
+ * writePage()) are serialized per file; a page itself must not be written by
+ * two threads at once, which the buffer manager ensures.
  *
- * @warning This class is not threadsafe.
+ * The file header starts with a magic number and the format version, and
+ * open() refuses files written in another format, since their pages would be
+ * misread (e.g. files from before page headers carried an LSN).
  */
     class File {
     public:
+        /**
+         * Magic number at the start of every database file.
+         */
+        static const std::uint32_t FORMAT_MAGIC = 0x42444742;
+
+        /**
+         * Version of the on-disk format written by this build.  Bumped
+         * whenever the layout of the file header, page header or slots
+         * changes.
+         */
+        static const std::uint32_t FORMAT_VERSION = 2;
+
         /**
          * Creates a new file.
          *
@@ -82,13 +117,15 @@ namespace badgerdb {
 
         /**
          * Opens the file named fileName and returns the corresponding File object.
-           * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+           * It first checks if the file is already open. If so, then the new File object created uses the same descriptor to read to or write fom
            * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-           * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-           * open_streams_ map.
+           * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+           * open_files_ map.
          *
          * @param filename  Name of the file.
          * @throws  FileNotFoundException   If the requested file doesn't exist.
+         * @throws  FileIOException         If the file exists but cannot be opened.
+         * @throws  FileFormatException     If the file is not in FORMAT_VERSION.
          */
         static File open(const std::string &filename);
 
@@ -145,6 +182,18 @@ namespace badgerdb {
          */
         Page allocatePage();
 
+        /**
+         * Allocates the page with the given number, which must not be in use.
+         * The page is taken off the free list, or the file is extended up to
+         * it, the pages skipped over becoming free pages.  Used by recovery to
+         * redo a logged allocation exactly.
+         *
+         * @param page_number   Number of page to allocate.
+         * @return The new page.
+         * @throws  InvalidPageException  If the page is already in use.
+         */
+        Page allocatePage(const PageId page_number);
+
         /**
          * Reads an existing page from the file.
          *
@@ -171,6 +220,30 @@ namespace badgerdb {
          */
         void deletePage(const PageId page_number);
 
+        /**
+         * Relinks the list of used pages and the list of free pages so that each
+         * follows the physical order of its pages.  Scans then read the file
+         * sequentially, and allocatePage() reuses the lowest free page first.
+         * Pages whose links are already in order are not written.
+         *
+         * The lists are rebuilt from the header of every page, not by following
+         * the links, so running it again repairs lists left inconsistent by a
+         * relink cut short by a crash.  The pages are written directly, not
+         * through the buffer pool; BufMgr::sortPageLists() logs the relink
+         * first so that recovery can repeat it.
+         *
+         * @return  Number of pages rewritten.
+         */
+        int sortPageLists();
+
+        /**
+         * Returns the number of pages holding data, taken from the file header
+         * alone, so that no page is read.
+         *
+         * @return  Number of used pages.
+         */
+        PageId getNumUsedPages() const;
+
         /**
          * Returns the name of the file this object represents.
          *
@@ -218,13 +291,15 @@ namespace badgerdb {
          *                                  create_new is true.
          * @throws  FileNotFoundException   If the underlying file doesn't exist and
          *                                  create_new is false.
+         * @throws  FileFormatException     If create_new is false and the file is
+         *                                  not in FORMAT_VERSION.
          */
         File(const std::string &name, const bool create_new);
 
         /**
          * Opens the underlying file named in filename_.
          * This method only opens the file if no other File objects exist that access
-         * the same filesystem file; otherwise, it reuses the existing stream.
+         * the same filesystem file; otherwise, it reuses the existing descriptor.
          *
          * @param create_new  Whether to create a new file.
          * @throws  FileExistsException     If the underlying file exists and
@@ -235,7 +310,18 @@ namespace badgerdb {
         void openIfNeeded(const bool create_new);
 
         /**
-         * Closes the underlying file stream in <stream_>.
+         * Allocates the given page, which is either a free page or the page
+         * just past the end of the file, and links it into the used list.
+         * The structure mutex must be held; the header is written back.
+         *
+         * @param header        File header, updated.
+         * @param page_number   Number of page to allocate.
+         * @return The new page.
+         */
+        Page allocatePageLocked(FileHeader &header, const PageId page_number);
+
+        /**
+         * Closes the underlying file descriptor in <handle_>.
          * This method only closes the file if no other File objects exist that access
          * the same file.
          */
@@ -245,8 +331,8 @@ namespace badgerdb {
          * Reads a page from the file.  If <allow_free> is not set, an exception
          * will be thrown if the page read from disk is not currently in use.
          *
-         * No bounds checking is performed; the underlying file stream will throw
-         * an exception if the page is past the end of the file.
+         * No bounds checking is performed; a page past the end of the file is read
+         * as zeros, i.e. as a free page.
          *
          * @param page_number   Number of page to read.
          * @param allow_free    Whether to allow reading a free (unused) page.
@@ -301,29 +387,85 @@ namespace badgerdb {
          */
         PageHeader readPageHeader(const PageId page_number) const;
 
+        /**
+         * Links pages into a list in the given order.  The structure mutex must
+         * be held.
+         *
+         * @param pages   Pages of the list.
+         * @return  Number of pages rewritten.
+         */
+        int relinkPageList(const std::vector<PageId>& pages);
+
+        /**
+         * Reads length bytes at the given offset.  Bytes past the end of the file
+         * are read as zeros.
+         *
+         * @throws  FileIOException  If the read fails.
+         */
+        void readAt(void *data, const std::size_t length,
+                    const std::streamoff offset) const;
+
+        /**
+         * Writes length bytes at the given offset.  Short writes are retried
+         * until every byte is written.
+         *
+         * @throws  FileIOException  If the write fails.
+         */
+        void writeAt(const void *data, const std::size_t length,
+                     const std::streamoff offset);
+
+        /**
+         * @brief Open descriptor of a file, shared by all File objects for it
+         *        and closed when the last of them is gone.
+         */
+        struct Handle {
+            /**
+             * Descriptor of the open file.
+             */
+            int fd;
+
+            /**
+             * Serializes changes to the file header and the used page list.
+             */
+            std::mutex structure;
+
+            explicit Handle(const int fd) : fd(fd) {}
+
+            ~Handle();
+
+            Handle(const Handle &) = delete;
+
+            Handle &operator=(const Handle &) = delete;
+        };
+
         typedef std::map<std::string,
-                std::shared_ptr<std::fstream> > StreamMap;
+                std::shared_ptr<Handle> > HandleMap;
         typedef std::map<std::string, int> CountMap;
 
         /**
-         * Streams for opened files.
+         * Descriptors for opened files.
          */
-        static StreamMap open_streams_;
+        static HandleMap open_files_;
 
         /**
          * Counts for opened files.
          */
         static CountMap open_counts_;
 
+        /**
+         * Protects open_files_ and open_counts_.
+         */
+        static std::mutex registry_mutex_;
+
         /**
          * Name of the file this object represents.
          */
         std::string filename_;
 
         /**
-         * Stream for underlying filesystem object.
+         * Descriptor for underlying filesystem object.
          */
-        std::shared_ptr<std::fstream> stream_;
+        std::shared_ptr<Handle> handle_;
 
         friend class FileIterator;
 
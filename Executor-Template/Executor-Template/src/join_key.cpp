@@ -0,0 +1,204 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "join_key.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "exceptions/join_predicate_exception.h"
+
+namespace badgerdb {
+
+JoinKeyExtractor::JoinKeyExtractor(
+    const TableSchema& tableSchema,
+    const std::vector<std::string>& keyAttrNames)
+    : firstVarchar(static_cast<std::size_t>(tableSchema.getAttrCount())) {
+  std::size_t offset = 0;
+  fixedOffsets.push_back(0);
+  for (int i = 0; i < tableSchema.getAttrCount(); ++i) {
+    Field field;
+    field.type = tableSchema.getAttrType(i);
+    field.inKey = false;
+    switch (field.type) {
+      case INT: {
+        field.length = 4;
+        field.width = 4;
+        break;
+      }
+      case CHAR: {
+        field.length = tableSchema.getAttrMaxSize(i);
+        field.width = field.length + (4 - (field.length % 4)) % 4;
+        break;
+      }
+      case VARCHAR: {
+        field.length = 0;
+        field.width = 0;
+        firstVarchar = std::min(firstVarchar, fields.size());
+        break;
+      }
+    }
+    if (firstVarchar > fields.size()) {
+      offset += field.width;
+      fixedOffsets.push_back(offset);
+    }
+    fields.push_back(field);
+  }
+  for (std::size_t i = 0; i < keyAttrNames.size(); ++i) {
+    const int attrNum = tableSchema.getAttrNum(keyAttrNames[i]);
+    keyAttrs.push_back(attrNum);
+    fields[attrNum].inKey = true;
+  }
+}
+
+const std::vector<std::size_t>& JoinKeyExtractor::locate(
+    const std::string& tuple,
+    std::vector<std::size_t>& offsets) const {
+  if (firstVarchar == fields.size()) {
+    return fixedOffsets;
+  }
+  offsets.assign(fixedOffsets.begin(), fixedOffsets.end());
+  std::size_t offset = offsets[firstVarchar];
+  for (std::size_t i = firstVarchar; i < fields.size(); ++i) {
+    if (fields[i].type == VARCHAR) {
+      const std::size_t actual_len =
+          offset < tuple.size() ? static_cast<unsigned char>(tuple[offset])
+                                : 0;
+      offset += 1 + actual_len + (4 - ((actual_len + 1) % 4)) % 4;
+    } else {
+      offset += fields[i].width;
+    }
+    offsets.push_back(offset);
+  }
+  return offsets;
+}
+
+void JoinKeyExtractor::extractKey(const std::string& tuple,
+                                  std::string& key) const {
+  std::vector<std::size_t> scratch;
+  appendKey(tuple, locate(tuple, scratch), key);
+}
+
+void JoinKeyExtractor::appendKey(const std::string& tuple,
+                                 const std::vector<std::size_t>& at,
+                                 std::string& key) const {
+  for (std::size_t i = 0; i < keyAttrs.size(); ++i) {
+    const int attrNum = keyAttrs[i];
+    const std::size_t offset = std::min(at[attrNum], tuple.size());
+    const std::size_t length =
+        fields[attrNum].type == VARCHAR
+            ? (offset < tuple.size()
+                   ? 1 + static_cast<unsigned char>(tuple[offset])
+                   : 0)
+            : fields[attrNum].length;
+    key.append(tuple, offset, length);
+  }
+}
+
+void JoinKeyExtractor::extract(const std::string& tuple,
+                               std::string& key,
+                               std::string& rest) const {
+  std::vector<std::size_t> scratch;
+  const std::vector<std::size_t>& at = locate(tuple, scratch);
+  appendKey(tuple, at, key);
+  for (std::size_t i = 0; i < fields.size(); ++i) {
+    if (!fields[i].inKey) {
+      const std::size_t offset = std::min(at[i], tuple.size());
+      rest.append(tuple, offset, at[i + 1] - at[i]);
+    }
+  }
+}
+
+std::vector<std::string> JoinKeyExtractor::naturalKeyAttrNames(
+    const TableSchema& leftTableSchema,
+    const TableSchema& rightTableSchema) {
+  std::vector<std::string> names;
+  for (int i = 0; i < rightTableSchema.getAttrCount(); ++i) {
+    const int j = leftTableSchema.getAttrNum(rightTableSchema.getAttrName(i));
+    if (j >= 0 &&
+        leftTableSchema.getAttrType(j) == rightTableSchema.getAttrType(i)) {
+      names.push_back(rightTableSchema.getAttrName(i));
+    }
+  }
+  return names;
+}
+
+void JoinKeyExtractor::checkKeyAttrs(
+    const TableSchema& leftTableSchema,
+    const std::vector<std::string>& leftKeyAttrNames,
+    const TableSchema& rightTableSchema,
+    const std::vector<std::string>& rightKeyAttrNames) {
+  const std::string predicate =
+      toString(leftTableSchema, leftKeyAttrNames, rightTableSchema,
+               rightKeyAttrNames);
+  if (leftKeyAttrNames.size() != rightKeyAttrNames.size()) {
+    throw JoinPredicateException(predicate,
+                                 "the key lists differ in length");
+  }
+  for (std::size_t i = 0; i < leftKeyAttrNames.size(); ++i) {
+    const int l = leftTableSchema.getAttrNum(leftKeyAttrNames[i]);
+    const int r = rightTableSchema.getAttrNum(rightKeyAttrNames[i]);
+    if (l < 0) {
+      throw JoinPredicateException(predicate,
+                                   leftTableSchema.getTableName() +
+                                       " has no attribute " +
+                                       leftKeyAttrNames[i]);
+    }
+    if (r < 0) {
+      throw JoinPredicateException(predicate,
+                                   rightTableSchema.getTableName() +
+                                       " has no attribute " +
+                                       rightKeyAttrNames[i]);
+    }
+    if (std::count(leftKeyAttrNames.begin(), leftKeyAttrNames.end(),
+                   leftKeyAttrNames[i]) > 1 ||
+        std::count(rightKeyAttrNames.begin(), rightKeyAttrNames.end(),
+                   rightKeyAttrNames[i]) > 1) {
+      throw JoinPredicateException(predicate,
+                                   "an attribute is named twice");
+    }
+    if (leftTableSchema.getAttrType(l) != rightTableSchema.getAttrType(r)) {
+      throw JoinPredicateException(predicate,
+                                   leftKeyAttrNames[i] + " and " +
+                                       rightKeyAttrNames[i] +
+                                       " differ in type");
+    }
+    if (leftTableSchema.getAttrType(l) == CHAR &&
+        leftTableSchema.getAttrMaxSize(l) !=
+            rightTableSchema.getAttrMaxSize(r)) {
+      throw JoinPredicateException(predicate,
+                                   leftKeyAttrNames[i] + " and " +
+                                       rightKeyAttrNames[i] +
+                                       " differ in length");
+    }
+  }
+}
+
+std::string JoinKeyExtractor::toString(
+    const TableSchema& leftTableSchema,
+    const std::vector<std::string>& leftKeyAttrNames,
+    const TableSchema& rightTableSchema,
+    const std::vector<std::string>& rightKeyAttrNames) {
+  std::stringstream ss;
+  const std::size_t count =
+      std::max(leftKeyAttrNames.size(), rightKeyAttrNames.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i > 0) {
+      ss << " AND ";
+    }
+    ss << leftTableSchema.getTableName() << "."
+       << (i < leftKeyAttrNames.size() ? leftKeyAttrNames[i] : "?") << " = "
+       << rightTableSchema.getTableName() << "."
+       << (i < rightKeyAttrNames.size() ? rightKeyAttrNames[i] : "?");
+  }
+  if (count == 0) {
+    ss << "TRUE";
+  }
+  return ss.str();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,155 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "schema.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Splits the tuples of a table into the value of a join key and the
+ * remaining attributes.
+ *
+ * The layout of the tuples is worked out once from the schema: the offset of
+ * every attribute up to the first VARCHAR attribute is fixed, so extracting a
+ * key looks at no attribute names, and only VARCHAR attributes and those
+ * after them are found by walking the tuple.
+ *
+ * A key holds the values of its attributes in the order given: an INT as its
+ * 4 bytes, a CHAR(n) as its n bytes, and a VARCHAR as its length byte and
+ * characters, without the padding of the tuple.  Keys of two tables over
+ * attributes of the same types are thus equal exactly when the values are.
+ *
+ * Extracting keeps no state in the extractor, so threads may share one.
+ */
+class JoinKeyExtractor {
+ public:
+  /**
+   * Constructor
+   *
+   * @param tableSchema   Schema of the tuples.
+   * @param keyAttrNames  Attributes of the key, in order, checked by
+   *                      checkKeyAttrs().
+   */
+  JoinKeyExtractor(const TableSchema& tableSchema,
+                   const std::vector<std::string>& keyAttrNames);
+
+  /**
+   * Append the key of a tuple to a string
+   */
+  void extractKey(const std::string& tuple, std::string& key) const;
+
+  /**
+   * Append the key of a tuple to one string, and the tuple without the key
+   * attributes, still padded as in a tuple, to another
+   */
+  void extract(const std::string& tuple,
+               std::string& key,
+               std::string& rest) const;
+
+  /**
+   * Get the attributes of the natural join of two tables, those named and
+   * typed alike in both, in the order of the right table
+   */
+  static std::vector<std::string> naturalKeyAttrNames(
+      const TableSchema& leftTableSchema,
+      const TableSchema& rightTableSchema);
+
+  /**
+   * Check that two lists of attributes can be joined pairwise
+   *
+   * @throws JoinPredicateException If the lists differ in length, name an
+   * attribute twice or one missing from its table, or pair attributes of
+   * different types or CHAR attributes of different lengths
+   */
+  static void checkKeyAttrs(const TableSchema& leftTableSchema,
+                            const std::vector<std::string>& leftKeyAttrNames,
+                            const TableSchema& rightTableSchema,
+                            const std::vector<std::string>& rightKeyAttrNames);
+
+  /**
+   * Get the text of the predicate joining two lists of attributes,
+   * e.g. r.a = s.b AND r.c = s.c
+   */
+  static std::string toString(const TableSchema& leftTableSchema,
+                              const std::vector<std::string>& leftKeyAttrNames,
+                              const TableSchema& rightTableSchema,
+                              const std::vector<std::string>& rightKeyAttrNames);
+
+ private:
+  /**
+   * Layout of an attribute in the tuples
+   */
+  struct Field {
+    /**
+     * Type of the attribute
+     */
+    DataType type;
+
+    /**
+     * Bytes of the value without padding; 0 for VARCHAR
+     */
+    std::size_t length;
+
+    /**
+     * Bytes of the value with padding; 0 for VARCHAR
+     */
+    std::size_t width;
+
+    /**
+     * Is the attribute part of the key?
+     */
+    bool inKey;
+  };
+
+  /**
+   * Find the offset of every attribute of a tuple, followed by the end of
+   * the tuple
+   *
+   * @param scratch  Filled with the offsets if the table has VARCHAR
+   *                 attributes; the fixed offsets are returned otherwise
+   */
+  const std::vector<std::size_t>& locate(
+      const std::string& tuple,
+      std::vector<std::size_t>& scratch) const;
+
+  /**
+   * Append the key of a located tuple to a string
+   */
+  void appendKey(const std::string& tuple,
+                 const std::vector<std::size_t>& at,
+                 std::string& key) const;
+
+  /**
+   * Layout of the attributes of the table
+   */
+  std::vector<Field> fields;
+
+  /**
+   * Attribute numbers of the key, in order
+   */
+  std::vector<int> keyAttrs;
+
+  /**
+   * Number of the first VARCHAR attribute, or the number of attributes; the
+   * offsets up to it are the same in every tuple
+   */
+  std::size_t firstVarchar;
+
+  /**
+   * Offsets of the attributes up to the first VARCHAR attribute, followed by
+   * the end of the tuple if there is none
+   */
+  std::vector<std::size_t> fixedOffsets;
+};
+
+}  // namespace badgerdb
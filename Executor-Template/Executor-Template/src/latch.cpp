@@ -0,0 +1,75 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "latch.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Latches held shared by the calling thread, once per hold
+ */
+thread_local std::vector<const RWLatch*> sharedHolds;
+
+}  // namespace
+
+void RWLatch::lockShared() {
+  const bool reentrant =
+      std::find(sharedHolds.begin(), sharedHolds.end(), this) !=
+      sharedHolds.end();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (writer || (waitingWriters > 0 && !reentrant)) {
+      released.wait(lock);
+    }
+    ++readers;
+  }
+  sharedHolds.push_back(this);
+}
+
+void RWLatch::unlockShared() {
+  std::vector<const RWLatch*>::iterator hold =
+      std::find(sharedHolds.begin(), sharedHolds.end(), this);
+  if (hold != sharedHolds.end()) {
+    sharedHolds.erase(hold);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (--readers == 0) {
+    released.notify_all();
+  }
+}
+
+void RWLatch::lockExclusive() {
+  std::unique_lock<std::mutex> lock(mutex);
+  ++waitingWriters;
+  while (writer || readers > 0) {
+    released.wait(lock);
+  }
+  --waitingWriters;
+  writer = true;
+}
+
+bool RWLatch::tryLockExclusive() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (writer || readers > 0) {
+    return false;
+  }
+  writer = true;
+  return true;
+}
+
+void RWLatch::unlockExclusive() {
+  std::lock_guard<std::mutex> lock(mutex);
+  writer = false;
+  released.notify_all();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,91 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+namespace badgerdb {
+
+/**
+ * @brief Reader/writer latch guarding the contents of one buffer frame.
+ *
+ * Any number of threads may hold the latch shared, or one thread exclusive.
+ * Waiting writers are preferred: a thread asking for the latch shared waits
+ * while a writer waits, so a steady stream of readers cannot starve writers.
+ * A thread which already holds the latch shared is let through, though, so
+ * it may latch a page shared more than once (as a self-join does) without
+ * deadlocking behind the writer.  The shared holds are counted per thread,
+ * so a shared latch should be released by the thread which took it.
+ *
+ * Latches are short-term and not reentrant for writers.  Row locks held for
+ * a whole transaction are managed by LockManager.
+ */
+class RWLatch {
+ public:
+  RWLatch() : readers(0), waitingWriters(0), writer(false) {}
+
+  RWLatch(const RWLatch&) = delete;
+  RWLatch& operator=(const RWLatch&) = delete;
+
+  /**
+   * Acquires the latch shared, waiting while it is held exclusive or, unless
+   * the calling thread holds it shared already, while a writer waits.
+   */
+  void lockShared();
+
+  /**
+   * Releases a shared hold of the latch.
+   */
+  void unlockShared();
+
+  /**
+   * Acquires the latch exclusive, waiting while it is held at all.
+   */
+  void lockExclusive();
+
+  /**
+   * Releases an exclusive hold of the latch.
+   */
+  void unlockExclusive();
+
+  /**
+   * Acquires the latch exclusive if it is free, without waiting.
+   *
+   * @return  True if the latch has been acquired
+   */
+  bool tryLockExclusive();
+
+ private:
+  /**
+   * Protects readers, waitingWriters and writer
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when the latch is released
+   */
+  std::condition_variable released;
+
+  /**
+   * Number of shared holders
+   */
+  int readers;
+
+  /**
+   * Number of threads waiting to acquire the latch exclusive
+   */
+  int waitingWriters;
+
+  /**
+   * True while held exclusive
+   */
+  bool writer;
+};
+
+}  // namespace badgerdb
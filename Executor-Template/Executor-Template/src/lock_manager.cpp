@@ -0,0 +1,217 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lock_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "exceptions/lock_timeout_exception.h"
+
+namespace badgerdb {
+
+std::size_t LockKeyHash::operator()(const LockKey& key) const {
+  std::size_t hash = std::hash<std::string>()(key.filename);
+  hash = hash * 31 + key.rid.page_number;
+  hash = hash * 31 + key.rid.slot_number;
+  return hash;
+}
+
+LockManager::LockManager(const std::size_t numPartitions,
+                         const unsigned int timeoutMs)
+    : numPartitions(numPartitions > 0 ? numPartitions : 1),
+      timeoutMs(timeoutMs) {
+  partitions = new Partition[this->numPartitions];
+}
+
+LockManager::~LockManager() {
+  delete[] partitions;
+}
+
+void LockManager::lock(const TxnId txn, const std::string& filename,
+                       const RecordId& rid, const LockMode mode) {
+  LockKey key;
+  key.filename = filename;
+  key.rid = rid;
+  Partition& partition = partitionFor(key);
+  {
+    std::unique_lock<std::mutex> lock(partition.mutex);
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(timeoutMs);
+    while (!grant(partition.locks[key], txn, mode)) {
+      if (partition.released.wait_until(lock, deadline) ==
+          std::cv_status::timeout) {
+        if (grant(partition.locks[key], txn, mode)) {
+          break;
+        }
+        if (partition.locks[key].empty()) {
+          partition.locks.erase(key);
+        }
+        throw LockTimeoutException(txn, filename, rid);
+      }
+    }
+  }
+  remember(txn, key);
+}
+
+bool LockManager::tryLock(const TxnId txn, const std::string& filename,
+                          const RecordId& rid, const LockMode mode) {
+  LockKey key;
+  key.filename = filename;
+  key.rid = rid;
+  Partition& partition = partitionFor(key);
+  {
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    Holders& holders = partition.locks[key];
+    if (!grant(holders, txn, mode)) {
+      if (holders.empty()) {
+        partition.locks.erase(key);
+      }
+      return false;
+    }
+  }
+  remember(txn, key);
+  return true;
+}
+
+void LockManager::unlock(const TxnId txn, const std::string& filename,
+                         const RecordId& rid) {
+  LockKey key;
+  key.filename = filename;
+  key.rid = rid;
+  Partition& partition = partitionFor(key);
+  {
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    if (!release(partition, key, txn)) {
+      return;
+    }
+  }
+  partition.released.notify_all();
+
+  std::lock_guard<std::mutex> lock(txnMutex);
+  std::unordered_map<TxnId, std::vector<LockKey> >::iterator it =
+      held.find(txn);
+  if (it != held.end()) {
+    std::vector<LockKey>& keys = it->second;
+    keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+    if (keys.empty()) {
+      held.erase(it);
+    }
+  }
+}
+
+std::size_t LockManager::unlockAll(const TxnId txn) {
+  std::vector<LockKey> keys;
+  {
+    std::lock_guard<std::mutex> lock(txnMutex);
+    std::unordered_map<TxnId, std::vector<LockKey> >::iterator it =
+        held.find(txn);
+    if (it == held.end()) {
+      return 0;
+    }
+    keys.swap(it->second);
+    held.erase(it);
+  }
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    Partition& partition = partitionFor(keys[i]);
+    {
+      std::lock_guard<std::mutex> lock(partition.mutex);
+      if (!release(partition, keys[i], txn)) {
+        continue;
+      }
+    }
+    partition.released.notify_all();
+    ++count;
+  }
+  return count;
+}
+
+bool LockManager::holds(const TxnId txn, const std::string& filename,
+                        const RecordId& rid, const LockMode mode) const {
+  LockKey key;
+  key.filename = filename;
+  key.rid = rid;
+  Partition& partition = partitionFor(key);
+  std::lock_guard<std::mutex> lock(partition.mutex);
+  std::unordered_map<LockKey, Holders, LockKeyHash>::const_iterator it =
+      partition.locks.find(key);
+  if (it == partition.locks.end()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < it->second.size(); ++i) {
+    if (it->second[i].first == txn) {
+      return mode == LOCK_SHARED || it->second[i].second == LOCK_EXCLUSIVE;
+    }
+  }
+  return false;
+}
+
+LockManager::Partition& LockManager::partitionFor(const LockKey& key) const {
+  return partitions[LockKeyHash()(key) % numPartitions];
+}
+
+bool LockManager::grant(Holders& holders, const TxnId txn,
+                        const LockMode mode) {
+  Holders::iterator own = holders.end();
+  bool others = false;
+  bool otherExclusive = false;
+  for (Holders::iterator it = holders.begin(); it != holders.end(); ++it) {
+    if (it->first == txn) {
+      own = it;
+    } else {
+      others = true;
+      otherExclusive = otherExclusive || it->second == LOCK_EXCLUSIVE;
+    }
+  }
+  if (own != holders.end() &&
+      (own->second == LOCK_EXCLUSIVE || mode == LOCK_SHARED)) {
+    return true;  // already held strongly enough
+  }
+  if (mode == LOCK_SHARED ? otherExclusive : others) {
+    return false;
+  }
+  if (own != holders.end()) {
+    own->second = mode;  // upgrade
+  } else {
+    holders.push_back(std::make_pair(txn, mode));
+  }
+  return true;
+}
+
+bool LockManager::release(Partition& partition, const LockKey& key,
+                          const TxnId txn) {
+  std::unordered_map<LockKey, Holders, LockKeyHash>::iterator it =
+      partition.locks.find(key);
+  if (it == partition.locks.end()) {
+    return false;
+  }
+  Holders& holders = it->second;
+  for (Holders::iterator holder = holders.begin(); holder != holders.end();
+       ++holder) {
+    if (holder->first == txn) {
+      holders.erase(holder);
+      if (holders.empty()) {
+        partition.locks.erase(it);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void LockManager::remember(const TxnId txn, const LockKey& key) {
+  std::lock_guard<std::mutex> lock(txnMutex);
+  std::vector<LockKey>& keys = held[txn];
+  if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+    keys.push_back(key);
+  }
+}
+
+}  // namespace badgerdb
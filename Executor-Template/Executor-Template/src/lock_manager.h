@@ -0,0 +1,234 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Identifier of a transaction holding row locks
+ */
+typedef std::uint64_t TxnId;
+
+/**
+ * @brief Mode of a row lock
+ */
+enum LockMode {
+  /**
+   * Shared with other readers
+   */
+  LOCK_SHARED,
+
+  /**
+   * Held by one writer
+   */
+  LOCK_EXCLUSIVE
+};
+
+/**
+ * @brief Record of a file, the unit of row locking
+ */
+struct LockKey {
+  /**
+   * Name of the file holding the record
+   */
+  std::string filename;
+
+  /**
+   * Record in the file
+   */
+  RecordId rid;
+
+  bool operator==(const LockKey& rhs) const {
+    return rid == rhs.rid && filename == rhs.filename;
+  }
+};
+
+/**
+ * @brief Hash of a LockKey
+ */
+struct LockKeyHash {
+  std::size_t operator()(const LockKey& key) const;
+};
+
+/**
+ * @brief Row-level shared/exclusive locks held by transactions until they
+ * release them, typically all at once on commit (strict two-phase locking).
+ *
+ * The lock table is split into partitions by the hash of the record, each
+ * with its own mutex, so that requests on different records rarely contend.
+ * A request which cannot be granted waits until the lock is released or the
+ * lock timeout expires; a timeout is reported as a LockTimeoutException and
+ * is the only deadlock handling, so the transaction should release its locks
+ * and retry.
+ *
+ * Row locks are independent of the short-term page latches taken through
+ * BufMgr::fetch().
+ */
+class LockManager {
+ public:
+  /**
+   * Default number of partitions
+   */
+  static const std::size_t DEFAULT_PARTITIONS = 64;
+
+  /**
+   * Default lock timeout in milliseconds
+   */
+  static const unsigned int DEFAULT_TIMEOUT_MS = 1000;
+
+  /**
+   * Constructor
+   *
+   * @param numPartitions  Number of partitions of the lock table.
+   * @param timeoutMs      Time a request waits before timing out.
+   */
+  explicit LockManager(const std::size_t numPartitions = DEFAULT_PARTITIONS,
+                       const unsigned int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+  /**
+   * Destructor
+   */
+  ~LockManager();
+
+  LockManager(const LockManager&) = delete;
+  LockManager& operator=(const LockManager&) = delete;
+
+  /**
+   * Locks a record, waiting while other transactions hold conflicting locks.
+   * A shared lock held by the transaction is upgraded to exclusive if
+   * requested; a lock held in the requested or a stronger mode is kept as it
+   * is.
+   *
+   * @param txn       Requesting transaction.
+   * @param filename  Name of the file holding the record.
+   * @param rid       Record to lock.
+   * @param mode      Requested mode.
+   * @throws LockTimeoutException If the lock is not granted in time.
+   */
+  void lock(const TxnId txn, const std::string& filename, const RecordId& rid,
+            const LockMode mode);
+
+  /**
+   * Locks a record if this is possible without waiting.
+   *
+   * @return  True if the lock is held on return
+   */
+  bool tryLock(const TxnId txn, const std::string& filename,
+               const RecordId& rid, const LockMode mode);
+
+  /**
+   * Releases the lock of a transaction on a record, if it holds one.
+   */
+  void unlock(const TxnId txn, const std::string& filename,
+              const RecordId& rid);
+
+  /**
+   * Releases every lock held by a transaction.
+   *
+   * @return  Number of locks released
+   */
+  std::size_t unlockAll(const TxnId txn);
+
+  /**
+   * Returns true if the transaction holds a lock on the record in the given
+   * or a stronger mode.
+   */
+  bool holds(const TxnId txn, const std::string& filename, const RecordId& rid,
+             const LockMode mode) const;
+
+ private:
+  /**
+   * Holders of the lock on one record
+   */
+  typedef std::vector<std::pair<TxnId, LockMode> > Holders;
+
+  /**
+   * One partition of the lock table
+   */
+  struct Partition {
+    /**
+     * Protects locks
+     */
+    std::mutex mutex;
+
+    /**
+     * Signalled when a lock of the partition is released
+     */
+    std::condition_variable released;
+
+    /**
+     * Holders of every locked record of the partition
+     */
+    std::unordered_map<LockKey, Holders, LockKeyHash> locks;
+  };
+
+  /**
+   * Partition responsible for a record
+   */
+  Partition& partitionFor(const LockKey& key) const;
+
+  /**
+   * Grants the lock if it is compatible with the other holders.  The mutex
+   * of the partition must be held.
+   *
+   * @return  True if the lock is held on return
+   */
+  static bool grant(Holders& holders, const TxnId txn, const LockMode mode);
+
+  /**
+   * Removes the lock of a transaction on a record.  The mutex of the
+   * partition must be held.
+   *
+   * @return  True if a lock was removed
+   */
+  static bool release(Partition& partition, const LockKey& key,
+                      const TxnId txn);
+
+  /**
+   * Remembers that the transaction holds a lock on the record.
+   */
+  void remember(const TxnId txn, const LockKey& key);
+
+  /**
+   * Partitions of the lock table
+   */
+  Partition* partitions;
+
+  /**
+   * Number of partitions
+   */
+  std::size_t numPartitions;
+
+  /**
+   * Lock timeout in milliseconds
+   */
+  unsigned int timeoutMs;
+
+  /**
+   * Protects held
+   */
+  std::mutex txnMutex;
+
+  /**
+   * Records locked by each transaction
+   */
+  std::unordered_map<TxnId, std::vector<LockKey> > held;
+};
+
+}  // namespace badgerdb
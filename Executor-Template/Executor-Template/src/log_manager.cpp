@@ -0,0 +1,592 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
+
+#include "buffer.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/log_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+namespace {
+
+// appends the bytes of a fixed-size value in host byte order
+template <class T>
+void put(std::string& out, const T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T>
+T get(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// size of the fixed part of a record body: type, page, slot, name length and
+// data length
+const std::size_t BODY_FIXED_SIZE = 1 + 4 + 2 + 2 + 4;
+
+}  // namespace
+
+LogManager::LogManager(const std::string& filename)
+    : filename_(filename),
+      fd(-1),
+      endLsn(0),
+      flushedLsn(0),
+      flushing(false),
+      groupCommitDelay(0) {
+  fd = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    throw LogException(filename_, "open");
+  }
+  // find the end of the last complete record and drop anything after it
+  const std::string log = readLog();
+  std::size_t offset = 0;
+  LogRecord record;
+  while (decode(log, offset, record)) {
+  }
+  if (offset < log.size() && ::ftruncate(fd, offset) != 0) {
+    throw LogException(filename_, "truncate");
+  }
+  if (::lseek(fd, offset, SEEK_SET) < 0) {
+    throw LogException(filename_, "seek");
+  }
+  endLsn = flushedLsn = offset;
+}
+
+LogManager::~LogManager() {
+  try {
+    flushAll();
+  } catch (LogException& e) {
+    // nothing more can be done about it here
+  }
+  ::close(fd);
+}
+
+Lsn LogManager::append(const LogRecordType type,
+                       const std::string& filename,
+                       const PageId pageNo,
+                       const SlotId slotNo,
+                       const std::string& data) {
+  LogRecord record;
+  record.lsn = 0;
+  record.type = type;
+  record.filename = filename;
+  record.pageNo = pageNo;
+  record.slotNo = slotNo;
+  record.data = data;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return appendLocked(record);
+}
+
+Lsn LogManager::appendLocked(const LogRecord& record) {
+  const std::size_t before = tail.size();
+  encode(record, tail);
+  endLsn += tail.size() - before;
+  ++stats.records;
+  return endLsn;
+}
+
+Lsn LogManager::commit(const bool wait) {
+  const Lsn lsn = append(LOG_COMMIT, "", Page::INVALID_NUMBER, 0, "");
+  std::unique_lock<std::mutex> lock(mutex);
+  ++stats.commits;
+  if (wait) {
+    flushLocked(lock, lsn);
+  }
+  return lsn;
+}
+
+void LogManager::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> lock(mutex);
+  flushLocked(lock, lsn);
+}
+
+void LogManager::flushAll() {
+  std::unique_lock<std::mutex> lock(mutex);
+  flushLocked(lock, endLsn);
+}
+
+void LogManager::setGroupCommitDelay(const unsigned int microseconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  groupCommitDelay = microseconds;
+}
+
+void LogManager::flushLocked(std::unique_lock<std::mutex>& lock,
+                             const Lsn lsn) {
+  while (flushedLsn < lsn) {
+    if (flushing) {
+      // another thread is syncing; our records go out with the next batch
+      flushed.wait(lock);
+      continue;
+    }
+    flushing = true;
+    if (groupCommitDelay > 0) {
+      lock.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(groupCommitDelay));
+      lock.lock();
+    }
+    // take everything appended so far, including other committers' records
+    std::string batch;
+    batch.swap(tail);
+    const Lsn target = endLsn;
+    lock.unlock();
+
+    bool ok = true;
+    std::size_t written = 0;
+    while (ok && written < batch.size()) {
+      const ssize_t n =
+          ::write(fd, batch.data() + written, batch.size() - written);
+      if (n < 0) {
+        ok = false;
+      } else {
+        written += n;
+      }
+    }
+    if (ok && ::fsync(fd) != 0) {
+      ok = false;
+    }
+
+    lock.lock();
+    flushing = false;
+    if (!ok) {
+      flushed.notify_all();
+      throw LogException(filename_, "write");
+    }
+    flushedLsn = target;
+    ++stats.syncs;
+    stats.bytesWritten += batch.size();
+    flushed.notify_all();
+  }
+}
+
+std::vector<LogRecord> LogManager::readRecords() const {
+  const std::string log = readLog();
+  std::vector<LogRecord> records;
+  std::size_t offset = 0;
+  LogRecord record;
+  while (decode(log, offset, record)) {
+    records.push_back(record);
+  }
+  return records;
+}
+
+Lsn LogManager::checkpoint(const BufMgr* bufMgr) {
+  // changes logged from here on are replayed whatever the table says
+  const Lsn begin = getEndLsn();
+  const std::vector<DirtyPage> dirty = bufMgr->getDirtyPages();
+
+  LogRecord record;
+  record.lsn = 0;
+  record.type = LOG_CHECKPOINT;
+  record.pageNo = Page::INVALID_NUMBER;
+  record.slotNo = 0;
+  put<Lsn>(record.data, begin);
+  put<std::uint32_t>(record.data, static_cast<std::uint32_t>(dirty.size()));
+  for (std::size_t i = 0; i < dirty.size(); ++i) {
+    put<std::uint16_t>(record.data,
+                       static_cast<std::uint16_t>(dirty[i].filename.size()));
+    record.data.append(dirty[i].filename);
+    put<PageId>(record.data, dirty[i].pageNo);
+    put<Lsn>(record.data, dirty[i].recLsn);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  const Lsn offset = endLsn;
+  const Lsn lsn = appendLocked(record);
+  flushLocked(lock, lsn);
+  ++stats.checkpoints;
+  lock.unlock();
+  writeMaster(offset);
+  return lsn;
+}
+
+namespace {
+
+// changes to replay on one page, in log order
+struct PageRedo {
+  File* file;
+  PageId pageNo;
+  std::vector<const LogRecord*> records;
+};
+
+}  // namespace
+
+std::size_t LogManager::recover(BufMgr* bufMgr, unsigned int numThreads) {
+  const std::string log = readLog();
+
+  // analysis: find where to start from the last checkpoint
+  Lsn begin = 0;
+  Lsn start = 0;
+  std::map<std::pair<std::string, PageId>, Lsn> dirtyPages;
+  Lsn master;
+  if (readMaster(master) && master < log.size()) {
+    std::size_t offset = master;
+    LogRecord record;
+    if (decode(log, offset, record) && record.type == LOG_CHECKPOINT) {
+      const char* data = record.data.data();
+      begin = start = get<Lsn>(data);
+      const std::uint32_t count = get<std::uint32_t>(data + sizeof(Lsn));
+      std::size_t pos = sizeof(Lsn) + sizeof(std::uint32_t);
+      for (std::uint32_t i = 0; i < count; ++i) {
+        const std::size_t name_length = get<std::uint16_t>(data + pos);
+        pos += sizeof(std::uint16_t);
+        const std::string name(data + pos, name_length);
+        pos += name_length;
+        const PageId pageNo = get<PageId>(data + pos);
+        pos += sizeof(PageId);
+        const Lsn recLsn = get<Lsn>(data + pos);
+        pos += sizeof(Lsn);
+        dirtyPages[std::make_pair(name, pageNo)] = recLsn;
+        start = std::min(start, recLsn);
+      }
+    }
+  }
+
+  std::vector<LogRecord> records;
+  std::size_t offset = start;
+  LogRecord record;
+  while (decode(log, offset, record)) {
+    records.push_back(record);
+  }
+
+  // open the logged files, dropping any copies of their pages in the pool
+  std::map<std::string, File*> files;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    const std::string& name = records[i].filename;
+    if (name.empty() || files.count(name) > 0) {
+      continue;
+    }
+    File* file = NULL;
+    if (File::exists(name)) {
+      file = new File(File::open(name));
+      bufMgr->flushFile(file);
+    }
+    files[name] = file;
+  }
+
+  std::size_t redone = 0;
+  std::vector<PageRedo> pages;
+  std::map<std::pair<std::string, PageId>, std::size_t> pageIndex;
+  try {
+    // a relink of the page lists cut short by the crash may have left them
+    // cyclic, so they are repaired before any allocation walks them
+    std::set<std::string> relinked;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const LogRecord& r = records[i];
+      if (r.type == LOG_RELINK_PAGES && files[r.filename] != NULL &&
+          relinked.insert(r.filename).second) {
+        files[r.filename]->sortPageLists();
+      }
+    }
+
+    // allocations and disposals change the file header and page lists, so
+    // they are replayed in log order by this thread
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const LogRecord& r = records[i];
+      File* file = r.filename.empty() ? NULL : files[r.filename];
+      if (file == NULL) {
+        continue;
+      }
+      const std::pair<std::string, PageId> key(r.filename, r.pageNo);
+      if (r.type == LOG_RELINK_PAGES) {
+        // relinking is repeatable, so it is simply done again
+        file->sortPageLists();
+        ++redone;
+        continue;
+      }
+      if (r.type == LOG_ALLOC_PAGE || r.type == LOG_DISPOSE_PAGE) {
+        // earlier changes belong to a previous use of the page
+        std::map<std::pair<std::string, PageId>, std::size_t>::iterator it =
+            pageIndex.find(key);
+        if (it != pageIndex.end()) {
+          pages[it->second].records.clear();
+        }
+        bool used = true;
+        Lsn pageLsn = 0;
+        try {
+          pageLsn = file->readPage(r.pageNo).lsn();
+        } catch (InvalidPageException& e) {
+          used = false;
+        }
+        if (r.type == LOG_ALLOC_PAGE && !used) {
+          // the page may have reached the free list on disk in another
+          // position than when it was allocated, so it is allocated by number
+          file->allocatePage(r.pageNo);
+          ++redone;
+        } else if (r.type == LOG_DISPOSE_PAGE && used && pageLsn < r.lsn) {
+          file->deletePage(r.pageNo);
+          ++redone;
+        }
+        continue;
+      }
+      if (r.type == LOG_CHECKPOINT || r.type == LOG_COMMIT) {
+        continue;
+      }
+      if (r.lsn <= begin) {
+        // before the checkpoint, only pages which were dirty then may miss
+        // the change
+        std::map<std::pair<std::string, PageId>, Lsn>::const_iterator dirty =
+            dirtyPages.find(key);
+        if (dirty == dirtyPages.end() || r.lsn <= dirty->second) {
+          continue;
+        }
+      }
+      std::map<std::pair<std::string, PageId>, std::size_t>::iterator it =
+          pageIndex.find(key);
+      if (it == pageIndex.end()) {
+        PageRedo page;
+        page.file = file;
+        page.pageNo = r.pageNo;
+        it = pageIndex.insert(std::make_pair(key, pages.size())).first;
+        pages.push_back(page);
+      }
+      pages[it->second].records.push_back(&r);
+    }
+
+    // redo the changes, each thread owning the pages which hash to it and
+    // reading and writing them with positioned I/O
+    if (numThreads == 0) {
+      numThreads = 1;
+    }
+    std::vector<std::size_t> counts(numThreads, 0);
+    std::vector<std::exception_ptr> errors(numThreads);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; ++t) {
+      threads.push_back(std::thread([&, t]() {
+        try {
+          for (std::size_t i = 0; i < pages.size(); ++i) {
+            const PageRedo& work = pages[i];
+            const std::size_t hash =
+                std::hash<std::string>()(work.file->filename()) * 31 +
+                work.pageNo;
+            if (work.records.empty() || hash % numThreads != t) {
+              continue;
+            }
+            Page page;
+            try {
+              page = work.file->readPage(work.pageNo);
+            } catch (InvalidPageException& e) {
+              continue;  // disposed before the crash
+            }
+            std::size_t applied = 0;
+            for (std::size_t j = 0; j < work.records.size(); ++j) {
+              if (work.records[j]->lsn > page.lsn()) {
+                applyChange(*work.records[j], page);
+                page.set_lsn(work.records[j]->lsn);
+                ++applied;
+              }
+            }
+            if (applied > 0) {
+              work.file->writePage(page);
+              counts[t] += applied;
+            }
+          }
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      }));
+    }
+    for (unsigned int t = 0; t < numThreads; ++t) {
+      threads[t].join();
+      redone += counts[t];
+    }
+    for (unsigned int t = 0; t < numThreads; ++t) {
+      if (errors[t]) {
+        std::rethrow_exception(errors[t]);
+      }
+    }
+  } catch (...) {
+    for (std::map<std::string, File*>::iterator it = files.begin();
+         it != files.end(); ++it) {
+      delete it->second;
+    }
+    throw;
+  }
+  for (std::map<std::string, File*>::iterator it = files.begin();
+       it != files.end(); ++it) {
+    delete it->second;
+  }
+
+  // every change is on disk now, so later restarts can begin here
+  checkpoint(bufMgr);
+  return redone;
+}
+
+void LogManager::applyChange(const LogRecord& record, Page& page) {
+  const RecordId rid = {record.pageNo, record.slotNo};
+  switch (record.type) {
+    case LOG_INSERT:
+      page.insertRecord(record.data);
+      break;
+    case LOG_DELETE:
+      page.deleteRecord(rid);
+      break;
+    case LOG_UPDATE:
+      page.updateRecord(rid, record.data);
+      break;
+    case LOG_FORWARD: {
+      RecordId new_location;
+      new_location.page_number = get<PageId>(record.data.data());
+      new_location.slot_number =
+          get<SlotId>(record.data.data() + sizeof(PageId));
+      page.forwardRecord(rid, new_location);
+      break;
+    }
+    case LOG_INSERT_MOVED: {
+      RecordId home;
+      home.page_number = get<PageId>(record.data.data());
+      home.slot_number = get<SlotId>(record.data.data() + sizeof(PageId));
+      page.insertMovedRecord(
+          record.data.substr(sizeof(PageId) + sizeof(SlotId)), home);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+bool LogManager::readMaster(Lsn& offset) const {
+  const int master = ::open(masterFilename().c_str(), O_RDONLY);
+  if (master < 0) {
+    return false;
+  }
+  const bool ok = ::read(master, &offset, sizeof(offset)) == sizeof(offset);
+  ::close(master);
+  return ok;
+}
+
+void LogManager::writeMaster(const Lsn offset) {
+  // write a new master file and rename it over the old one, so that a crash
+  // leaves either of them intact
+  const std::string temp = masterFilename() + ".tmp";
+  const int master = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (master < 0) {
+    throw LogException(filename_, "checkpoint");
+  }
+  const bool ok = ::write(master, &offset, sizeof(offset)) == sizeof(offset) &&
+                  ::fsync(master) == 0;
+  ::close(master);
+  if (!ok || ::rename(temp.c_str(), masterFilename().c_str()) != 0) {
+    throw LogException(filename_, "checkpoint");
+  }
+}
+
+Lsn LogManager::getFlushedLsn() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return flushedLsn;
+}
+
+Lsn LogManager::getEndLsn() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return endLsn;
+}
+
+LogStats LogManager::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void LogManager::encode(const LogRecord& record, std::string& out) {
+  const std::size_t start = out.size();
+  put<std::uint32_t>(out, 0);  // body length, filled in below
+  put<std::uint32_t>(out, 0);  // checksum, filled in below
+  put<std::uint8_t>(out, static_cast<std::uint8_t>(record.type));
+  put<PageId>(out, record.pageNo);
+  put<SlotId>(out, record.slotNo);
+  put<std::uint16_t>(out, static_cast<std::uint16_t>(record.filename.size()));
+  put<std::uint32_t>(out, static_cast<std::uint32_t>(record.data.size()));
+  out.append(record.filename);
+  out.append(record.data);
+
+  const std::uint32_t length =
+      static_cast<std::uint32_t>(out.size() - start - RECORD_HEADER_SIZE);
+  const std::uint32_t sum =
+      checksum(out.data() + start + RECORD_HEADER_SIZE, length);
+  std::memcpy(&out[start], &length, sizeof(length));
+  std::memcpy(&out[start + sizeof(length)], &sum, sizeof(sum));
+}
+
+bool LogManager::decode(const std::string& log, std::size_t& offset,
+                        LogRecord& record) {
+  if (log.size() - offset < RECORD_HEADER_SIZE) {
+    return false;
+  }
+  const char* header = log.data() + offset;
+  const std::uint32_t length = get<std::uint32_t>(header);
+  const std::uint32_t sum = get<std::uint32_t>(header + 4);
+  if (length < BODY_FIXED_SIZE ||
+      log.size() - offset - RECORD_HEADER_SIZE < length) {
+    return false;
+  }
+  const char* body = header + RECORD_HEADER_SIZE;
+  if (checksum(body, length) != sum) {
+    return false;
+  }
+  const std::size_t name_length = get<std::uint16_t>(body + 7);
+  const std::size_t data_length = get<std::uint32_t>(body + 9);
+  if (BODY_FIXED_SIZE + name_length + data_length != length) {
+    return false;
+  }
+  record.type = static_cast<LogRecordType>(get<std::uint8_t>(body));
+  record.pageNo = get<PageId>(body + 1);
+  record.slotNo = get<SlotId>(body + 5);
+  record.filename.assign(body + BODY_FIXED_SIZE, name_length);
+  record.data.assign(body + BODY_FIXED_SIZE + name_length, data_length);
+  offset += RECORD_HEADER_SIZE + length;
+  record.lsn = offset;
+  return true;
+}
+
+std::uint32_t LogManager::checksum(const char* data,
+                                   const std::size_t length) {
+  // FNV-1a
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+std::string LogManager::readLog() const {
+  std::string log;
+  char buffer[64 * 1024];
+  off_t position = 0;
+  for (;;) {
+    const ssize_t n = ::pread(fd, buffer, sizeof(buffer), position);
+    if (n < 0) {
+      throw LogException(filename_, "read");
+    }
+    if (n == 0) {
+      break;
+    }
+    log.append(buffer, n);
+    position += n;
+  }
+  return log;
+}
+
+}  // namespace badgerdb
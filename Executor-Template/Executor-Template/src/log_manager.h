@@ -0,0 +1,405 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * forward declaration of BufMgr class
+ */
+class BufMgr;
+
+/**
+ * @brief Kinds of records in the write-ahead log.
+ */
+enum LogRecordType {
+  LOG_INSERT = 1,
+  LOG_DELETE = 2,
+  LOG_UPDATE = 3,
+  LOG_FORWARD = 4,
+  LOG_ALLOC_PAGE = 5,
+  LOG_DISPOSE_PAGE = 6,
+  LOG_COMMIT = 7,
+  LOG_CHECKPOINT = 8,
+  LOG_INSERT_MOVED = 9,
+  LOG_RELINK_PAGES = 10
+};
+
+/**
+ * @brief Decoded record of the write-ahead log.
+ *
+ * Record changes carry the slot and the new record bytes (for LOG_FORWARD,
+ * the new location as page number and slot number; for LOG_INSERT_MOVED, the
+ * home slot in the same form followed by the record bytes); page changes
+ * carry only the page number; commits and relinks of the page lists of a
+ * file carry nothing.
+ */
+struct LogRecord {
+  /**
+   * LSN of the record, the log offset just past its end
+   */
+  Lsn lsn;
+
+  /**
+   * Kind of change
+   */
+  LogRecordType type;
+
+  /**
+   * Name of the changed file
+   */
+  std::string filename;
+
+  /**
+   * Changed page
+   */
+  PageId pageNo;
+
+  /**
+   * Changed slot
+   */
+  SlotId slotNo;
+
+  /**
+   * New record bytes
+   */
+  std::string data;
+};
+
+/**
+ * @brief Entry of the dirty-page table recorded by a checkpoint
+ */
+struct DirtyPage {
+  /**
+   * Name of the file
+   */
+  std::string filename;
+
+  /**
+   * Dirty page
+   */
+  PageId pageNo;
+
+  /**
+   * LSN from which the log holds changes missing from the page on disk
+   */
+  Lsn recLsn;
+};
+
+/**
+ * @brief Counters of the write-ahead log
+ */
+struct LogStats {
+  /**
+   * Number of records appended
+   */
+  std::uint64_t records;
+
+  /**
+   * Number of commits
+   */
+  std::uint64_t commits;
+
+  /**
+   * Number of times the log was synced to disk
+   */
+  std::uint64_t syncs;
+
+  /**
+   * Number of bytes written to the log
+   */
+  std::uint64_t bytesWritten;
+
+  /**
+   * Number of checkpoints taken
+   */
+  std::uint64_t checkpoints;
+
+  /**
+   * Clear all values
+   */
+  void clear() {
+    records = commits = syncs = bytesWritten = checkpoints = 0;
+  }
+
+  /**
+   * Constructor of LogStats class
+   */
+  LogStats() { clear(); }
+};
+
+/**
+ * @brief Sequential redo log for the changes made to pages in the buffer
+ * pool.
+ *
+ * Records are appended to an in-memory tail and written out in batches.  A
+ * commit waits until the log is synced up to its commit record; while one
+ * thread syncs, committers arriving meanwhile queue up and are all made
+ * durable by the next single sync (group commit).  The buffer manager calls
+ * flush() before writing a dirty page, so a page never reaches disk ahead of
+ * the log records describing it.
+ *
+ * Each record is stored as its body length and checksum followed by the
+ * body.  A torn record at the end of the log, left by a crash during a write,
+ * is dropped when the log is opened.
+ *
+ * Checkpoints are fuzzy: they record the dirty-page table of the buffer pool
+ * without writing any page, and the offset of the last checkpoint is kept in
+ * a master file next to the log.  Recovery starts from the oldest change the
+ * checkpoint says may be missing from disk, so restart time is bounded by the
+ * checkpoint interval rather than by the size of the log.
+ *
+ * There is no rollback: every logged change is redone by recover().
+ */
+class LogManager {
+ public:
+  /**
+   * Opens the log, creating it if it does not exist.  New records are
+   * appended after the last complete record.
+   *
+   * @param filename  Name of the log file.
+   * @throws LogException If the log cannot be opened.
+   */
+  explicit LogManager(const std::string& filename);
+
+  /**
+   * Destructor that writes out and syncs the tail of the log.
+   */
+  ~LogManager();
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+
+  /**
+   * Appends a record to the tail of the log.  The record is not durable
+   * until the log is flushed past its LSN.
+   *
+   * @param type      Kind of change.
+   * @param filename  Name of the changed file.
+   * @param pageNo    Changed page.
+   * @param slotNo    Changed slot.
+   * @param data      New record bytes.
+   * @return  LSN of the record.
+   */
+  Lsn append(const LogRecordType type,
+             const std::string& filename,
+             const PageId pageNo,
+             const SlotId slotNo,
+             const std::string& data);
+
+  /**
+   * Appends a commit record.  With wait set, returns once the commit is
+   * durable, sharing the sync with concurrent committers; otherwise the
+   * commit is made durable by the next flush, so that a batch of commits
+   * costs one sync.
+   *
+   * @param wait  Wait until the commit is durable.
+   * @return  LSN of the commit record.
+   */
+  Lsn commit(const bool wait = true);
+
+  /**
+   * Makes the log durable up to the given LSN.
+   *
+   * @param lsn  LSN which must be durable on return.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Makes every appended record durable.
+   */
+  void flushAll();
+
+  /**
+   * Sets how long a syncing thread waits for more committers to join its
+   * sync.  Zero (the default) syncs immediately.
+   *
+   * @param microseconds  Delay before each sync.
+   */
+  void setGroupCommitDelay(const unsigned int microseconds);
+
+  /**
+   * Reads the durable records of the log.
+   *
+   * @return  Records in log order.
+   */
+  std::vector<LogRecord> readRecords() const;
+
+  /**
+   * Takes a fuzzy checkpoint: appends the dirty-page table of the buffer pool
+   * to the log and makes it the starting point of recovery.  No page is
+   * written and changes may be logged concurrently.
+   *
+   * @param bufMgr  Buffer manager whose dirty pages are recorded.
+   * @return  LSN of the checkpoint record.
+   */
+  Lsn checkpoint(const BufMgr* bufMgr);
+
+  /**
+   * Redoes every logged change since the last checkpoint whose page has not
+   * yet been written with it, as told by the page LSN, and writes the redone
+   * pages to disk.  Page allocations and disposals are replayed first, in log
+   * order; the changes to the pages are then replayed by several threads,
+   * each owning the pages which hash to it, so that changes to one page are
+   * applied in log order.  Finishes with a checkpoint.  Must be called before
+   * new changes are logged.
+   *
+   * @param bufMgr      Buffer manager, whose copies of the logged files are
+   *                    dropped first.
+   * @param numThreads  Number of redo threads.
+   * @return  Number of records redone.
+   * @throws PagePinnedException If a page of a logged file is pinned.
+   */
+  std::size_t recover(BufMgr* bufMgr, unsigned int numThreads = 4);
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the LSN up to which the log is durable.
+   */
+  Lsn getFlushedLsn() const;
+
+  /**
+   * Returns the LSN of the last appended record.
+   */
+  Lsn getEndLsn() const;
+
+  /**
+   * Get log statistics
+   */
+  LogStats getStats() const;
+
+ private:
+  /**
+   * Size of the length and checksum in front of every record body
+   */
+  static const std::size_t RECORD_HEADER_SIZE = 8;
+
+  /**
+   * Appends an encoded record to the tail.  The mutex must be held.
+   *
+   * @return  LSN of the record
+   */
+  Lsn appendLocked(const LogRecord& record);
+
+  /**
+   * Name of the file holding the offset of the last checkpoint record
+   */
+  std::string masterFilename() const { return filename_ + ".master"; }
+
+  /**
+   * Reads the offset of the last checkpoint record.
+   *
+   * @return  False if no checkpoint has been taken
+   */
+  bool readMaster(Lsn& offset) const;
+
+  /**
+   * Durably replaces the offset of the last checkpoint record.
+   */
+  void writeMaster(const Lsn offset);
+
+  /**
+   * Applies a record change to a page.
+   */
+  static void applyChange(const LogRecord& record, Page& page);
+
+  /**
+   * Encodes a record and appends it to the given buffer.
+   */
+  static void encode(const LogRecord& record, std::string& out);
+
+  /**
+   * Decodes the record starting at offset and advances offset past it.
+   *
+   * @return  False if no complete, intact record starts at offset
+   */
+  static bool decode(const std::string& log, std::size_t& offset,
+                     LogRecord& record);
+
+  /**
+   * Checksum of a record body
+   */
+  static std::uint32_t checksum(const char* data, const std::size_t length);
+
+  /**
+   * Reads the whole log file.
+   */
+  std::string readLog() const;
+
+  /**
+   * Writes out and syncs the tail until the log is durable up to lsn.  The
+   * lock is released while the log is written.
+   */
+  void flushLocked(std::unique_lock<std::mutex>& lock, const Lsn lsn);
+
+  /**
+   * Name of the log file
+   */
+  std::string filename_;
+
+  /**
+   * Descriptor of the open log file
+   */
+  int fd;
+
+  /**
+   * Encoded records not yet written out
+   */
+  std::string tail;
+
+  /**
+   * LSN of the last appended record
+   */
+  Lsn endLsn;
+
+  /**
+   * LSN up to which the log is durable
+   */
+  Lsn flushedLsn;
+
+  /**
+   * True while a thread writes out the tail
+   */
+  bool flushing;
+
+  /**
+   * Delay before a sync, in microseconds
+   */
+  unsigned int groupCommitDelay;
+
+  /**
+   * Log statistics
+   */
+  LogStats stats;
+
+  /**
+   * Protects all state above
+   */
+  mutable std::mutex mutex;
+
+  /**
+   * Signalled when a sync completes
+   */
+  std::condition_variable flushed;
+};
+
+}  // namespace badgerdb
@@ -7,23 +7,40 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <set>
+#include <stdexcept>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+#include "arena.h"
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/memory_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "executor.h"
 #include "file_iterator.h"
+#include "join_key.h"
+#include "lock_manager.h"
+#include "log_manager.h"
+#include "materialized_view.h"
+#include "memory_tracker.h"
 #include "page.h"
 #include "page_iterator.h"
+#include "spill_manager.h"
 #include "storage.h"
+#include "tuple_formatter.h"
 
 using namespace badgerdb;
 
@@ -126,6 +143,172 @@ void testNestedLoopJoin(BufMgr* bufMgr, Catalog* catalog) {
   scanner.print();
 }
 
+// Read all tuples in a table file, in the order of the file
+vector<string> readTuples(File& file, BufMgr* bufMgr) {
+  bufMgr->flushFile(&file);
+  vector<string> tuples;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    Page page = *iter;
+    for (PageIterator pageIter = page.begin(); pageIter != page.end();
+         ++pageIter) {
+      tuples.push_back(*pageIter);
+    }
+  }
+  return tuples;
+}
+
+// Read all tuples in a table file, sorted so that results can be compared
+vector<string> readSortedTuples(File& file, BufMgr* bufMgr) {
+  vector<string> tuples = readTuples(file, bufMgr);
+  sort(tuples.begin(), tuples.end());
+  return tuples;
+}
+
+// Read all tuples in the file of a table of the catalog
+vector<string> readTableTuples(const string& tableName, BufMgr* bufMgr,
+                               Catalog* catalog) {
+  File file =
+      File::open(catalog->getTableFilename(catalog->getTableId(tableName)));
+  return readTuples(file, bufMgr);
+}
+
+// A tuple of a table standing in for a missing one in an outer join: the key
+// attributes, all INT, take the values of the other tuple, and the others are
+// zero or empty
+string emptyTuple(const TableSchema& tableSchema,
+                  const vector<string>& keyAttrNames, const string& other,
+                  const TableSchema& otherTableSchema,
+                  const vector<string>& otherKeyAttrNames, Catalog* catalog) {
+  stringstream ss;
+  ss << "INSERT INTO " << tableSchema.getTableName() << " VALUES (";
+  for (int i = 0; i < tableSchema.getAttrCount(); i++) {
+    size_t k = find(keyAttrNames.begin(), keyAttrNames.end(),
+                    tableSchema.getAttrName(i)) -
+               keyAttrNames.begin();
+    ss << (i > 0 ? ", " : "");
+    if (k < keyAttrNames.size()) {
+      ss << PartitionScheme::getIntAttr(
+          other, otherTableSchema,
+          otherTableSchema.getAttrNum(otherKeyAttrNames[k]));
+    } else if (tableSchema.getAttrType(i) == INT) {
+      ss << 0;
+    } else {
+      ss << "''";
+    }
+  }
+  ss << ");";
+  return HeapFileManager::createTupleFromSQLStatement(ss.str(), catalog);
+}
+
+// Join two lists of tuples with a plain nested loop, sorted like
+// readSortedTuples().  The outer joins pad a tuple without a match with an
+// emptyTuple() of the other table.
+vector<string> nestedLoopJoin(const vector<string>& leftTuples,
+                              const vector<string>& rightTuples,
+                              const TableSchema& leftTableSchema,
+                              const TableSchema& rightTableSchema,
+                              const vector<string>& leftKeyAttrNames,
+                              const vector<string>& rightKeyAttrNames,
+                              JoinMode joinMode = JOIN_INNER,
+                              Catalog* catalog = NULL) {
+  JoinKeyExtractor leftKeys(leftTableSchema, leftKeyAttrNames);
+  JoinKeyExtractor rightKeys(rightTableSchema, rightKeyAttrNames);
+  bool keepLeft = joinMode == JOIN_LEFT_OUTER || joinMode == JOIN_FULL_OUTER;
+  bool keepRight = joinMode == JOIN_RIGHT_OUTER || joinMode == JOIN_FULL_OUTER;
+  bool semiOrAnti = joinMode == JOIN_SEMI || joinMode == JOIN_ANTI;
+  vector<string> result;
+  vector<bool> rightMatched(rightTuples.size(), false);
+  string leftKey, rightKey, rightRest;
+  for (size_t i = 0; i < leftTuples.size(); i++) {
+    leftKey.clear();
+    leftKeys.extractKey(leftTuples[i], leftKey);
+    bool matched = false;
+    for (size_t j = 0; j < rightTuples.size(); j++) {
+      rightKey.clear();
+      rightRest.clear();
+      rightKeys.extract(rightTuples[j], rightKey, rightRest);
+      if (leftKey == rightKey) {
+        matched = true;
+        rightMatched[j] = true;
+        if (!semiOrAnti) {
+          result.push_back(leftTuples[i] + rightRest);
+        }
+      }
+    }
+    if (matched ? joinMode == JOIN_SEMI : joinMode == JOIN_ANTI) {
+      result.push_back(leftTuples[i]);
+    } else if (!matched && keepLeft) {
+      rightKey.clear();
+      rightRest.clear();
+      rightKeys.extract(
+          emptyTuple(rightTableSchema, rightKeyAttrNames, leftTuples[i],
+                     leftTableSchema, leftKeyAttrNames, catalog),
+          rightKey, rightRest);
+      result.push_back(leftTuples[i] + rightRest);
+    }
+  }
+  for (size_t j = 0; j < rightTuples.size() && keepRight; j++) {
+    if (!rightMatched[j]) {
+      rightKey.clear();
+      rightRest.clear();
+      rightKeys.extract(rightTuples[j], rightKey, rightRest);
+      result.push_back(emptyTuple(leftTableSchema, leftKeyAttrNames,
+                                  rightTuples[j], rightTableSchema,
+                                  rightKeyAttrNames, catalog) +
+                       rightRest);
+    }
+  }
+  sort(result.begin(), result.end());
+  return result;
+}
+
+// Print how a result compares with the expected one
+void printComparison(const string& what, const vector<string>& result,
+                     const vector<string>& expected) {
+  cout << what << ": " << result.size() << " tuples, expected "
+       << expected.size() << ", same: " << (result == expected ? "yes" : "no")
+       << endl;
+}
+
+// Insert tuples into a new table file
+vector<RecordId> insertTuples(const vector<string>& tuples, File& file,
+                              BufMgr* bufMgr) {
+  vector<RecordId> rids;
+  for (size_t i = 0; i < tuples.size(); i++) {
+    rids.push_back(HeapFileManager::insertTuple(tuples[i], file, bufMgr));
+  }
+  return rids;
+}
+
+void testNestedLoopJoinReadAhead(BufMgr* bufMgr, Catalog* catalog) {
+  TableId leftTableId = catalog->getTableId("r");
+  TableId rightTableId = catalog->getTableId("s");
+  TableSchema leftTableSchema = catalog->getTableSchema(leftTableId);
+  TableSchema rightTableSchema = catalog->getTableSchema(rightTableId);
+
+  // Join two tables with and without reading pages ahead
+  vector<string> results[2];
+  for (int readAhead = 0; readAhead < 2; readAhead++) {
+    NestedLoopJoinOperator joinOperator(
+        File::open(catalog->getTableFilename(leftTableId)),
+        File::open(catalog->getTableFilename(rightTableId)), leftTableSchema,
+        rightTableSchema, catalog, bufMgr);
+    joinOperator.setReadAhead(readAhead == 1);
+    string filename = leftTableSchema.getTableName() +
+                      (readAhead == 1 ? "_NLJ_RA_" : "_NLJ_NRA_") +
+                      rightTableSchema.getTableName() + ".tbl";
+    File resultFile = File::create(filename);
+    joinOperator.execute(5, resultFile);
+    results[readAhead] = readSortedTuples(resultFile, bufMgr);
+  }
+
+  // Both joins must return the same tuples
+  cout << "Result tuples without read-ahead: " << results[0].size() << endl;
+  cout << "Result tuples with read-ahead: " << results[1].size() << endl;
+  cout << "Same result: " << (results[0] == results[1] ? "yes" : "no")
+       << endl;
+}
+
 void testGraceHashJoin(BufMgr* bufMgr, Catalog* catalog) {
   TableId leftTableId = catalog->getTableId("r");
   TableId rightTableId = catalog->getTableId("s");
@@ -155,6 +338,1054 @@ void testGraceHashJoin(BufMgr* bufMgr, Catalog* catalog) {
   scanner.print();
 }
 
+void testPinTracking(BufMgr* bufMgr) {
+  // Three pages, two of them left dirty in the buffer pool
+  bufMgr->setPinTracking(true);
+  File pinFile = File::create("PIN.tbl");
+  PageId pageNos[3];
+  for (int i = 0; i < 3; i++) {
+    Page* page;
+    bufMgr->allocPage(&pinFile, pageNos[i], page);
+    bufMgr->unPinPage(&pinFile, pageNos[i], i < 2);
+  }
+
+  // A scope which reads a page and forgets to unpin it
+  {
+    BufPinScope pinScope(bufMgr, "LEAKY_SCAN");
+    Page* page;
+    bufMgr->readPage(&pinFile, pageNos[2], page);
+  }
+  FrameUsage usage = bufMgr->getFrameUsage()["PIN.tbl"];
+  cout << "Frames: " << usage.frames << ", pinned: " << usage.pinned
+       << ", dirty: " << usage.dirty << endl;
+  stringstream leak;
+  leak << "pageNo:" << pageNos[2];
+  string report = bufMgr->reportPins(&pinFile);
+  cout << "Leaked pin reported against its owner: "
+       << (report.find(leak.str()) != string::npos &&
+                   report.find("owners:LEAKY_SCAN") != string::npos
+               ? "yes"
+               : "no")
+       << endl;
+
+  // Once unpinned, nothing is reported, and flushing frees the frames
+  bufMgr->unPinPage(&pinFile, pageNos[2], false);
+  cout << "Pins reported after the unpin: "
+       << (bufMgr->reportPins(&pinFile).empty() ? "none" : "some") << endl;
+  bufMgr->flushFile(&pinFile);
+  cout << "Frames after the flush: "
+       << bufMgr->getFrameUsage().count("PIN.tbl") << endl;
+  bufMgr->setPinTracking(false);
+}
+
+void testPageGuard(BufMgr* bufMgr) {
+  File guardFile = File::create("GUARD.tbl");
+  PageId pageNo;
+  {
+    PageGuard guard = bufMgr->fetchNew(&guardFile);
+    pageNo = guard.pageNumber();
+  }
+
+  // An exception unwinding past a guard unpins and unlatches its page
+  try {
+    PageGuard guard = bufMgr->fetch(&guardFile, pageNo, LATCH_EXCLUSIVE);
+    guard.write();
+    throw runtime_error("query failed");
+  } catch (const runtime_error&) {
+    // nothing
+  }
+  atomic<bool> latched(false);
+  thread other([&]() {
+    PageGuard guard = bufMgr->fetch(&guardFile, pageNo, LATCH_EXCLUSIVE);
+    latched = true;
+  });
+  for (int i = 0; i < 200 && !latched; i++) {
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  if (latched) {
+    other.join();
+  } else {
+    other.detach();
+  }
+  cout << "Latch released by the unwind: " << (latched ? "yes" : "no")
+       << endl;
+  bool flushed = true;
+  try {
+    bufMgr->flushFile(&guardFile);
+  } catch (const PagePinnedException&) {
+    flushed = false;
+  }
+  cout << "Flush after the unwind: " << (flushed ? "yes" : "no") << endl;
+
+  // A moved-from guard releases nothing; the pin goes with the move
+  PageGuard first = bufMgr->fetch(&guardFile, pageNo, LATCH_SHARED);
+  PageGuard second(std::move(first));
+  first.release();
+  PageGuard third;
+  third = std::move(second);
+  cout << "Pins held after the moves: "
+       << bufMgr->getFrameUsage()["GUARD.tbl"].pinned << ", by the last guard: "
+       << (!first.isPinned() && !second.isPinned() && third.isPinned()
+               ? "yes"
+               : "no")
+       << endl;
+  third.release();
+  cout << "Pins held after the release: "
+       << bufMgr->getFrameUsage()["GUARD.tbl"].pinned << endl;
+}
+
+void testArena() {
+  // Allocations of 100 bytes, nine to a chunk of 1 KB, fill three chunks
+  Arena arena(1024);
+  vector<void*> first;
+  for (int i = 0; i < 24; i++) {
+    first.push_back(arena.allocate(100));
+  }
+  size_t reserved = arena.getBytesReserved();
+
+  // After a reset the same chunks hand out the same memory again
+  arena.reset();
+  vector<void*> second;
+  for (int i = 0; i < 24; i++) {
+    second.push_back(arena.allocate(100));
+  }
+  cout << "Bytes reserved: " << reserved
+       << ", after reset and reuse: " << arena.getBytesReserved() << endl;
+  cout << "Memory reused after reset: " << (first == second ? "yes" : "no")
+       << endl;
+  const char* copy = arena.copy("tuple", 5);
+  cout << "Copied bytes: " << string(copy, 5) << endl;
+  arena.release();
+  cout << "Bytes reserved after release: " << arena.getBytesReserved()
+       << endl;
+}
+
+void testMemoryTracker() {
+  // A budget of three pages: two pinned frames and a page of heap memory
+  MemoryTracker tracker;
+  tracker.reset(3);
+  tracker.chargeFrames(2);
+  tracker.chargeBytes(Page::SIZE);
+  cout << "Pages used: " << tracker.getUsedPages() << " of "
+       << tracker.getBudgetPages() << endl;
+
+  // One more byte of heap memory, or one more frame, is past the budget and
+  // is not charged
+  int numRefused = 0;
+  try {
+    tracker.chargeBytes(1);
+  } catch (const MemoryExceededException&) {
+    numRefused++;
+  }
+  try {
+    tracker.chargeFrames(1);
+  } catch (const MemoryExceededException&) {
+    numRefused++;
+  }
+  cout << "Charges past the budget refused: " << numRefused << " of 2"
+       << ", pages used: " << tracker.getUsedPages() << endl;
+
+  // Heap memory may take the place of a released frame
+  tracker.releaseFrames(1);
+  tracker.chargeBytes(1);
+  cout << "Pages used after trading a frame for heap memory: "
+       << tracker.getUsedPages() << ", peak: " << tracker.getPeakPages()
+       << endl;
+}
+
+// Format a tuple into a string through an output buffer of the given size
+string formatTuple(const string& tuple, const TableSchema& tableSchema,
+                   const TupleFormatter& formatter, size_t bufferSize) {
+  ostringstream out;
+  {
+    OutputBuffer buffer(out, bufferSize);
+    formatter.begin(tableSchema, buffer);
+    formatter.format(tuple, tableSchema, buffer);
+  }
+  return out.str();
+}
+
+void testTupleFormatters(BufMgr* bufMgr) {
+  // A tuple whose strings hold the separators, a quote, a tab, line breaks
+  // and a backslash: 7, 'a,b"c<tab>d<lf>', 'x\y<lf>z'
+  TableSchema tableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE f (n INT, c CHAR(8), v VARCHAR(16));");
+  string tuple("\0\0\0\7", 4);
+  tuple += "a,b\"c\td\n";
+  tuple += '\5';
+  tuple += "x\\y\nz00";
+
+  // Each representation, written at once and through a buffer of 3 bytes
+  uint32_t length = tuple.size();
+  const string expected[] = {
+      "(7,a,b\"c\td\n,x\\y\nz)\n",
+      "n,c,v\n7,\"a,b\"\"c\td\n\",\"x\\y\nz\"\n",
+      "7\ta,b\"c\\td\\n\tx\\\\y\\nz\n",
+      string(reinterpret_cast<const char*>(&length), sizeof(length)) + tuple};
+  TextTupleFormatter textFormatter;
+  CsvTupleFormatter csvFormatter(true);
+  TsvTupleFormatter tsvFormatter;
+  BinaryTupleFormatter binaryFormatter;
+  const TupleFormatter* formatters[] = {&textFormatter, &csvFormatter,
+                                        &tsvFormatter, &binaryFormatter};
+  const char* names[] = {"Text", "CSV", "TSV", "Binary"};
+  for (int i = 0; i < 4; i++) {
+    bool same =
+        formatTuple(tuple, tableSchema, *formatters[i],
+                    OutputBuffer::DEFAULT_SIZE) == expected[i] &&
+        formatTuple(tuple, tableSchema, *formatters[i], 3) == expected[i];
+    cout << names[i] << " output as expected: " << (same ? "yes" : "no")
+         << endl;
+  }
+
+  // A table scan writes the same to a string stream
+  File tableFile = File::create("FMT.tbl");
+  HeapFileManager::insertTuple(tuple, tableFile, bufMgr);
+  ostringstream out;
+  TableScanner scanner(tableFile, tableSchema, bufMgr);
+  scanner.print(out, csvFormatter);
+  cout << "Scanned CSV output as expected: "
+       << (out.str() == expected[1] ? "yes" : "no") << endl;
+}
+
+void testUpdate(BufMgr* bufMgr) {
+  // Tuples of 200 bytes, about 40 of them in a page
+  File updateFile = File::create("UPD.tbl");
+  vector<string> tuples;
+  for (int i = 0; i < 100; i++) {
+    stringstream ss;
+    ss << "tuple " << i;
+    tuples.push_back(ss.str());
+    tuples.back().resize(200, '.');
+  }
+  vector<RecordId> rids = insertTuples(tuples, updateFile, bufMgr);
+  PageId homePage = rids[0].page_number;
+
+  // Grow two tuples of the full first page in one batch, so that both move
+  // away and leave a forwarding stub behind
+  tuples[0] = string(2000, 'x');
+  tuples[1] = string(2000, 'y');
+  vector<pair<RecordId, string> > updates;
+  updates.push_back(make_pair(rids[0], tuples[0]));
+  updates.push_back(make_pair(rids[1], tuples[1]));
+  HeapFileManager::updateTuples(updates, updateFile, bufMgr);
+  bool moved;
+  {
+    PageGuard guard = bufMgr->fetch(&updateFile, homePage, LATCH_SHARED);
+    moved = guard.read().isForwarded(rids[0]) &&
+            guard.read().isForwarded(rids[1]);
+  }
+  cout << "Grown tuples moved: " << (moved ? "yes" : "no") << endl;
+  cout << "Moved tuple read through its record id: "
+       << (HeapFileManager::getTuple(rids[0], updateFile, bufMgr) ==
+                   tuples[0]
+               ? "yes"
+               : "no")
+       << endl;
+  vector<string> expected(tuples);
+  sort(expected.begin(), expected.end());
+  printComparison("Table after the moves", readSortedTuples(updateFile, bufMgr),
+                  expected);
+
+  // Deleting through the record id removes both the stub and the copy
+  HeapFileManager::deleteTuple(rids[1], updateFile, bufMgr);
+  bool stubDeleted = false;
+  try {
+    HeapFileManager::getTuple(rids[1], updateFile, bufMgr);
+  } catch (const InvalidRecordException&) {
+    stubDeleted = true;
+  }
+  cout << "Stub deleted: " << (stubDeleted ? "yes" : "no") << endl;
+  expected.erase(find(expected.begin(), expected.end(), tuples[1]));
+  printComparison("Table after the delete",
+                  readSortedTuples(updateFile, bufMgr), expected);
+
+  // Once the first page has room again, the vacuum brings the other tuple
+  // home, into the slot of its stub
+  vector<RecordId> deleted;
+  for (size_t i = 2; i < rids.size() && deleted.size() < 15; i++) {
+    if (rids[i].page_number == homePage) {
+      deleted.push_back(rids[i]);
+      expected.erase(find(expected.begin(), expected.end(), tuples[i]));
+    }
+  }
+  HeapFileManager::deleteTuples(deleted, updateFile, bufMgr);
+  HeapFileManager::vacuum(updateFile, bufMgr);
+  bool home;
+  {
+    PageGuard guard = bufMgr->fetch(&updateFile, homePage, LATCH_SHARED);
+    home = !guard.read().isForwarded(rids[0]) &&
+           guard.read().getRecord(rids[0]) == tuples[0];
+  }
+  cout << "Moved tuple brought home: " << (home ? "yes" : "no") << endl;
+  printComparison("Table after the vacuum",
+                  readSortedTuples(updateFile, bufMgr), expected);
+}
+
+void testWriteAheadLog(BufMgr* bufMgr, Catalog* catalog) {
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+
+  // Log the changes made through a buffer pool of its own
+  LogManager logManager("lab3_wal.log");
+  BufMgr walBufMgr(16);
+  walBufMgr.setLogManager(&logManager);
+
+  // Insert tuples and commit them
+  File walFile = File::create("r_WAL.tbl");
+  insertTuples(tuples, walFile, &walBufMgr);
+  logManager.commit();
+
+  // Crash: the pages in the buffer pool are lost, and recovery redoes the
+  // committed changes from the log
+  walBufMgr.discardFile(&walFile);
+  size_t numRedone = logManager.recover(&walBufMgr);
+  cout << "Changes redone: " << (numRedone > 0 ? "yes" : "no") << endl;
+
+  sort(tuples.begin(), tuples.end());
+  printComparison("Recovered table", readSortedTuples(walFile, &walBufMgr),
+                  tuples);
+}
+
+void testCheckpoint(BufMgr* bufMgr, Catalog* catalog) {
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+  vector<string> firstHalf(tuples.begin(), tuples.begin() + tuples.size() / 2);
+  vector<string> secondHalf(tuples.begin() + tuples.size() / 2, tuples.end());
+
+  LogManager logManager("lab3_checkpoint.log");
+  BufMgr walBufMgr(16);
+  walBufMgr.setLogManager(&logManager);
+
+  // Write the first half to disk and take a checkpoint before the second
+  File walFile = File::create("r_CKPT.tbl");
+  insertTuples(firstHalf, walFile, &walBufMgr);
+  walBufMgr.flushFile(&walFile);
+  Lsn checkpointLsn = logManager.checkpoint(&walBufMgr);
+  insertTuples(secondHalf, walFile, &walBufMgr);
+  logManager.commit();
+
+  // Count the changes logged after the checkpoint
+  vector<LogRecord> records = logManager.readRecords();
+  size_t numChanges = 0;
+  size_t numChangesAfterCheckpoint = 0;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].type == LOG_COMMIT || records[i].type == LOG_CHECKPOINT) {
+      continue;
+    }
+    numChanges++;
+    if (records[i].lsn > checkpointLsn) {
+      numChangesAfterCheckpoint++;
+    }
+  }
+
+  // Crash: the second half is lost, and recovery starts at the checkpoint,
+  // so the first half is not redone
+  walBufMgr.discardFile(&walFile);
+  size_t numRedone = logManager.recover(&walBufMgr);
+  cout << "Changes redone only after the checkpoint: "
+       << (numRedone > 0 && numRedone <= numChangesAfterCheckpoint &&
+                   numChangesAfterCheckpoint < numChanges
+               ? "yes"
+               : "no")
+       << endl;
+
+  sort(tuples.begin(), tuples.end());
+  printComparison("Recovered table", readSortedTuples(walFile, &walBufMgr),
+                  tuples);
+}
+
+void testLatchesAndLocks(BufMgr* bufMgr) {
+  LockManager lockManager;
+  HeapFileManager::setLockManager(&lockManager);
+
+  // Tuples of one repeated character, so that a torn read shows
+  File lockFile = File::create("LOCK.tbl");
+  vector<RecordId> rids =
+      insertTuples(vector<string>(400, string(32, 'a')), lockFile, bufMgr);
+
+  // Two threads update the tuples while two threads read them
+  atomic<int> numTorn(0);
+  vector<thread> threads;
+  for (int t = 0; t < 2; t++) {
+    threads.push_back(thread([&, t]() {
+      for (size_t i = t; i < rids.size(); i += 2) {
+        HeapFileManager::updateTuple(rids[i], string(32, 'b' + t), lockFile,
+                                     bufMgr);
+      }
+    }));
+    threads.push_back(thread([&]() {
+      for (size_t i = 0; i < rids.size(); i++) {
+        string tuple = HeapFileManager::getTuple(rids[i], lockFile, bufMgr);
+        if (tuple.find_first_not_of(tuple[0]) != string::npos) {
+          numTorn++;
+        }
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  HeapFileManager::setLockManager(NULL);
+
+  int numUpdated = 0;
+  for (size_t i = 0; i < rids.size(); i++) {
+    if (HeapFileManager::getTuple(rids[i], lockFile, bufMgr) ==
+        string(32, 'b' + i % 2)) {
+      numUpdated++;
+    }
+  }
+  cout << "Torn reads: " << numTorn << endl;
+  cout << "Updated tuples: " << numUpdated << " of " << rids.size() << endl;
+
+  // An exclusive row lock keeps other transactions out until released
+  lockManager.lock(1, lockFile.filename(), rids[0], LOCK_EXCLUSIVE);
+  bool blocked =
+      !lockManager.tryLock(2, lockFile.filename(), rids[0], LOCK_SHARED);
+  lockManager.unlockAll(1);
+  bool granted =
+      lockManager.tryLock(2, lockFile.filename(), rids[0], LOCK_SHARED);
+  lockManager.unlockAll(2);
+  cout << "Row lock blocks other transactions: "
+       << (blocked && granted ? "yes" : "no") << endl;
+
+  // Scan a table over and over while another thread inserts into it; a scan
+  // only unpins the pages it read, so the inserts never find their pages
+  // flushed or evicted under them
+  TableSchema scanTableSchema =
+      TableSchema::fromSQLStatement("CREATE TABLE scan (x CHAR(32));");
+  File::create("SCAN.tbl");
+  atomic<bool> inserting(true);
+  atomic<int> numFailed(0);
+  thread inserter([&]() {
+    try {
+      File insertFile = File::open("SCAN.tbl");
+      insertTuples(vector<string>(2000, string(32, 'c')), insertFile, bufMgr);
+    } catch (const BadgerDbException&) {
+      numFailed++;
+    }
+    inserting = false;
+  });
+  File scanFile = File::open("SCAN.tbl");
+  TableScanner scanner(scanFile, scanTableSchema, bufMgr);
+  TextTupleFormatter formatter;
+  int numScans = 0;
+  do {
+    try {
+      ostringstream out;
+      scanner.print(out, formatter);
+    } catch (const BadgerDbException&) {
+      numFailed++;
+    }
+    numScans++;
+  } while (inserting);
+  inserter.join();
+  ostringstream out;
+  scanner.print(out, formatter);
+  string text = out.str();
+  cout << "Scans failed during inserts: " << numFailed << endl;
+  cout << "Tuples scanned after inserts: "
+       << count(text.begin(), text.end(), '\n') << endl;
+}
+
+void testSpill(BufMgr* bufMgr, Catalog* catalog) {
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+
+  // Write the tuples to a temporary file and read them back
+  SpillManager spillManager(bufMgr);
+  File* spillFile = spillManager.create("lab3_spill");
+  {
+    SpillWriter writer(&spillManager, spillFile);
+    for (size_t i = 0; i < tuples.size(); i++) {
+      writer.append(tuples[i]);
+    }
+  }
+  vector<string> spilled;
+  {
+    SpillReader reader(&spillManager, spillFile);
+    string record;
+    while (reader.next(record)) {
+      spilled.push_back(record);
+    }
+  }
+  printComparison("Spilled tuples", spilled, tuples);
+
+  spillManager.remove(spillFile);
+  cout << "Temporary files left: " << spillManager.getNumFiles() << endl;
+}
+
+void testVacuum(BufMgr* bufMgr, Catalog* catalog) {
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+
+  // Delete four tuples of every five
+  File vacuumFile = File::create("r_VAC.tbl");
+  vector<RecordId> rids = insertTuples(tuples, vacuumFile, bufMgr);
+  vector<RecordId> deleted;
+  vector<string> expected;
+  for (size_t i = 0; i < rids.size(); i++) {
+    if (i % 5 == 0) {
+      expected.push_back(tuples[i]);
+    } else {
+      deleted.push_back(rids[i]);
+    }
+  }
+  HeapFileManager::deleteTuples(deleted, vacuumFile, bufMgr);
+
+  // Repack the remaining tuples into fewer pages
+  VacuumResult result = HeapFileManager::vacuum(vacuumFile, bufMgr);
+  cout << "Pages before vacuum: " << result.pagesBefore
+       << ", after: " << result.pagesAfter << endl;
+
+  // A moved tuple is found by the new record id reported for it, any other
+  // one by its old record id
+  int numFound = 0;
+  for (size_t i = 0; i < rids.size(); i += 5) {
+    RecordId rid = rids[i];
+    for (size_t j = 0; j < result.relocations.size(); j++) {
+      if (result.relocations[j].first == rid) {
+        rid = result.relocations[j].second;
+        break;
+      }
+    }
+    if (HeapFileManager::getTuple(rid, vacuumFile, bufMgr) == tuples[i]) {
+      numFound++;
+    }
+  }
+  cout << "Tuples moved: " << result.relocations.size()
+       << ", found by their record ids: " << numFound << " of "
+       << expected.size() << endl;
+
+  sort(expected.begin(), expected.end());
+  printComparison("Vacuumed table", readSortedTuples(vacuumFile, bufMgr),
+                  expected);
+}
+
+void testPartitionPruning(BufMgr* bufMgr, Catalog* catalog) {
+  TableSchema leftTableSchema =
+      catalog->getTableSchema(catalog->getTableId("r"));
+  TableSchema rightTableSchema =
+      catalog->getTableSchema(catalog->getTableId("s"));
+  vector<string> leftTuples = readTableTuples("r", bufMgr, catalog);
+  vector<string> rightTuples = readTableTuples("s", bufMgr, catalog);
+
+  // Copies of both tables, partitioned alike by ranges of b
+  catalog->addTableSchema(
+      TableSchema::fromSQLStatement(
+          "CREATE TABLE rp (a CHAR(8) UNIQUE NOT NULL, b INT);"),
+      "rp.tbl");
+  catalog->addTableSchema(
+      TableSchema::fromSQLStatement(
+          "CREATE TABLE sp (b INT UNIQUE NOT NULL, c VARCHAR(8));"),
+      "sp.tbl");
+  TableId leftTableId = catalog->getTableId("rp");
+  TableId rightTableId = catalog->getTableId("sp");
+  vector<int> bounds;
+  bounds.push_back(25);
+  bounds.push_back(50);
+  bounds.push_back(75);
+  catalog->setPartitionScheme(leftTableId,
+                              PartitionScheme::byRange("b", bounds));
+  catalog->setPartitionScheme(rightTableId,
+                              PartitionScheme::byRange("b", bounds));
+  PartitionedTable leftTable(catalog, leftTableId, true);
+  PartitionedTable rightTable(catalog, rightTableId, true);
+  for (size_t i = 0; i < leftTuples.size(); i++) {
+    leftTable.insertTuple(leftTuples[i], bufMgr);
+  }
+  for (size_t i = 0; i < rightTuples.size(); i++) {
+    rightTable.insertTuple(rightTuples[i], bufMgr);
+  }
+
+  // Scan the tuples with b from 30 to 39, which lie in one partition
+  TextTupleFormatter formatter;
+  PartitionedTableScanner scanner(leftTable, bufMgr);
+  scanner.setKeyRange("b", KeyRange::between(30, 39));
+  stringstream scanned;
+  scanner.print(scanned, formatter);
+  cout << "Scanned partitions: " << scanner.getNumScannedPartitions() << " of "
+       << leftTable.getPartitionCount() << endl;
+
+  // A plain scan of the table filtered on b
+  stringstream filtered;
+  {
+    OutputBuffer out(filtered);
+    for (size_t i = 0; i < leftTuples.size(); i++) {
+      if (KeyRange::between(30, 39).contains(PartitionScheme::getIntAttr(
+              leftTuples[i], leftTableSchema, 1))) {
+        formatter.format(leftTuples[i], leftTableSchema, out);
+      }
+    }
+  }
+  vector<string> scannedLines, filteredLines;
+  string line;
+  while (getline(scanned, line)) scannedLines.push_back(line);
+  while (getline(filtered, line)) filteredLines.push_back(line);
+  sort(scannedLines.begin(), scannedLines.end());
+  sort(filteredLines.begin(), filteredLines.end());
+  printComparison("Pruned scan", scannedLines, filteredLines);
+
+  // Join the tables partition by partition
+  PartitionWiseJoinOperator joinOperator(leftTable, rightTable, catalog,
+                                         bufMgr);
+  File resultFile = File::create("rp_PWJ_sp.tbl");
+  joinOperator.execute(10, resultFile);
+  vector<string> leftKeys(1, "b"), rightKeys(1, "b");
+  printComparison("Partition-wise join", readSortedTuples(resultFile, bufMgr),
+                  nestedLoopJoin(leftTuples, rightTuples, leftTableSchema,
+                                 rightTableSchema, leftKeys, rightKeys));
+}
+
+void testMaterializedView(BufMgr* bufMgr, Catalog* catalog) {
+  vector<string> leftTuples = readTableTuples("r", bufMgr, catalog);
+  vector<string> rightTuples = readTableTuples("s", bufMgr, catalog);
+
+  // Copies of both tables, filled half before the view is created
+  TableSchema leftTableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE rv (a CHAR(8) UNIQUE NOT NULL, b INT);");
+  TableSchema rightTableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE sv (b INT UNIQUE NOT NULL, c VARCHAR(8));");
+  catalog->addTableSchema(leftTableSchema, "rv.tbl");
+  catalog->addTableSchema(rightTableSchema, "sv.tbl");
+  File leftTableFile = File::create("rv.tbl");
+  File rightTableFile = File::create("sv.tbl");
+  size_t leftHalf = leftTuples.size() / 2;
+  size_t rightHalf = rightTuples.size() / 2;
+  vector<RecordId> leftRids = insertTuples(
+      vector<string>(leftTuples.begin(), leftTuples.begin() + leftHalf),
+      leftTableFile, bufMgr);
+  insertTuples(
+      vector<string>(rightTuples.begin(), rightTuples.begin() + rightHalf),
+      rightTableFile, bufMgr);
+
+  JoinViewMaintainer maintainer(catalog, bufMgr);
+  TableId viewId = maintainer.createView("v", catalog->getTableId("rv"),
+                                         catalog->getTableId("sv"), "v.tbl");
+
+  // Insert the other halves and delete every seventh left tuple; the view
+  // follows the changes
+  insertTuples(vector<string>(leftTuples.begin() + leftHalf, leftTuples.end()),
+               leftTableFile, bufMgr);
+  insertTuples(
+      vector<string>(rightTuples.begin() + rightHalf, rightTuples.end()),
+      rightTableFile, bufMgr);
+  vector<RecordId> deleted;
+  for (size_t i = 0; i < leftRids.size(); i += 7) {
+    deleted.push_back(leftRids[i]);
+  }
+  HeapFileManager::deleteTuples(deleted, leftTableFile, bufMgr);
+  cout << "Incremental joins: "
+       << (maintainer.getNumDeltaJoins() > 0 ? "yes" : "no") << endl;
+
+  File viewFile = File::open(catalog->getTableFilename(viewId));
+  vector<string> leftKeys(1, "b"), rightKeys(1, "b");
+  printComparison("View", readSortedTuples(viewFile, bufMgr),
+                  nestedLoopJoin(readTuples(leftTableFile, bufMgr),
+                                 readTuples(rightTableFile, bufMgr),
+                                 leftTableSchema, rightTableSchema, leftKeys,
+                                 rightKeys));
+}
+
+void testBandJoin(BufMgr* bufMgr, Catalog* catalog) {
+  TableId leftTableId = catalog->getTableId("r");
+  TableId rightTableId = catalog->getTableId("s");
+  TableSchema leftTableSchema = catalog->getTableSchema(leftTableId);
+  TableSchema rightTableSchema = catalog->getTableSchema(rightTableId);
+  vector<string> leftTuples = readTableTuples("r", bufMgr, catalog);
+  vector<string> rightTuples = readTableTuples("s", bufMgr, catalog);
+
+  // Join tuples whose b differ by at most 2
+  BandPredicate predicate = BandPredicate::band("b", "b", 2);
+  BandJoinOperator joinOperator(
+      File::open(catalog->getTableFilename(leftTableId)),
+      File::open(catalog->getTableFilename(rightTableId)), leftTableSchema,
+      rightTableSchema, catalog, bufMgr, predicate);
+  File resultFile = File::create("r_BJ_s.tbl");
+  joinOperator.execute(6, resultFile);
+
+  // A plain nested loop over both tables
+  vector<string> expected;
+  for (size_t i = 0; i < leftTuples.size(); i++) {
+    for (size_t j = 0; j < rightTuples.size(); j++) {
+      if (predicate.matches(
+              PartitionScheme::getIntAttr(leftTuples[i], leftTableSchema, 1),
+              PartitionScheme::getIntAttr(rightTuples[j], rightTableSchema,
+                                          0))) {
+        expected.push_back(leftTuples[i] + rightTuples[j]);
+      }
+    }
+  }
+  sort(expected.begin(), expected.end());
+  printComparison(predicate.toString(), readSortedTuples(resultFile, bufMgr),
+                  expected);
+}
+
+// Join two tables of the catalog in each join mode, and compare the results
+// with a plain nested loop
+void compareJoinModes(const string& leftTableName,
+                      const string& rightTableName,
+                      const vector<string>& leftKeyAttrNames,
+                      const vector<string>& rightKeyAttrNames,
+                      BufMgr* bufMgr, Catalog* catalog) {
+  TableId leftTableId = catalog->getTableId(leftTableName);
+  TableId rightTableId = catalog->getTableId(rightTableName);
+  TableSchema leftTableSchema = catalog->getTableSchema(leftTableId);
+  TableSchema rightTableSchema = catalog->getTableSchema(rightTableId);
+  vector<string> leftTuples = readTableTuples(leftTableName, bufMgr, catalog);
+  vector<string> rightTuples =
+      readTableTuples(rightTableName, bufMgr, catalog);
+
+  const JoinMode modes[] = {JOIN_INNER, JOIN_LEFT_OUTER, JOIN_RIGHT_OUTER,
+                            JOIN_FULL_OUTER, JOIN_SEMI, JOIN_ANTI};
+  const char* names[] = {" inner join ", " left outer join ",
+                         " right outer join ", " full outer join ",
+                         " semi join ", " anti join "};
+  for (int m = 0; m < 6; m++) {
+    NestedLoopJoinOperator joinOperator(
+        File::open(catalog->getTableFilename(leftTableId)),
+        File::open(catalog->getTableFilename(rightTableId)), leftTableSchema,
+        rightTableSchema, catalog, bufMgr);
+    joinOperator.setJoinKeys(leftKeyAttrNames, rightKeyAttrNames);
+    joinOperator.setJoinMode(modes[m]);
+    File resultFile = File::create(leftTableName + "_NLJ_" + char('0' + m) +
+                                   "_" + rightTableName + ".tbl");
+    joinOperator.execute(10, resultFile);
+    printComparison(leftTableName + names[m] + rightTableName,
+                    readSortedTuples(resultFile, bufMgr),
+                    nestedLoopJoin(leftTuples, rightTuples, leftTableSchema,
+                                   rightTableSchema, leftKeyAttrNames,
+                                   rightKeyAttrNames, modes[m], catalog));
+  }
+}
+
+void testJoinModes(BufMgr* bufMgr, Catalog* catalog) {
+  // A table with half of its values of b matching those of r
+  TableSchema tableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE t (b INT UNIQUE NOT NULL, d VARCHAR(8));");
+  catalog->addTableSchema(tableSchema, "t.tbl");
+  {
+    File tableFile = File::create("t.tbl");
+    for (int i = 50; i < 150; i++) {
+      stringstream ss;
+      ss << "INSERT INTO t VALUES (" << i << ", 't" << i << "');";
+      HeapFileManager::insertTuple(
+          HeapFileManager::createTupleFromSQLStatement(ss.str(), catalog),
+          tableFile, bufMgr);
+    }
+  }
+
+  // r is the larger table, so the first joins read t in blocks and the
+  // second ones r
+  vector<string> keys(1, "b");
+  compareJoinModes("r", "t", keys, keys, bufMgr, catalog);
+  compareJoinModes("t", "r", keys, keys, bufMgr, catalog);
+}
+
+void testJoinKeys(BufMgr* bufMgr, Catalog* catalog) {
+  // A table with half of its keys matching the values of b of r
+  TableSchema tableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE u (k INT UNIQUE NOT NULL, d VARCHAR(8));");
+  catalog->addTableSchema(tableSchema, "u.tbl");
+  {
+    File tableFile = File::create("u.tbl");
+    for (int i = 50; i < 150; i++) {
+      stringstream ss;
+      ss << "INSERT INTO u VALUES (" << i << ", 'u" << i << "');";
+      HeapFileManager::insertTuple(
+          HeapFileManager::createTupleFromSQLStatement(ss.str(), catalog),
+          tableFile, bufMgr);
+    }
+  }
+
+  // r and u have no attribute in common, so the keys are given
+  vector<string> leftKeys(1, "b"), rightKeys(1, "k");
+  compareJoinModes("r", "u", leftKeys, rightKeys, bufMgr, catalog);
+  compareJoinModes("u", "r", rightKeys, leftKeys, bufMgr, catalog);
+}
+
+void testTopK(BufMgr* bufMgr, Catalog* catalog) {
+  TableId tableId = catalog->getTableId("r");
+  TableSchema tableSchema = catalog->getTableSchema(tableId);
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+
+  // ORDER BY b DESC, a LIMIT 10
+  TopKOperator topKOperator(File::open(catalog->getTableFilename(tableId)),
+                            tableSchema, bufMgr, 10);
+  vector<SortKey> orderBy;
+  orderBy.push_back(SortKey::desc("b"));
+  orderBy.push_back(SortKey::asc("a"));
+  topKOperator.setOrderBy(orderBy);
+  File resultFile = File::create("r_TOPK.tbl");
+  topKOperator.execute(3, resultFile);
+
+  // Sort the whole table and keep the first ten
+  vector<pair<int, string> > sorted;
+  for (size_t i = 0; i < tuples.size(); i++) {
+    sorted.push_back(make_pair(
+        -PartitionScheme::getIntAttr(tuples[i], tableSchema, 1), tuples[i]));
+  }
+  sort(sorted.begin(), sorted.end());
+  vector<string> expected;
+  for (size_t i = 0; i < 10 && i < sorted.size(); i++) {
+    expected.push_back(sorted[i].second);
+  }
+  printComparison("Top 10", readTuples(resultFile, bufMgr), expected);
+
+  // LIMIT 10 stops the scan early, and leaves no page of the table pinned
+  TopKOperator limitOperator(File::open(catalog->getTableFilename(tableId)),
+                             tableSchema, bufMgr, 10);
+  File limitFile = File::create("r_LIMIT.tbl");
+  limitOperator.execute(3, limitFile);
+  printComparison("First 10", readTuples(limitFile, bufMgr),
+                  vector<string>(tuples.begin(), tuples.begin() + 10));
+  File tableFile = File::open(catalog->getTableFilename(tableId));
+  try {
+    bufMgr->flushFile(&tableFile);
+    cout << "Table pages unpinned: yes" << endl;
+  } catch (const PagePinnedException&) {
+    cout << "Table pages unpinned: no" << endl;
+  }
+}
+
+void testWindow(BufMgr* bufMgr, Catalog* catalog) {
+  TableId tableId = catalog->getTableId("r");
+  TableSchema tableSchema = catalog->getTableSchema(tableId);
+  vector<string> tuples = readTableTuples("r", bufMgr, catalog);
+
+  // ROW_NUMBER() OVER (PARTITION BY b ORDER BY a)
+  vector<string> partitionBy(1, "b");
+  vector<SortKey> orderBy(1, SortKey::asc("a"));
+  vector<WindowFunction> functions(1, WindowFunction::rowNumber("rn"));
+  WindowOperator windowOperator(File::open(catalog->getTableFilename(tableId)),
+                                tableSchema, bufMgr, partitionBy, orderBy,
+                                functions);
+  File resultFile = File::create("r_WIN.tbl");
+  windowOperator.execute(6, resultFile);
+  cout << "Partitions: " << windowOperator.getNumPartitions() << endl;
+
+  // Number the tuples of each b in the order of a; a comes first in the
+  // tuple, so the tuples sort by it
+  vector<pair<int, string> > sorted;
+  for (size_t i = 0; i < tuples.size(); i++) {
+    sorted.push_back(make_pair(
+        PartitionScheme::getIntAttr(tuples[i], tableSchema, 1), tuples[i]));
+  }
+  sort(sorted.begin(), sorted.end());
+  vector<string> expected;
+  int rowNumber = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (i > 0 && sorted[i - 1].first == sorted[i].first) {
+      rowNumber++;
+    } else {
+      rowNumber = 1;
+    }
+    stringstream ss;
+    ss << sorted[i].second.size() << ":" << rowNumber;
+    expected.push_back(sorted[i].second + ss.str());
+  }
+  sort(expected.begin(), expected.end());
+
+  // Decode the row numbers of the result the same way
+  const TableSchema& resultSchema = windowOperator.getResultTableSchema();
+  vector<string> result = readTuples(resultFile, bufMgr);
+  for (size_t i = 0; i < result.size(); i++) {
+    string tuple = result[i].substr(0, result[i].size() - sizeof(int));
+    stringstream ss;
+    ss << tuple.size() << ":"
+       << PartitionScheme::getIntAttr(result[i], resultSchema,
+                                      resultSchema.getAttrCount() - 1);
+    result[i] = tuple + ss.str();
+  }
+  sort(result.begin(), result.end());
+  printComparison("Row numbers", result, expected);
+}
+
+void testWindowFunctions(BufMgr* bufMgr, Catalog* catalog) {
+  // A table with few values of v in each value of g, in the order of n
+  TableSchema tableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE w (n CHAR(8) UNIQUE NOT NULL, g INT, v INT);");
+  catalog->addTableSchema(tableSchema, "w.tbl");
+  vector<string> tuples;
+  {
+    File tableFile = File::create("w.tbl");
+    for (int i = 0; i < 60; i++) {
+      stringstream ss;
+      ss << "INSERT INTO w VALUES ('w" << i << "', " << i % 3 << ", "
+         << i % 7 << ");";
+      tuples.push_back(
+          HeapFileManager::createTupleFromSQLStatement(ss.str(), catalog));
+      HeapFileManager::insertTuple(tuples.back(), tableFile, bufMgr);
+    }
+  }
+
+  // RANK(), SUM(v), AVG(v), LAG(v, 1) and LEAD(v, 2)
+  // OVER (PARTITION BY g ORDER BY v)
+  vector<string> partitionBy(1, "g");
+  vector<SortKey> orderBy(1, SortKey::asc("v"));
+  vector<WindowFunction> functions;
+  functions.push_back(WindowFunction::rank("rk"));
+  functions.push_back(WindowFunction::sum("v", "total"));
+  functions.push_back(WindowFunction::avg("v", "mean"));
+  functions.push_back(WindowFunction::lag("v", 1, "prev_v"));
+  functions.push_back(WindowFunction::lead("v", 2, "next_v"));
+  WindowOperator windowOperator(File::open("w.tbl"), tableSchema, bufMgr,
+                                partitionBy, orderBy, functions);
+  File resultFile = File::create("w_WIN.tbl");
+  windowOperator.execute(8, resultFile);
+
+  // Order the tuples by g and v, and then by their position in the table,
+  // which tuples of equal v keep
+  vector<pair<pair<int, int>, int> > sorted;
+  for (int i = 0; i < (int)tuples.size(); i++) {
+    sorted.push_back(make_pair(
+        make_pair(PartitionScheme::getIntAttr(tuples[i], tableSchema, 1),
+                  PartitionScheme::getIntAttr(tuples[i], tableSchema, 2)),
+        i));
+  }
+  sort(sorted.begin(), sorted.end());
+  vector<string> expected;
+  size_t first = 0, firstPeer = 0;
+  int total = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (sorted[i].first.first != sorted[first].first.first) {
+      first = i;
+      total = 0;
+    }
+    if (sorted[i].first != sorted[firstPeer].first) {
+      firstPeer = i;
+    }
+    int v = sorted[i].first.second;
+    total += v;
+    bool hasNext = i + 2 < sorted.size() &&
+                   sorted[i + 2].first.first == sorted[i].first.first;
+    stringstream ss;
+    ss << " " << firstPeer - first + 1 << " " << total << " "
+       << total / (int)(i - first + 1) << " "
+       << (i > first ? sorted[i - 1].first.second : 0) << " "
+       << (hasNext ? sorted[i + 2].first.second : 0);
+    expected.push_back(tuples[sorted[i].second] + ss.str());
+  }
+  sort(expected.begin(), expected.end());
+
+  // Decode the results of the functions the same way
+  const TableSchema& resultSchema = windowOperator.getResultTableSchema();
+  vector<string> result = readTuples(resultFile, bufMgr);
+  for (size_t i = 0; i < result.size(); i++) {
+    stringstream ss;
+    for (int f = 0; f < 5; f++) {
+      ss << " "
+         << PartitionScheme::getIntAttr(result[i], resultSchema,
+                                        tableSchema.getAttrCount() + f);
+    }
+    result[i] = result[i].substr(0, tuples[0].size()) + ss.str();
+  }
+  sort(result.begin(), result.end());
+  printComparison("Ranks, sums, averages, lags and leads", result, expected);
+}
+
+void testSetOperations(BufMgr* bufMgr, Catalog* catalog) {
+  TableSchema leftTableSchema =
+      catalog->getTableSchema(catalog->getTableId("r"));
+  vector<string> leftTuples = readTableTuples("r", bufMgr, catalog);
+
+  // A table holding every other tuple of r and as many of its own
+  TableSchema rightTableSchema = TableSchema::fromSQLStatement(
+      "CREATE TABLE q (a CHAR(8) UNIQUE NOT NULL, b INT);");
+  catalog->addTableSchema(rightTableSchema, "q.tbl");
+  {
+    File rightTableFile = File::create("q.tbl");
+    for (size_t i = 0; i < leftTuples.size(); i += 2) {
+      HeapFileManager::insertTuple(leftTuples[i], rightTableFile, bufMgr);
+      stringstream ss;
+      ss << "INSERT INTO q VALUES ('q" << i << "', " << i % 7 << ");";
+      HeapFileManager::insertTuple(
+          HeapFileManager::createTupleFromSQLStatement(ss.str(), catalog),
+          rightTableFile, bufMgr);
+    }
+  }
+  vector<string> rightTuples = readTableTuples("q", bufMgr, catalog);
+  set<string> leftSet(leftTuples.begin(), leftTuples.end());
+  set<string> rightSet(rightTuples.begin(), rightTuples.end());
+
+  const SetOperation operations[] = {SET_UNION, SET_INTERSECT, SET_EXCEPT};
+  const SetStrategy strategies[] = {SET_HASH_PARTITION, SET_SORT_MERGE};
+  for (int o = 0; o < 3; o++) {
+    vector<string> expected;
+    if (operations[o] == SET_UNION) {
+      set_union(leftSet.begin(), leftSet.end(), rightSet.begin(),
+                rightSet.end(), back_inserter(expected));
+    } else if (operations[o] == SET_INTERSECT) {
+      set_intersection(leftSet.begin(), leftSet.end(), rightSet.begin(),
+                       rightSet.end(), back_inserter(expected));
+    } else {
+      set_difference(leftSet.begin(), leftSet.end(), rightSet.begin(),
+                     rightSet.end(), back_inserter(expected));
+    }
+    for (int s = 0; s < 2; s++) {
+      SetOperator setOperator(File::open("r.tbl"), File::open("q.tbl"),
+                              leftTableSchema, rightTableSchema, bufMgr,
+                              operations[o], strategies[s]);
+      stringstream filename;
+      filename << "r_SET" << o << s << "_q.tbl";
+      File resultFile = File::create(filename.str());
+      setOperator.execute(4, resultFile);
+      stringstream what;
+      what << setOperator.getOperatorName()
+           << (strategies[s] == SET_SORT_MERGE ? " (sort-merge)" : " (hash)");
+      printComparison(what.str(), readSortedTuples(resultFile, bufMgr),
+                      expected);
+    }
+  }
+}
+
+void testAdaptiveJoin(BufMgr* bufMgr, Catalog* catalog) {
+  TableId leftTableId = catalog->getTableId("r");
+  TableId rightTableId = catalog->getTableId("s");
+  TableSchema leftTableSchema = catalog->getTableSchema(leftTableId);
+  TableSchema rightTableSchema = catalog->getTableSchema(rightTableId);
+
+  AdaptiveJoinOperator joinOperator(
+      File::open(catalog->getTableFilename(leftTableId)),
+      File::open(catalog->getTableFilename(rightTableId)), leftTableSchema,
+      rightTableSchema, catalog, bufMgr);
+  File resultFile = File::create("r_AJ_s.tbl");
+  joinOperator.execute(6, resultFile);
+
+  vector<string> leftKeys(1, "b"), rightKeys(1, "b");
+  printComparison("Adaptive join", readSortedTuples(resultFile, bufMgr),
+                  nestedLoopJoin(readTableTuples("r", bufMgr, catalog),
+                                 readTableTuples("s", bufMgr, catalog),
+                                 leftTableSchema, rightTableSchema, leftKeys,
+                                 rightKeys));
+}
+
+void testNestedLoopJoinBuildSide(BufMgr* bufMgr, Catalog* catalog) {
+  TableId leftTableId = catalog->getTableId("r");
+  TableId rightTableId = catalog->getTableId("s");
+  TableSchema leftTableSchema = catalog->getTableSchema(leftTableId);
+  TableSchema rightTableSchema = catalog->getTableSchema(rightTableId);
+  vector<string> leftTuples = readTableTuples("r", bufMgr, catalog);
+  vector<string> rightTuples = readTableTuples("s", bufMgr, catalog);
+  vector<string> keys(1, "b");
+
+  // The smaller table is read in blocks whichever side it is on
+  for (int swapped = 0; swapped < 2; swapped++) {
+    TableId firstTableId = swapped ? rightTableId : leftTableId;
+    TableId secondTableId = swapped ? leftTableId : rightTableId;
+    NestedLoopJoinOperator joinOperator(
+        File::open(catalog->getTableFilename(firstTableId)),
+        File::open(catalog->getTableFilename(secondTableId)),
+        swapped ? rightTableSchema : leftTableSchema,
+        swapped ? leftTableSchema : rightTableSchema, catalog, bufMgr);
+    File resultFile = File::create(swapped ? "s_NLJ_r.tbl" : "r_NLJ_BS_s.tbl");
+    joinOperator.execute(5, resultFile);
+    printComparison(
+        swapped ? "s joined with r" : "r joined with s",
+        readSortedTuples(resultFile, bufMgr),
+        swapped ? nestedLoopJoin(rightTuples, leftTuples, rightTableSchema,
+                                 leftTableSchema, keys, keys)
+                : nestedLoopJoin(leftTuples, rightTuples, leftTableSchema,
+                                 rightTableSchema, keys, keys));
+  }
+}
+
 int main() {
   // Create buffer pool
   int availableBufPages = 256;
@@ -174,6 +1405,98 @@ int main() {
   cout << "Test Nested-Loop Join ..." << endl;
   testNestedLoopJoin(bufMgr, catalog);
 
+  // Test nested-loop join operator with and without read-ahead
+  cout << "Test Nested-Loop Join Read-Ahead ..." << endl;
+  testNestedLoopJoinReadAhead(bufMgr, catalog);
+
+  // Test pin tracking
+  cout << "Test Pin Tracking ..." << endl;
+  testPinTracking(bufMgr);
+
+  // Test page guard
+  cout << "Test Page Guard ..." << endl;
+  testPageGuard(bufMgr);
+
+  // Test arena
+  cout << "Test Arena ..." << endl;
+  testArena();
+
+  // Test memory tracker
+  cout << "Test Memory Tracker ..." << endl;
+  testMemoryTracker();
+
+  // Test tuple formatters
+  cout << "Test Tuple Formatters ..." << endl;
+  testTupleFormatters(bufMgr);
+
+  // Test update
+  cout << "Test Update ..." << endl;
+  testUpdate(bufMgr);
+
+  // Test write-ahead log
+  cout << "Test Write-Ahead Log ..." << endl;
+  testWriteAheadLog(bufMgr, catalog);
+
+  // Test checkpoint
+  cout << "Test Checkpoint ..." << endl;
+  testCheckpoint(bufMgr, catalog);
+
+  // Test latches and locks
+  cout << "Test Latches and Locks ..." << endl;
+  testLatchesAndLocks(bufMgr);
+
+  // Test spill
+  cout << "Test Spill ..." << endl;
+  testSpill(bufMgr, catalog);
+
+  // Test vacuum
+  cout << "Test Vacuum ..." << endl;
+  testVacuum(bufMgr, catalog);
+
+  // Test partition pruning
+  cout << "Test Partition Pruning ..." << endl;
+  testPartitionPruning(bufMgr, catalog);
+
+  // Test materialized view
+  cout << "Test Materialized View ..." << endl;
+  testMaterializedView(bufMgr, catalog);
+
+  // Test band join
+  cout << "Test Band Join ..." << endl;
+  testBandJoin(bufMgr, catalog);
+
+  // Test join modes
+  cout << "Test Join Modes ..." << endl;
+  testJoinModes(bufMgr, catalog);
+
+  // Test join keys
+  cout << "Test Join Keys ..." << endl;
+  testJoinKeys(bufMgr, catalog);
+
+  // Test Top-K
+  cout << "Test Top-K ..." << endl;
+  testTopK(bufMgr, catalog);
+
+  // Test window
+  cout << "Test Window ..." << endl;
+  testWindow(bufMgr, catalog);
+
+  // Test window functions
+  cout << "Test Window Functions ..." << endl;
+  testWindowFunctions(bufMgr, catalog);
+
+  // Test set operations
+  cout << "Test Set Operations ..." << endl;
+  testSetOperations(bufMgr, catalog);
+
+  // Test adaptive join
+  cout << "Test Adaptive Join ..." << endl;
+  testAdaptiveJoin(bufMgr, catalog);
+
+  // Test nested-loop join build side
+  cout << "Test Nested-Loop Join Build Side ..." << endl;
+  testNestedLoopJoinBuildSide(bufMgr, catalog);
+
   // Test grace-loop join operator
   // cout << "Test Grace Hash Join ..." << endl;
   // testGraceHashJoin(bufMgr, catalog);
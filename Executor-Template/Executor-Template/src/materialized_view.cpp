@@ -0,0 +1,226 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "materialized_view.h"
+
+#include <map>
+#include <utility>
+
+#include "exceptions/view_exception.h"
+#include "executor.h"
+#include "file_iterator.h"
+#include "page_iterator.h"
+#include "spill_manager.h"
+
+namespace badgerdb {
+
+// every tuple of a file
+static vector<string> readAll(File& file, BufMgr* bufMgr) {
+  vector<string> tuples;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end(); ++page_iter) {
+      tuples.push_back(*page_iter);
+    }
+  }
+  return tuples;
+}
+
+// delete one copy of each of the tuples from a file
+static int deleteCopies(File& file,
+                        const vector<string>& tuples,
+                        BufMgr* bufMgr) {
+  map<string, int> pending;
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    ++pending[tuples[i]];
+  }
+  size_t num_pending = tuples.size();
+  vector<RecordId> rids;
+  for (FileIterator iter = file.begin();
+       iter != file.end() && num_pending > 0; ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    for (PageIterator page_iter = guard.read().begin();
+         page_iter != guard.read().end() && num_pending > 0; ++page_iter) {
+      map<string, int>::iterator it = pending.find(*page_iter);
+      if (it != pending.end() && it->second > 0) {
+        rids.push_back(page_iter.record_id());
+        --it->second;
+        --num_pending;
+      }
+    }
+  }
+  return HeapFileManager::deleteTuples(rids, file, bufMgr);
+}
+
+JoinViewMaintainer::JoinViewMaintainer(Catalog* catalog,
+                                       BufMgr* bufMgr,
+                                       int numAvailableBufPages)
+    : catalog(catalog),
+      bufMgr(bufMgr),
+      numAvailableBufPages(numAvailableBufPages),
+      numDeltaJoins(0),
+      numInsertedTuples(0),
+      numDeletedTuples(0) {
+  HeapFileManager::addObserver(this);
+}
+
+JoinViewMaintainer::~JoinViewMaintainer() {
+  HeapFileManager::removeObserver(this);
+}
+
+TableId JoinViewMaintainer::createView(const string& viewName,
+                                       const TableId& leftId,
+                                       const TableId& rightId,
+                                       const string& viewFilename) {
+  if (leftId == rightId) {
+    throw ViewException(viewName, "self-joins are not maintained");
+  }
+  File::create(viewFilename);
+  const TableId viewId =
+      registerView(viewName, leftId, rightId, viewFilename);
+  refresh(viewId);
+  return viewId;
+}
+
+TableId JoinViewMaintainer::registerView(const string& viewName,
+                                         const TableId& leftId,
+                                         const TableId& rightId,
+                                         const string& viewFilename) {
+  if (leftId == rightId) {
+    throw ViewException(viewName, "self-joins are not maintained");
+  }
+  // the schema of the join result under the name of the view
+  const TableSchema joined = JoinOperator::createResultTableSchema(
+      catalog->getTableSchema(leftId), catalog->getTableSchema(rightId));
+  TableSchema viewSchema(viewName);
+  for (int i = 0; i < joined.getAttrCount(); ++i) {
+    viewSchema.addAttr(Attribute(joined.getAttrName(i), joined.getAttrType(i),
+                                 joined.getAttrMaxSize(i),
+                                 joined.isAttrNotNull(i),
+                                 joined.isAttrUnique(i)));
+  }
+  return catalog->addJoinView(viewSchema, viewFilename, leftId, rightId);
+}
+
+void JoinViewMaintainer::refresh(const TableId& viewId) {
+  const pair<TableId, TableId>& inputs = catalog->getJoinViewInputs(viewId);
+  File view = File::open(catalog->getTableFilename(viewId));
+  numDeletedTuples += deleteCopies(view, readAll(view, bufMgr), bufMgr);
+  // a partitioned table is joined partition by partition
+  const vector<string> left = catalog->getDataFilenames(inputs.first);
+  const vector<string> right = catalog->getDataFilenames(inputs.second);
+  for (size_t i = 0; i < left.size(); ++i) {
+    for (size_t j = 0; j < right.size(); ++j) {
+      NestedLoopJoinOperator join(File::open(left[i]), File::open(right[j]),
+                                  catalog->getTableSchema(inputs.first),
+                                  catalog->getTableSchema(inputs.second),
+                                  catalog, bufMgr);
+      join.execute(numAvailableBufPages, view);
+      numInsertedTuples += join.getNumResultTuples();
+    }
+  }
+}
+
+bool JoinViewMaintainer::holdsTuplesOf(const TableId& id,
+                                       const File& file) const {
+  const vector<string> filenames = catalog->getDataFilenames(id);
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    if (filenames[i] == file.filename()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JoinViewMaintainer::observes(const File& file) const {
+  const vector<TableId> views = catalog->getJoinViews();
+  for (size_t i = 0; i < views.size(); ++i) {
+    const pair<TableId, TableId>& inputs =
+        catalog->getJoinViewInputs(views[i]);
+    if (holdsTuplesOf(inputs.first, file) ||
+        holdsTuplesOf(inputs.second, file)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void JoinViewMaintainer::tuplesInserted(const File& file,
+                                        const vector<string>& tuples,
+                                        BufMgr* bufMgr) {
+  maintain(file, tuples, true, bufMgr);
+}
+
+void JoinViewMaintainer::tuplesDeleted(const File& file,
+                                       const vector<string>& tuples,
+                                       BufMgr* bufMgr) {
+  maintain(file, tuples, false, bufMgr);
+}
+
+void JoinViewMaintainer::maintain(const File& file,
+                                  const vector<string>& tuples,
+                                  const bool inserted,
+                                  BufMgr* bufMgr) {
+  if (tuples.empty()) {
+    return;
+  }
+  const vector<TableId> views = catalog->getJoinViews();
+  for (size_t i = 0; i < views.size(); ++i) {
+    const pair<TableId, TableId>& inputs =
+        catalog->getJoinViewInputs(views[i]);
+    if (holdsTuplesOf(inputs.first, file)) {
+      applyDelta(views[i], true, tuples, inserted, bufMgr);
+    } else if (holdsTuplesOf(inputs.second, file)) {
+      applyDelta(views[i], false, tuples, inserted, bufMgr);
+    }
+  }
+}
+
+void JoinViewMaintainer::applyDelta(const TableId& viewId,
+                                    const bool deltaIsLeft,
+                                    const vector<string>& tuples,
+                                    const bool inserted,
+                                    BufMgr* bufMgr) {
+  const pair<TableId, TableId>& inputs = catalog->getJoinViewInputs(viewId);
+  // the changed tuples as a table of their own, and their join results
+  SpillManager spill(bufMgr);
+  File* delta = spill.create("delta");
+  SpillWriter writer(&spill, delta);
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    writer.append(tuples[i]);
+  }
+  writer.close();
+  File* joined = spill.create("delta_join");
+
+  // the delta is joined with every partition of a partitioned other side
+  const vector<string> others = catalog->getDataFilenames(
+      deltaIsLeft ? inputs.second : inputs.first);
+  for (size_t i = 0; i < others.size(); ++i) {
+    const File other = File::open(others[i]);
+    NestedLoopJoinOperator join(deltaIsLeft ? *delta : other,
+                                deltaIsLeft ? other : *delta,
+                                catalog->getTableSchema(inputs.first),
+                                catalog->getTableSchema(inputs.second),
+                                catalog, bufMgr);
+    join.execute(numAvailableBufPages, *joined);
+  }
+  ++numDeltaJoins;
+
+  const vector<string> results = readAll(*joined, bufMgr);
+  File view = File::open(catalog->getTableFilename(viewId));
+  if (inserted) {
+    for (size_t i = 0; i < results.size(); ++i) {
+      HeapFileManager::insertTuple(results[i], view, bufMgr);
+    }
+    numInsertedTuples += results.size();
+  } else {
+    numDeletedTuples += deleteCopies(view, results, bufMgr);
+  }
+}
+
+}  // namespace badgerdb
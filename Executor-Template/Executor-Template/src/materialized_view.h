@@ -0,0 +1,171 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "catalog.h"
+#include "file.h"
+#include "storage.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Keeps the materialized join views of a catalog current.
+ *
+ * A view is a table holding the natural join of a left and a right table as
+ * computed by NestedLoopJoinOperator.  While the maintainer exists it
+ * observes the changes made through HeapFileManager.  Tuples inserted into a
+ * base table are joined with the other table and the results are appended to
+ * the view; for deleted tuples the matching results are deleted from the
+ * view.  Only the changed tuples are joined, so the cost of a change depends
+ * on the other table and not on the view.  The view is changed through
+ * HeapFileManager as well, so views may be defined over views.  A
+ * partitioned table is observed through the files of its partitions, so the
+ * tuples inserted through PartitionedTable are joined like any other.
+ *
+ * Changes made while no maintainer exists are missed; refresh() recomputes a
+ * view after them.
+ *
+ * @warning This class is not threadsafe: the base tables of the views must
+ * not be changed concurrently.
+ */
+class JoinViewMaintainer : public TableObserver {
+ public:
+  /**
+   * Constructor that starts observing the changes to the tables
+   *
+   * @param catalog               Catalog holding the views.
+   * @param bufMgr                Buffer manager used to compute views.
+   * @param numAvailableBufPages  Buffer pages given to each join.
+   */
+  JoinViewMaintainer(Catalog* catalog,
+                     BufMgr* bufMgr,
+                     int numAvailableBufPages = 10);
+
+  /**
+   * Destructor that stops observing the changes
+   */
+  ~JoinViewMaintainer();
+
+  JoinViewMaintainer(const JoinViewMaintainer&) = delete;
+  JoinViewMaintainer& operator=(const JoinViewMaintainer&) = delete;
+
+  /**
+   * Define a view and compute it into a new file
+   *
+   * @return  Table id of the view
+   * @throws ViewException If both tables are the same
+   * @throws FileExistsException If the file already exists
+   */
+  TableId createView(const string& viewName,
+                     const TableId& leftId,
+                     const TableId& rightId,
+                     const string& viewFilename);
+
+  /**
+   * Define a view over a file which already holds the join of the tables,
+   * e.g. the result file of a NestedLoopJoinOperator
+   *
+   * @return  Table id of the view
+   * @throws ViewException If both tables are the same
+   */
+  TableId registerView(const string& viewName,
+                       const TableId& leftId,
+                       const TableId& rightId,
+                       const string& viewFilename);
+
+  /**
+   * Recompute a view from its tables
+   */
+  void refresh(const TableId& viewId);
+
+  bool observes(const File& file) const;
+
+  void tuplesInserted(const File& file,
+                      const vector<string>& tuples,
+                      BufMgr* bufMgr);
+
+  void tuplesDeleted(const File& file,
+                     const vector<string>& tuples,
+                     BufMgr* bufMgr);
+
+  /**
+   * Get the number of joins run for changes to the tables
+   */
+  int getNumDeltaJoins() const { return numDeltaJoins; }
+
+  /**
+   * Get the number of tuples inserted into views
+   */
+  int getNumInsertedTuples() const { return numInsertedTuples; }
+
+  /**
+   * Get the number of tuples deleted from views
+   */
+  int getNumDeletedTuples() const { return numDeletedTuples; }
+
+ private:
+  /**
+   * Is the file the table file of the table or, if the table is
+   * partitioned, the file of one of its partitions?
+   */
+  bool holdsTuplesOf(const TableId& id, const File& file) const;
+
+  /**
+   * Apply the change of one table to the views over it
+   */
+  void maintain(const File& file,
+                const vector<string>& tuples,
+                const bool inserted,
+                BufMgr* bufMgr);
+
+  /**
+   * Join the changed tuples of one side of a view with the other side and
+   * insert the results into the view or delete them from it
+   */
+  void applyDelta(const TableId& viewId,
+                  const bool deltaIsLeft,
+                  const vector<string>& tuples,
+                  const bool inserted,
+                  BufMgr* bufMgr);
+
+  /**
+   * Catalog holding the views
+   */
+  Catalog* catalog;
+
+  /**
+   * Buffer manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Buffer pages given to each join
+   */
+  int numAvailableBufPages;
+
+  /**
+   * Number of joins run for changes
+   */
+  int numDeltaJoins;
+
+  /**
+   * Number of tuples inserted into views
+   */
+  int numInsertedTuples;
+
+  /**
+   * Number of tuples deleted from views
+   */
+  int numDeletedTuples;
+};
+
+}  // namespace badgerdb
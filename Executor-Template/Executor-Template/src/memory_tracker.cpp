@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "memory_tracker.h"
+
+#include "exceptions/memory_exceeded_exception.h"
+
+namespace badgerdb {
+
+void MemoryTracker::reset(const int budget) {
+  budgetPages = budget;
+  framePages = 0;
+  heapBytes = 0;
+  peakPages = 0;
+}
+
+void MemoryTracker::check(const int pages) {
+  if (pages > budgetPages) {
+    throw MemoryExceededException(pages, budgetPages);
+  }
+  if (pages > peakPages) {
+    peakPages = pages;
+  }
+}
+
+void MemoryTracker::chargeFrames(const int frames) {
+  check(framePages + frames + pagesFor(heapBytes));
+  framePages += frames;
+}
+
+void MemoryTracker::releaseFrames(const int frames) {
+  framePages = frames > framePages ? 0 : framePages - frames;
+}
+
+void MemoryTracker::chargeBytes(const std::size_t bytes) {
+  check(framePages + pagesFor(heapBytes + bytes));
+  heapBytes += bytes;
+}
+
+void MemoryTracker::releaseBytes(const std::size_t bytes) {
+  heapBytes = bytes > heapBytes ? 0 : heapBytes - bytes;
+}
+
+}  // namespace badgerdb
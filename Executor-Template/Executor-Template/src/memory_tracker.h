@@ -0,0 +1,126 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Accounts for the memory used by an operator in page-equivalents.
+ *
+ * Buffer frames pinned by the operator and the heap memory of its hash tables
+ * and temporary tuples are both charged against one budget, the number of
+ * buffer pages given to the operator.  Heap bytes are rounded up to whole
+ * pages of Page::SIZE bytes.
+ */
+class MemoryTracker {
+ private:
+  /**
+   * Number of pages the operator may use
+   */
+  int budgetPages;
+
+  /**
+   * Number of buffer frames currently charged
+   */
+  int framePages;
+
+  /**
+   * Heap bytes currently charged
+   */
+  std::size_t heapBytes;
+
+  /**
+   * Highest number of pages in use so far
+   */
+  int peakPages;
+
+  /**
+   * Throw if the given usage would exceed the budget, otherwise update the
+   * peak
+   */
+  void check(const int pages);
+
+ public:
+  /**
+   * Constructor of MemoryTracker class
+   */
+  MemoryTracker() { reset(0); }
+
+  /**
+   * Clear all charges and start accounting against a new budget
+   *
+   * @param budget  Number of pages the operator may use
+   */
+  void reset(const int budget);
+
+  /**
+   * Charge pinned buffer frames
+   *
+   * @param frames  Number of frames
+   * @throws MemoryExceededException If the budget would be exceeded
+   */
+  void chargeFrames(const int frames);
+
+  /**
+   * Release pinned buffer frames
+   */
+  void releaseFrames(const int frames);
+
+  /**
+   * Charge heap memory
+   *
+   * @param bytes   Number of bytes
+   * @throws MemoryExceededException If the budget would be exceeded
+   */
+  void chargeBytes(const std::size_t bytes);
+
+  /**
+   * Release heap memory
+   */
+  void releaseBytes(const std::size_t bytes);
+
+  /**
+   * Would charging the given frames and bytes stay within the budget?
+   */
+  bool canCharge(const int frames, const std::size_t bytes) const {
+    return framePages + frames + pagesFor(heapBytes + bytes) <= budgetPages;
+  }
+
+  /**
+   * Get the number of pages the operator may use
+   */
+  int getBudgetPages() const { return budgetPages; }
+
+  /**
+   * Get the number of pages in use, frames plus heap memory
+   */
+  int getUsedPages() const { return framePages + pagesFor(heapBytes); }
+
+  /**
+   * Get the number of pages in use at the high-water mark
+   */
+  int getPeakPages() const { return peakPages; }
+
+  /**
+   * Get the heap bytes currently charged
+   */
+  std::size_t getHeapBytes() const { return heapBytes; }
+
+  /**
+   * Number of pages needed to hold the given bytes
+   */
+  static int pagesFor(const std::size_t bytes) {
+    return static_cast<int>((bytes + Page::SIZE - 1) / Page::SIZE);
+  }
+};
+
+}  // namespace badgerdb
@@ -6,6 +6,7 @@
  */
 
 #include <cassert>
+#include <cstring>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -16,6 +17,33 @@
 
 namespace badgerdb {
 
+namespace {
+
+// a record id as stored in a forwarding stub or in front of a moved copy
+std::string encodeRecordId(const RecordId& record_id) {
+  std::string bytes(sizeof(record_id.page_number) +
+                        sizeof(record_id.slot_number),
+                    '\0');
+  std::memcpy(&bytes[0], &record_id.page_number,
+              sizeof(record_id.page_number));
+  std::memcpy(&bytes[sizeof(record_id.page_number)], &record_id.slot_number,
+              sizeof(record_id.slot_number));
+  return bytes;
+}
+
+RecordId decodeRecordId(const char* bytes) {
+  RecordId record_id;
+  std::memcpy(&record_id.page_number, bytes, sizeof(record_id.page_number));
+  std::memcpy(&record_id.slot_number, bytes + sizeof(record_id.page_number),
+              sizeof(record_id.slot_number));
+  return record_id;
+}
+
+// size of the home record id in front of a moved copy
+const std::size_t HOME_SIZE = sizeof(PageId) + sizeof(SlotId);
+
+}  // namespace
+
 Page::Page() {
   initialize();
 }
@@ -27,6 +55,7 @@ void Page::initialize() {
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
+  header_.lsn = 0;
   data_.assign(DATA_SIZE, char());
 }
 
@@ -40,9 +69,25 @@ RecordId Page::insertRecord(const std::string& record_data) {
   return {page_number(), slot_number};
 }
 
+RecordId Page::insertMovedRecord(const std::string& record_data,
+                                 const RecordId& home) {
+  if (!hasSpaceForMovedRecord(record_data)) {
+    throw InsufficientSpaceException(
+        page_number(), record_data.length() + HOME_SIZE, getFreeSpace());
+  }
+  const SlotId slot_number = getAvailableSlot();
+  insertRecordInSlot(slot_number, encodeRecordId(home) + record_data);
+  getSlot(slot_number)->moved = true;
+  return {page_number(), slot_number};
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
+  if (slot.moved) {
+    return data_.substr(slot.item_offset + HOME_SIZE,
+                        slot.item_length - HOME_SIZE);
+  }
   return data_.substr(slot.item_offset, slot.item_length);
 }
 
@@ -50,28 +95,63 @@ void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
   const PageSlot* slot = getSlot(record_id.slot_number);
+  const bool moved = slot->moved;
+  const std::string stored =
+      moved ? data_.substr(slot->item_offset, HOME_SIZE) + record_data
+            : record_data;
   const std::size_t free_space_after_delete =
-      getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
+      getFreeSpace() + recordSpace(slot->item_length);
+  if (recordSpace(stored.length()) > free_space_after_delete) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), free_space_after_delete);
+        page_number(), stored.length(), free_space_after_delete);
   }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  insertRecordInSlot(record_id.slot_number, stored);
+  getSlot(record_id.slot_number)->moved = moved;
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
   deleteRecord(record_id, true /* allow_slot_compaction */);
 }
 
+void Page::forwardRecord(const RecordId& record_id,
+                         const RecordId& new_location) {
+  validateRecordId(record_id);
+  // the record takes at least MIN_RECORD_SPACE, so the stub always fits
+  deleteRecord(record_id, false /* allow_slot_compaction */);
+  insertRecordInSlot(record_id.slot_number, encodeRecordId(new_location));
+  getSlot(record_id.slot_number)->forwarded = true;
+}
+
+bool Page::isForwarded(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return getSlot(record_id.slot_number).forwarded;
+}
+
+RecordId Page::getForwardingAddress(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return decodeRecordId(&data_[getSlot(record_id.slot_number).item_offset]);
+}
+
+bool Page::isMoved(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return getSlot(record_id.slot_number).moved;
+}
+
+RecordId Page::getHomeAddress(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return decodeRecordId(&data_[getSlot(record_id.slot_number).item_offset]);
+}
+
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  const std::size_t space = recordSpace(slot->item_length);
+  data_.replace(slot->item_offset, space, space, '\0');
 
   // Compact the data by removing the hole left by this record (if necessary).
   std::uint16_t move_offset = slot->item_offset; 
@@ -82,21 +162,25 @@ void Page::deleteRecord(const RecordId& record_id,
       if (other_slot->item_offset < move_offset) {
         move_offset = other_slot->item_offset;
       }
-      move_bytes += other_slot->item_length;
+      move_bytes += recordSpace(other_slot->item_length);
       // Update the slot for the other data to reflect the soon-to-be-new
       // location.
-      other_slot->item_offset += slot->item_length;
+      other_slot->item_offset += space;
     }
   }
-  // If we have data to move, shift it to the right.
+  // If we have data to move, shift it to the right, and clear the bytes it
+  // leaves behind: the slot array may grow into them later.
   if (move_bytes > 0) {
     const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+    data_.replace(move_offset + space, move_bytes, data_to_move);
+    data_.replace(move_offset, space, space, '\0');
   }
-  header_.free_space_upper_bound += slot->item_length;
+  header_.free_space_upper_bound += space;
 
   // Mark slot as unused.
   slot->used = false;
+  slot->forwarded = false;
+  slot->moved = false;
   slot->item_offset = 0;
   slot->item_length = 0;
   ++header_.num_free_slots;
@@ -123,7 +207,15 @@ void Page::deleteRecord(const RecordId& record_id,
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
+  return hasSpaceFor(record_data.length());
+}
+
+bool Page::hasSpaceForMovedRecord(const std::string& record_data) const {
+  return hasSpaceFor(record_data.length() + HOME_SIZE);
+}
+
+bool Page::hasSpaceFor(const std::size_t length) const {
+  std::size_t record_size = recordSpace(length);
   if (header_.num_free_slots == 0) {
     record_size += sizeof(PageSlot);
   }
@@ -176,8 +268,11 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   }
   const int record_length = record_data.length();
   slot->used = true;
+  slot->forwarded = false;
+  slot->moved = false;
   slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
+  slot->item_offset =
+      header_.free_space_upper_bound - recordSpace(record_length);
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
   data_.replace(slot->item_offset, slot->item_length, record_data);
@@ -57,6 +57,11 @@ namespace badgerdb {
          */
         PageId next_page_number;
 
+        /**
+         * LSN of the last logged change applied to the page.
+         */
+        Lsn lsn;
+
         /**
          * Returns true if this page header is equal to the other.
          *
@@ -81,6 +86,19 @@ namespace badgerdb {
          */
         bool used;
 
+        /**
+         * Whether the slot holds a forwarding stub (the ID of the record's new
+         * location) instead of record data.
+         */
+        bool forwarded : 1;
+
+        /**
+         * Whether the slot holds the moved copy of a record, whose data is
+         * prefixed with the ID of the record's home slot (the slot holding the
+         * forwarding stub).
+         */
+        bool moved : 1;
+
         /**
          * Offset of the data item in the page.
          */
@@ -127,6 +145,25 @@ namespace badgerdb {
          */
         static const SlotId INVALID_SLOT = 0;
 
+        /**
+         * Space taken by a record of any shorter length: the size of a
+         * forwarding stub, so that every record can be replaced by a stub in
+         * place, however full the page.
+         */
+        static const std::size_t MIN_RECORD_SPACE =
+            sizeof(PageId) + sizeof(SlotId);
+
+        /**
+         * Returns the space a record of the given length takes in the data
+         * area of a page, not counting its slot.
+         *
+         * @param length  Length of the record in bytes.
+         * @return  Space taken in bytes.
+         */
+        static std::size_t recordSpace(const std::size_t length) {
+            return length < MIN_RECORD_SPACE ? MIN_RECORD_SPACE : length;
+        }
+
         /**
          * Constructs a new, uninitialized page.
          */
@@ -140,6 +177,18 @@ namespace badgerdb {
          */
         RecordId insertRecord(const std::string &record_data);
 
+        /**
+         * Inserts the moved copy of a record, which remembers the ID of its
+         * home slot.  The copy reads like any other record; deleting it is
+         * expected to delete the forwarding stub at home as well.
+         *
+         * @param record_data  Bytes that compose the record.
+         * @param home         ID of the slot holding the forwarding stub.
+         * @return  ID of the newly inserted copy.
+         */
+        RecordId insertMovedRecord(const std::string &record_data,
+                                   const RecordId &home);
+
         /**
          * Returns the record with the given ID.  Returned data is a copy of what is
          * stored on the page; use updateRecord to change it.
@@ -153,7 +202,8 @@ namespace badgerdb {
         /**
          * Updates the record with the given ID, replacing its data with a new
          * version.  This is equivalent to deleting the old record and inserting a
-         * new one, with the exception that the record ID will not change.
+         * new one, with the exception that the record ID will not change.  A
+         * moved copy stays a moved copy with the same home.
          *
          * @param record_id   ID of record to update.
          * @param record_data Updated bytes that compose the record.
@@ -169,6 +219,50 @@ namespace badgerdb {
          */
         void deleteRecord(const RecordId &record_id);
 
+        /**
+         * Replaces the record with the given ID by a forwarding stub holding the
+         * ID of the record's new location, so that the old ID stays valid after
+         * the record is moved to another page.  Stubs are skipped when iterating
+         * over the page.
+         *
+         * @param record_id     ID of the record which has been moved.
+         * @param new_location  ID of the record at its new location.
+         */
+        void forwardRecord(const RecordId &record_id, const RecordId &new_location);
+
+        /**
+         * Returns true if the slot of the given record holds a forwarding stub.
+         *
+         * @param record_id   ID of the record.
+         * @return  Whether the record has been moved.
+         */
+        bool isForwarded(const RecordId &record_id) const;
+
+        /**
+         * Returns the new location of a moved record.
+         *
+         * @param record_id   ID of a record holding a forwarding stub.
+         * @return  ID of the record at its new location.
+         */
+        RecordId getForwardingAddress(const RecordId &record_id) const;
+
+        /**
+         * Returns true if the slot of the given record holds the moved copy of
+         * a record.
+         *
+         * @param record_id   ID of the record.
+         * @return  Whether the record is a moved copy.
+         */
+        bool isMoved(const RecordId &record_id) const;
+
+        /**
+         * Returns the home slot of a moved copy.
+         *
+         * @param record_id   ID of a moved copy.
+         * @return  ID of the slot holding the forwarding stub to the copy.
+         */
+        RecordId getHomeAddress(const RecordId &record_id) const;
+
         /**
          * Returns true if the page has enough free space to hold the given data.
          *
@@ -177,6 +271,15 @@ namespace badgerdb {
          */
         bool hasSpaceForRecord(const std::string &record_data) const;
 
+        /**
+         * Returns true if the page has enough free space to hold the given data
+         * as a moved copy.
+         *
+         * @param record_data Bytes that compose the record.
+         * @return  Whether the page can hold the moved copy.
+         */
+        bool hasSpaceForMovedRecord(const std::string &record_data) const;
+
         /**
          * Returns this page's free space in bytes.
          *
@@ -187,6 +290,14 @@ namespace badgerdb {
                    header_.free_space_lower_bound;
         }
 
+        /**
+         * Returns the number of slots in the slot array, including unused ones.
+         * Record IDs of this page have slot numbers from 1 up to this number.
+         *
+         * @return  Number of slots.
+         */
+        SlotId num_slots() const { return header_.num_slots; }
+
         /**
          * Returns this page's number in its file.
          *
@@ -201,6 +312,13 @@ namespace badgerdb {
          */
         PageId next_page_number() const { return header_.next_page_number; }
 
+        /**
+         * Returns the LSN of the last logged change applied to this page.
+         *
+         * @return  Page LSN.
+         */
+        Lsn lsn() const { return header_.lsn; }
+
         /**
          * Returns an iterator at the first record in the page.
          *
@@ -240,6 +358,13 @@ namespace badgerdb {
             header_.next_page_number = new_next_page_number;
         }
 
+        /**
+         * Sets the LSN of the last logged change applied to this page.
+         *
+         * @param new_lsn   Page LSN.
+         */
+        void set_lsn(const Lsn new_lsn) { header_.lsn = new_lsn; }
+
         /**
          * Deletes the record with the given ID.  Page is compacted upon delete to
          * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -305,6 +430,15 @@ namespace badgerdb {
         void insertRecordInSlot(const SlotId slot_number,
                                 const std::string &record_data);
 
+        /**
+         * Returns true if the page has enough free space for a new record of
+         * the given stored length, including a slot if none is free.
+         *
+         * @param length  Stored length of the record in bytes.
+         * @return  Whether the page can hold the record.
+         */
+        bool hasSpaceFor(const std::size_t length) const;
+
         /**
          * Throws an exception if the given record ID is not valid for this page
          * (i.e., it has the right page number and the slot it references is in use).
@@ -341,6 +475,10 @@ namespace badgerdb {
         friend class PageTest;
 
         friend class BufferTest;
+
+        friend class BufMgr;
+
+        friend class LogManager;
     };
 
     static_assert(Page::SIZE > sizeof(PageHeader),
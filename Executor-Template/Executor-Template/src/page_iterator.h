@@ -101,9 +101,20 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns the ID of the current record.
+   *
+   * @return  ID of the record the iterator points to.
+   */
+  inline const RecordId& record_id() const {
+    return current_record_;
+  }
+
   /**
    * Returns the next used slot in the page after the given slot or
-   * Page::INVALID_SLOT if no slots are used after the given slot.
+   * Page::INVALID_SLOT if no slots are used after the given slot.  Slots
+   * holding forwarding stubs are skipped; the moved record is visited at its
+   * new location, under the record id of the copy.
    *
    * @param start   Slot to start search at.
    * @return  Next used slot after given slot or Page::INVALID_SLOT.
@@ -112,7 +123,7 @@ class PageIterator {
     SlotId slot_number = Page::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
-      if (slot->used) {
+      if (slot->used && !slot->forwarded) {
         slot_number = i;
         break;
       }
@@ -0,0 +1,129 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_reader.h"
+
+#include <cassert>
+#include <utility>
+
+#include "file_iterator.h"
+
+namespace badgerdb {
+
+PageReader::PageReader(BufMgr* bufMgr, const std::string& owner,
+                       const bool background)
+    : bufMgr(bufMgr),
+      owner(owner),
+      background(background),
+      numStarted(0),
+      stopping(false) {
+  if (background) {
+    worker = std::thread(&PageReader::run, this);
+  }
+}
+
+PageReader::~PageReader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  // the pages read but not taken are unpinned with their requests
+}
+
+void PageReader::request(File* file, const std::size_t position) {
+  Request request;
+  request.file = file;
+  request.position = position;
+  request.done = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.push_back(std::move(request));
+  }
+  changed.notify_all();
+}
+
+PageGuard PageReader::take(const LatchMode mode) {
+  Request request;
+  if (background) {
+    std::unique_lock<std::mutex> lock(mutex);
+    assert(!requests.empty());
+    while (!requests.front().done) {
+      changed.wait(lock);
+    }
+    request = std::move(requests.front());
+    requests.pop_front();
+    --numStarted;
+  } else {
+    assert(!requests.empty());
+    request = std::move(requests.front());
+    requests.pop_front();
+    read(request);
+  }
+  if (request.error) {
+    std::rethrow_exception(request.error);
+  }
+  request.page.acquireLatch(mode);
+  return std::move(request.page);
+}
+
+void PageReader::read(Request& request) {
+  try {
+    PageList& list = lists[request.file];
+    if (list.pages.empty() && !list.complete) {
+      const PageId first = request.file->begin().page_number();
+      list.complete = first == Page::INVALID_NUMBER;
+      if (!list.complete) {
+        list.pages.push_back(first);
+      }
+    }
+    if (request.position >= list.pages.size()) {
+      return;
+    }
+    const PageId pageNo = list.pages[request.position];
+    request.page = bufMgr->fetch(request.file, pageNo);
+    if (request.position + 1 == list.pages.size() && !list.complete) {
+      // the links are kept current in the page headers on disk, not in the
+      // buffered pages; a list longer than the file header says is cut
+      FileIterator next(request.file, pageNo);
+      ++next;
+      list.complete = next.page_number() == Page::INVALID_NUMBER ||
+                      list.pages.size() >= request.file->getNumUsedPages();
+      if (!list.complete) {
+        list.pages.push_back(next.page_number());
+      }
+    }
+  } catch (...) {
+    request.page.release();
+    request.error = std::current_exception();
+  }
+}
+
+void PageReader::run() {
+  BufPinScope pinScope(bufMgr, owner);
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    while (!stopping && numStarted == requests.size()) {
+      changed.wait(lock);
+    }
+    if (stopping) {
+      return;
+    }
+    // the request stays in place until it is taken, which waits for it
+    Request& request = requests[numStarted++];
+    lock.unlock();
+    read(request);
+    lock.lock();
+    request.done = true;
+    changed.notify_all();
+  }
+}
+
+}  // namespace badgerdb
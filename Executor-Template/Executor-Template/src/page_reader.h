@@ -0,0 +1,163 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Reads the pages of files ahead of their use on a thread of its own.
+ *
+ * The caller asks for pages by their position among the used pages of a
+ * file, and takes them in the order asked for.  The thread only pins the
+ * pages; the caller latches a page once it takes it, so that each latch is
+ * held by the thread which reads the page.  The used pages of a file are
+ * listed once, by following the links in the page headers on disk, and the
+ * list serves every later scan of the file; the number of used pages comes
+ * from the file header, so the caller knows where a scan ends without
+ * reading a page.
+ *
+ * Without the thread the pages are read when they are taken, in the same
+ * order, so that results do not depend on read-ahead.
+ *
+ * @warning The requests and takes of one reader must come from one thread.
+ */
+class PageReader {
+ public:
+  /**
+   * Constructor
+   *
+   * @param bufMgr      Buffer manager through which the pages are read.
+   * @param owner       Owner against which the pins are recorded.
+   * @param background  Read the pages on a thread of their own.
+   */
+  PageReader(BufMgr* bufMgr, const std::string& owner, bool background);
+
+  /**
+   * Destructor that stops the thread and unpins the pages not taken
+   */
+  ~PageReader();
+
+  PageReader(const PageReader&) = delete;
+  PageReader& operator=(const PageReader&) = delete;
+
+  /**
+   * Asks for a page.  The first scan of a file must ask for its pages in
+   * order, as their numbers are found by reading the pages before them.
+   *
+   * @param file      File of the page; must live until the page is taken.
+   * @param position  Position of the page among the used pages of the file.
+   */
+  void request(File* file, std::size_t position);
+
+  /**
+   * Takes the page asked for first among those not taken yet, waiting for it
+   * to be read.
+   *
+   * @param mode  How the page is latched until the guard releases it.
+   * @return  Guard holding the page, empty if the file has no page at the
+   *          position asked for
+   * @throws  The exception which reading the page threw
+   */
+  PageGuard take(LatchMode mode);
+
+ private:
+  /**
+   * A page asked for, and once read, the page or what went wrong
+   */
+  struct Request {
+    File* file;
+    std::size_t position;
+    bool done;
+    PageGuard page;
+    std::exception_ptr error;
+  };
+
+  /**
+   * Used pages of a file found so far, in the order of the page list
+   */
+  struct PageList {
+    std::vector<PageId> pages;
+    bool complete;
+  };
+
+  /**
+   * Reads the page of a request
+   */
+  void read(Request& request);
+
+  /**
+   * Reads the requests one after another until stopped
+   */
+  void run();
+
+  /**
+   * Buffer manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Owner of the pins
+   */
+  std::string owner;
+
+  /**
+   * Are the pages read on the thread?
+   */
+  bool background;
+
+  /**
+   * Pages asked for and not taken yet, in the order asked for
+   */
+  std::deque<Request> requests;
+
+  /**
+   * Number of requests at the front of the queue already read or being read
+   * by the thread
+   */
+  std::size_t numStarted;
+
+  /**
+   * Page lists of the files, kept by whoever reads the pages
+   */
+  std::map<File*, PageList> lists;
+
+  /**
+   * Guards the requests and the stop flag
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when a request is added, read, or the thread is stopped
+   */
+  std::condition_variable changed;
+
+  /**
+   * Is the thread to stop?
+   */
+  bool stopping;
+
+  /**
+   * Thread reading the pages
+   */
+  std::thread worker;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "partition.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "exceptions/partition_exception.h"
+
+namespace badgerdb {
+
+// offset and length of the value of an attribute in a tuple
+static void attrSpan(const string& tuple,
+                     const TableSchema& tableSchema,
+                     const int attrNum,
+                     size_t& offset,
+                     size_t& length) {
+  offset = 0;
+  for (int i = 0; i <= attrNum; ++i) {
+    switch (tableSchema.getAttrType(i)) {
+      case INT: {
+        length = 4;
+        if (i < attrNum) {
+          offset += 4;
+        }
+        break;
+      }
+      case CHAR: {
+        const size_t max_len = tableSchema.getAttrMaxSize(i);
+        length = max_len;
+        if (i < attrNum) {
+          offset += max_len + (4 - (max_len % 4)) % 4;
+        }
+        break;
+      }
+      case VARCHAR: {
+        const size_t actual_len =
+            offset < tuple.size()
+                ? static_cast<unsigned char>(tuple[offset])
+                : 0;
+        length = actual_len;
+        if (i < attrNum) {
+          offset += 1 + actual_len + (4 - ((actual_len + 1) % 4)) % 4;
+        } else {
+          ++offset;  // skip the length byte
+        }
+        break;
+      }
+    }
+  }
+  if (offset > tuple.size()) {
+    offset = tuple.size();
+  }
+  length = std::min(length, tuple.size() - offset);
+}
+
+PartitionScheme PartitionScheme::byRange(const string& attrName,
+                                         const vector<int>& bounds) {
+  return PartitionScheme(PARTITION_RANGE, attrName,
+                         static_cast<int>(bounds.size()) + 1, bounds);
+}
+
+PartitionScheme PartitionScheme::byHash(const string& attrName,
+                                        const int numPartitions) {
+  return PartitionScheme(PARTITION_HASH, attrName, numPartitions,
+                         vector<int>());
+}
+
+void PartitionScheme::validate(const TableSchema& tableSchema) const {
+  const string& table = tableSchema.getTableName();
+  const int attrNum = tableSchema.getAttrNum(attrName);
+  if (attrNum < 0) {
+    throw PartitionException(table, "no attribute " + attrName);
+  }
+  if (numPartitions < 1) {
+    throw PartitionException(table, "no partitions");
+  }
+  if (method == PARTITION_RANGE) {
+    if (tableSchema.getAttrType(attrNum) != INT) {
+      throw PartitionException(table, "range key " + attrName +
+                                          " is not an INT attribute");
+    }
+    for (size_t i = 1; i < bounds.size(); ++i) {
+      if (bounds[i - 1] >= bounds[i]) {
+        throw PartitionException(table, "range bounds are not increasing");
+      }
+    }
+  }
+}
+
+int PartitionScheme::partitionOf(const string& tuple,
+                                 const TableSchema& tableSchema) const {
+  const int attrNum = tableSchema.getAttrNum(attrName);
+  if (method == PARTITION_RANGE) {
+    return partitionOfKey(getIntAttr(tuple, tableSchema, attrNum));
+  }
+  size_t offset, length;
+  attrSpan(tuple, tableSchema, attrNum, offset, length);
+  return partitionOfBytes(tuple.data() + offset, length);
+}
+
+int PartitionScheme::partitionOfKey(const int key) const {
+  if (method == PARTITION_RANGE) {
+    // the first bound above the key ends its partition
+    return static_cast<int>(
+        std::upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin());
+  }
+  // hash the key the way it is stored in a tuple
+  const std::uint32_t value = static_cast<std::uint32_t>(key);
+  const char bytes[4] = {static_cast<char>(value >> 24),
+                         static_cast<char>(value >> 16),
+                         static_cast<char>(value >> 8),
+                         static_cast<char>(value)};
+  return partitionOfBytes(bytes, sizeof(bytes));
+}
+
+vector<int> PartitionScheme::prune(const KeyRange& range) const {
+  vector<int> partitions;
+  if (range.low > range.high) {
+    return partitions;
+  }
+  if (method == PARTITION_RANGE) {
+    const int first = partitionOfKey(range.low);
+    const int last = partitionOfKey(range.high);
+    for (int i = first; i <= last; ++i) {
+      partitions.push_back(i);
+    }
+  } else if (range.low == range.high) {
+    partitions.push_back(partitionOfKey(range.low));
+  } else {
+    // hashing keeps no order, so only a single key narrows the partitions
+    for (int i = 0; i < numPartitions; ++i) {
+      partitions.push_back(i);
+    }
+  }
+  return partitions;
+}
+
+bool PartitionScheme::isCovered(const int partition,
+                                const KeyRange& range) const {
+  if (range.isAll()) {
+    return true;
+  }
+  if (method == PARTITION_HASH) {
+    return false;
+  }
+  // keys of the partition are [bounds[partition - 1], bounds[partition])
+  const bool low_covered =
+      partition == 0 ? range.low == INT_MIN
+                     : range.low <= bounds[partition - 1];
+  const bool high_covered =
+      partition == numPartitions - 1
+          ? range.high == INT_MAX
+          : static_cast<long long>(range.high) >=
+                static_cast<long long>(bounds[partition]) - 1;
+  return low_covered && high_covered;
+}
+
+int PartitionScheme::getIntAttr(const string& tuple,
+                                const TableSchema& tableSchema,
+                                const int attrNum) {
+  size_t offset, length;
+  attrSpan(tuple, tableSchema, attrNum, offset, length);
+  if (length < 4) {
+    return 0;
+  }
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(tuple.data() + offset);
+  return static_cast<std::int32_t>(
+      (static_cast<std::uint32_t>(bytes[0]) << 24) |
+      (static_cast<std::uint32_t>(bytes[1]) << 16) |
+      (static_cast<std::uint32_t>(bytes[2]) << 8) |
+      static_cast<std::uint32_t>(bytes[3]));
+}
+
+int PartitionScheme::partitionOfBytes(const char* data,
+                                      const std::size_t length) const {
+  // FNV-1a, fixed so that tuples stay in their partition across runs
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return static_cast<int>(hash % static_cast<std::uint32_t>(numPartitions));
+}
+
+}  // namespace badgerdb
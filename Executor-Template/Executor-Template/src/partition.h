@@ -0,0 +1,223 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "schema.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Inclusive range of INT key values, the predicate used to prune
+ * partitions.
+ */
+struct KeyRange {
+  /**
+   * Lowest key in the range
+   */
+  int low;
+
+  /**
+   * Highest key in the range
+   */
+  int high;
+
+  /**
+   * Range of every key
+   */
+  static KeyRange all() { return between(INT_MIN, INT_MAX); }
+
+  /**
+   * Range of a single key
+   */
+  static KeyRange point(const int key) { return between(key, key); }
+
+  /**
+   * Range of the keys from low to high, both included
+   */
+  static KeyRange between(const int low, const int high) {
+    KeyRange range;
+    range.low = low;
+    range.high = high;
+    return range;
+  }
+
+  /**
+   * Is the key in the range?
+   */
+  bool contains(const int key) const { return low <= key && key <= high; }
+
+  /**
+   * Does the range hold every key?
+   */
+  bool isAll() const { return low == INT_MIN && high == INT_MAX; }
+};
+
+/**
+ * @brief How the tuples of a table are spread over its partitions
+ */
+enum PartitionMethod {
+  /**
+   * By ranges of an INT attribute
+   */
+  PARTITION_RANGE,
+
+  /**
+   * By the hash of an attribute of any type
+   */
+  PARTITION_HASH
+};
+
+/**
+ * @brief Horizontal partitioning of a table on one attribute, the partition
+ * key.
+ *
+ * Range partitioning splits the INT key values at a list of increasing
+ * bounds: partition 0 holds the keys below the first bound, partition i the
+ * keys from bound i-1 up to but excluding bound i, and the last partition the
+ * keys from the last bound on.  Hash partitioning spreads the key values over
+ * a number of partitions by a hash of their bytes, which is stable across
+ * runs as the partitions are stored on disk.
+ *
+ * Two tables partitioned the same way on their join attribute are
+ * co-partitioned: matching tuples always lie in partitions with the same
+ * number.
+ */
+class PartitionScheme {
+ public:
+  /**
+   * Range partitioning on an INT attribute
+   *
+   * @param attrName  Partition key.
+   * @param bounds    Increasing bounds between the partitions; there is one
+   *                  partition more than there are bounds.
+   */
+  static PartitionScheme byRange(const string& attrName,
+                                 const vector<int>& bounds);
+
+  /**
+   * Hash partitioning on an attribute
+   *
+   * @param attrName       Partition key.
+   * @param numPartitions  Number of partitions.
+   */
+  static PartitionScheme byHash(const string& attrName,
+                                const int numPartitions);
+
+  /**
+   * Get the partitioning method
+   */
+  PartitionMethod getMethod() const { return method; }
+
+  /**
+   * Get the name of the partition key
+   */
+  const string& getAttrName() const { return attrName; }
+
+  /**
+   * Get the number of partitions
+   */
+  int getPartitionCount() const { return numPartitions; }
+
+  /**
+   * Get the bounds between range partitions
+   */
+  const vector<int>& getBounds() const { return bounds; }
+
+  /**
+   * Check that the partitioning can be applied to a table
+   *
+   * @throws PartitionException If the table has no such attribute, a range
+   * key is not an INT, the bounds are not increasing or there are no
+   * partitions
+   */
+  void validate(const TableSchema& tableSchema) const;
+
+  /**
+   * Get the partition of a tuple of the given table
+   */
+  int partitionOf(const string& tuple, const TableSchema& tableSchema) const;
+
+  /**
+   * Get the partition of an INT key value
+   */
+  int partitionOfKey(const int key) const;
+
+  /**
+   * Get the partitions which may hold keys in the range, in increasing order
+   */
+  vector<int> prune(const KeyRange& range) const;
+
+  /**
+   * Are all keys of the partition in the range?  If not, the tuples of the
+   * partition have to be filtered.
+   */
+  bool isCovered(const int partition, const KeyRange& range) const;
+
+  /**
+   * Does a key value always fall into the partition with the same number
+   * under both partitionings?
+   */
+  bool isCompatibleWith(const PartitionScheme& other) const {
+    return method == other.method && numPartitions == other.numPartitions &&
+           bounds == other.bounds;
+  }
+
+  /**
+   * Get the value of an INT attribute of a tuple
+   */
+  static int getIntAttr(const string& tuple,
+                        const TableSchema& tableSchema,
+                        const int attrNum);
+
+ private:
+  /**
+   * Constructor
+   */
+  PartitionScheme(const PartitionMethod method,
+                  const string& attrName,
+                  const int numPartitions,
+                  const vector<int>& bounds)
+      : method(method),
+        attrName(attrName),
+        numPartitions(numPartitions),
+        bounds(bounds) {
+    // nothing
+  }
+
+  /**
+   * Get the partition of the bytes of a key value
+   */
+  int partitionOfBytes(const char* data, const std::size_t length) const;
+
+  /**
+   * Partitioning method
+   */
+  PartitionMethod method;
+
+  /**
+   * Partition key
+   */
+  string attrName;
+
+  /**
+   * Number of partitions
+   */
+  int numPartitions;
+
+  /**
+   * Bounds between range partitions
+   */
+  vector<int> bounds;
+};
+
+}  // namespace badgerdb
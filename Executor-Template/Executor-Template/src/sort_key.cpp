@@ -0,0 +1,104 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "sort_key.h"
+
+#include "exceptions/sort_key_exception.h"
+
+namespace badgerdb {
+
+SortKeyEncoder::SortKeyEncoder(const TableSchema& tableSchema,
+                               const std::vector<SortKey>& sortKeys)
+    : extractor(tableSchema, attrNamesOf(sortKeys)) {
+  for (std::size_t i = 0; i < sortKeys.size(); ++i) {
+    const int attrNum = tableSchema.getAttrNum(sortKeys[i].attrName);
+    types.push_back(tableSchema.getAttrType(attrNum));
+    lengths.push_back(tableSchema.getAttrType(attrNum) == CHAR
+                          ? tableSchema.getAttrMaxSize(attrNum)
+                          : 0);
+    descending.push_back(sortKeys[i].descending);
+  }
+}
+
+void SortKeyEncoder::encode(const std::string& tuple, std::string& out) const {
+  std::string values;
+  extractor.extractKey(tuple, values);
+  // the values follow each other as the extractor stores them in a key
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < types.size(); ++i) {
+    const std::size_t start = out.size();
+    switch (types[i]) {
+      case INT: {
+        out.append(values, pos, 4);
+        if (out.size() > start) {
+          out[start] = static_cast<char>(out[start] ^ 0x80);
+        }
+        pos += 4;
+        break;
+      }
+      case CHAR: {
+        out.append(values, pos, lengths[i]);
+        pos += lengths[i];
+        break;
+      }
+      case VARCHAR: {
+        const std::size_t actual_len =
+            pos < values.size() ? static_cast<unsigned char>(values[pos]) : 0;
+        out.append(values, pos + 1, actual_len);
+        out.push_back('\0');
+        pos += 1 + actual_len;
+        break;
+      }
+    }
+    if (descending[i]) {
+      for (std::size_t j = start; j < out.size(); ++j) {
+        out[j] = static_cast<char>(~out[j]);
+      }
+    }
+  }
+}
+
+void SortKeyEncoder::checkSortKeys(const TableSchema& tableSchema,
+                                   const std::vector<SortKey>& sortKeys) {
+  for (std::size_t i = 0; i < sortKeys.size(); ++i) {
+    if (!tableSchema.hasAttr(sortKeys[i].attrName)) {
+      throw SortKeyException(sortKeys[i].attrName,
+                             tableSchema.getTableName() +
+                                 " has no such attribute");
+    }
+    for (std::size_t j = 0; j < i; ++j) {
+      if (sortKeys[j].attrName == sortKeys[i].attrName) {
+        throw SortKeyException(sortKeys[i].attrName, "named twice");
+      }
+    }
+  }
+}
+
+std::string SortKeyEncoder::toString(const std::vector<SortKey>& sortKeys) {
+  std::string text;
+  for (std::size_t i = 0; i < sortKeys.size(); ++i) {
+    if (i > 0) {
+      text += ", ";
+    }
+    text += sortKeys[i].attrName;
+    if (sortKeys[i].descending) {
+      text += " DESC";
+    }
+  }
+  return text;
+}
+
+std::vector<std::string> SortKeyEncoder::attrNamesOf(
+    const std::vector<SortKey>& sortKeys) {
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < sortKeys.size(); ++i) {
+    names.push_back(sortKeys[i].attrName);
+  }
+  return names;
+}
+
+}  // namespace badgerdb
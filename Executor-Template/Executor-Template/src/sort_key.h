@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "join_key.h"
+#include "schema.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Attribute of an ORDER BY clause.
+ */
+struct SortKey {
+  /**
+   * Name of the attribute
+   */
+  std::string attrName;
+
+  /**
+   * Do larger values come first?
+   */
+  bool descending;
+
+  /**
+   * Order by the attribute, smallest value first
+   */
+  static SortKey asc(const std::string& attrName) {
+    SortKey key;
+    key.attrName = attrName;
+    key.descending = false;
+    return key;
+  }
+
+  /**
+   * Order by the attribute, largest value first
+   */
+  static SortKey desc(const std::string& attrName) {
+    SortKey key = asc(attrName);
+    key.descending = true;
+    return key;
+  }
+};
+
+/**
+ * @brief Encodes the ORDER BY attributes of a tuple into a string whose byte
+ * order is the order of the tuples.
+ *
+ * Tuples are then ordered by comparing their encodings, without decoding
+ * attributes for every comparison.  An INT is stored big-endian with its sign
+ * bit flipped, a CHAR(n) as its n bytes, and a VARCHAR as its characters
+ * followed by a zero byte, so that a prefix comes first.  The bytes of a
+ * descending attribute are inverted.  Encoding keeps no state in the
+ * encoder, so threads may share one.
+ */
+class SortKeyEncoder {
+ public:
+  /**
+   * Constructor
+   *
+   * @param tableSchema  Schema of the tuples.
+   * @param sortKeys     ORDER BY attributes, checked by checkSortKeys().
+   */
+  SortKeyEncoder(const TableSchema& tableSchema,
+                 const std::vector<SortKey>& sortKeys);
+
+  /**
+   * Append the encoding of a tuple to a string
+   */
+  void encode(const std::string& tuple, std::string& out) const;
+
+  /**
+   * Check ORDER BY attributes against a table
+   *
+   * @throws SortKeyException If an attribute is not in the table or named
+   * twice
+   */
+  static void checkSortKeys(const TableSchema& tableSchema,
+                            const std::vector<SortKey>& sortKeys);
+
+  /**
+   * Get the text of an ORDER BY clause, e.g. a, b DESC
+   */
+  static std::string toString(const std::vector<SortKey>& sortKeys);
+
+ private:
+  /**
+   * Names of the attributes, in order
+   */
+  static std::vector<std::string> attrNamesOf(
+      const std::vector<SortKey>& sortKeys);
+
+  /**
+   * Extractor of the values of the attributes
+   */
+  JoinKeyExtractor extractor;
+
+  /**
+   * Types of the attributes, in order
+   */
+  std::vector<DataType> types;
+
+  /**
+   * Lengths of the CHAR attributes, in order
+   */
+  std::vector<std::size_t> lengths;
+
+  /**
+   * Directions of the attributes, in order
+   */
+  std::vector<bool> descending;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,173 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "spill_manager.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <sstream>
+
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/spill_limit_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Sequence number of the next temporary file of this process
+ */
+std::atomic<unsigned long> nextSpillFile(0);
+
+}  // namespace
+
+SpillManager::SpillManager(BufMgr* bufMgr, const std::string& directory,
+                           const std::uint64_t maxBytes)
+    : bufMgr(bufMgr),
+      directory(directory.empty() ? "." : directory),
+      maxBytes(maxBytes),
+      spilledBytes(0),
+      peakBytes(0) {
+  // nothing
+}
+
+SpillManager::~SpillManager() {
+  removeAll();
+}
+
+File* SpillManager::create(const std::string& prefix) {
+  for (;;) {
+    std::stringstream name;
+    name << directory << '/' << prefix << '.' << ::getpid() << '.'
+         << nextSpillFile++ << ".tmp";
+    try {
+      Entry entry;
+      entry.file = new File(File::create(name.str()));
+      // spill files are gone after a crash, so their pages are never logged
+      bufMgr->setUnlogged(entry.file);
+      entries.push_back(entry);
+      return entry.file;
+    } catch (FileExistsException& e) {
+      // left behind by an earlier process with the same id; try the next name
+    }
+  }
+}
+
+void SpillManager::remove(File* file) {
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i].file == file) {
+      discard(entries[i]);
+      entries.erase(entries.begin() + i);
+      return;
+    }
+  }
+}
+
+void SpillManager::removeAll() {
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const std::string name = entries[i].file->filename();
+    try {
+      discard(entries[i]);
+    } catch (...) {
+      // still pinned: unlink the file anyway, the frames go on eviction
+      delete entries[i].file;
+      std::remove(name.c_str());
+    }
+  }
+  entries.clear();
+  spilledBytes = 0;
+}
+
+std::size_t SpillManager::getNumPages(const File* file) const {
+  const Entry* entry = entryFor(file);
+  return entry != NULL ? entry->pages.size() : 0;
+}
+
+SpillManager::Entry* SpillManager::entryFor(const File* file) {
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i].file == file) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+const SpillManager::Entry* SpillManager::entryFor(const File* file) const {
+  return const_cast<SpillManager*>(this)->entryFor(file);
+}
+
+PageGuard SpillManager::appendPage(File* file) {
+  Entry* entry = entryFor(file);
+  assert(entry != NULL);
+  if (maxBytes > 0 && spilledBytes + Page::SIZE > maxBytes) {
+    throw SpillLimitException(spilledBytes + Page::SIZE, maxBytes);
+  }
+  PageGuard page = bufMgr->fetchNew(file);
+  entry->pages.push_back(page.pageNumber());
+  spilledBytes += Page::SIZE;
+  if (spilledBytes > peakBytes) {
+    peakBytes = spilledBytes;
+  }
+  return page;
+}
+
+void SpillManager::discard(Entry& entry) {
+  const std::string name = entry.file->filename();
+  // the pages are never needed again, so they are dropped without a write
+  bufMgr->discardFile(entry.file);
+  delete entry.file;
+  entry.file = NULL;
+  File::remove(name);
+  spilledBytes -= entry.pages.size() * Page::SIZE;
+}
+
+SpillWriter::SpillWriter(SpillManager* spill, File* file)
+    : spill(spill), file(file), numRecords(0), numPages(0) {
+  // nothing
+}
+
+void SpillWriter::append(const std::string& record) {
+  if (!page.isPinned() || !page.read().hasSpaceForRecord(record)) {
+    page.release();
+    page = spill->appendPage(file);
+    ++numPages;
+  }
+  page.write().insertRecord(record);
+  ++numRecords;
+}
+
+SpillReader::SpillReader(SpillManager* spill, File* file)
+    : spill(spill), file(file), nextPage(0), numPagesRead(0) {
+  // nothing
+}
+
+bool SpillReader::next(std::string& record_data) {
+  while (!page.isPinned() || record == page.read().end()) {
+    page.release();
+    const SpillManager::Entry* entry = spill->entryFor(file);
+    assert(entry != NULL);
+    if (nextPage >= entry->pages.size()) {
+      return false;
+    }
+    page = spill->bufMgr->fetch(file, entry->pages[nextPage++]);
+    ++numPagesRead;
+    record = page.read().begin();
+  }
+  record_data = *record;
+  ++record;
+  return true;
+}
+
+void SpillReader::seek(std::size_t pageIndex) {
+  page.release();
+  nextPage = pageIndex;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,329 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Temporary files (sorted runs, hash partitions) created by one
+ * operator.
+ *
+ * Every file gets a unique name in the scratch directory, so operators running
+ * side by side never collide.  The files are read and written through the
+ * buffer pool and are removed, without writing back their pages, when the
+ * operator removes them or when the manager is destroyed; keeping the manager
+ * on the stack of the operator therefore cleans up even if the operator
+ * throws.  The pages of all live files are charged against a spill limit.
+ *
+ * Writers and readers of a file must be destroyed before the file is removed.
+ *
+ * @warning This class is not threadsafe.
+ */
+class SpillManager {
+ public:
+  /**
+   * Constructor
+   *
+   * @param bufMgr     Buffer manager through which the files are accessed.
+   * @param directory  Scratch directory holding the files.
+   * @param maxBytes   Spill limit in bytes, zero for no limit.
+   */
+  explicit SpillManager(BufMgr* bufMgr,
+                        const std::string& directory = ".",
+                        const std::uint64_t maxBytes = 0);
+
+  /**
+   * Destructor that removes every file still live.
+   */
+  ~SpillManager();
+
+  SpillManager(const SpillManager&) = delete;
+  SpillManager& operator=(const SpillManager&) = delete;
+
+  /**
+   * Creates an empty temporary file.
+   *
+   * @param prefix  Start of the file name, naming its purpose (e.g. "run").
+   * @return  The file, valid until it is removed.
+   */
+  File* create(const std::string& prefix);
+
+  /**
+   * Removes a temporary file, dropping its pages from the buffer pool.  Does
+   * nothing for a file which is not a live file of this manager.
+   *
+   * @throws PagePinnedException If a page of the file is still pinned.
+   */
+  void remove(File* file);
+
+  /**
+   * Removes every temporary file.  Never throws: a file whose pages are still
+   * pinned is unlinked all the same and its pages are left to be evicted.
+   */
+  void removeAll();
+
+  /**
+   * Get the scratch directory
+   */
+  const std::string& getDirectory() const { return directory; }
+
+  /**
+   * Get the spill limit in bytes, zero for no limit
+   */
+  std::uint64_t getMaxBytes() const { return maxBytes; }
+
+  /**
+   * Get the bytes held by the live files
+   */
+  std::uint64_t getSpilledBytes() const { return spilledBytes; }
+
+  /**
+   * Get the bytes held by the live files at the high-water mark
+   */
+  std::uint64_t getPeakBytes() const { return peakBytes; }
+
+  /**
+   * Get the number of live files
+   */
+  std::size_t getNumFiles() const { return entries.size(); }
+
+  /**
+   * Get the number of pages written to a file
+   */
+  std::size_t getNumPages(const File* file) const;
+
+ private:
+  friend class SpillWriter;
+  friend class SpillReader;
+
+  /**
+   * A live temporary file
+   */
+  struct Entry {
+    /**
+     * The file
+     */
+    File* file;
+
+    /**
+     * Pages of the file in the order they were written
+     */
+    std::vector<PageId> pages;
+  };
+
+  /**
+   * Entry of a live file, NULL if the file is not a live file of this
+   * manager
+   */
+  Entry* entryFor(const File* file);
+  const Entry* entryFor(const File* file) const;
+
+  /**
+   * Allocates the next page of a file, charging it against the spill limit.
+   *
+   * @throws SpillLimitException If the limit would be exceeded
+   */
+  PageGuard appendPage(File* file);
+
+  /**
+   * Drops a file from the buffer pool and the disk.
+   */
+  void discard(Entry& entry);
+
+  /**
+   * Buffer manager
+   */
+  BufMgr* bufMgr;
+
+  /**
+   * Scratch directory
+   */
+  std::string directory;
+
+  /**
+   * Spill limit in bytes, zero for no limit
+   */
+  std::uint64_t maxBytes;
+
+  /**
+   * Bytes held by the live files
+   */
+  std::uint64_t spilledBytes;
+
+  /**
+   * Highest value of spilledBytes so far
+   */
+  std::uint64_t peakBytes;
+
+  /**
+   * Live files
+   */
+  std::vector<Entry> entries;
+};
+
+/**
+ * @brief Appends records to a temporary file, one pinned page at a time.
+ */
+class SpillWriter {
+ public:
+  /**
+   * Constructor
+   *
+   * @param spill  Manager owning the file.
+   * @param file   File to append to.
+   */
+  SpillWriter(SpillManager* spill, File* file);
+
+  /**
+   * Destructor that unpins the last page.
+   */
+  ~SpillWriter() { close(); }
+
+  SpillWriter(const SpillWriter&) = delete;
+  SpillWriter& operator=(const SpillWriter&) = delete;
+
+  /**
+   * Appends a record after the ones written so far.
+   *
+   * @throws SpillLimitException If a new page would exceed the spill limit
+   * @throws InsufficientSpaceException If the record does not fit in a page
+   */
+  void append(const std::string& record);
+
+  /**
+   * Unpins the last page.  Records appended afterwards start a new page.
+   */
+  void close() { page.release(); }
+
+  /**
+   * Get the file written to
+   */
+  File* getFile() const { return file; }
+
+  /**
+   * Get the number of records appended by this writer
+   */
+  std::size_t getNumRecords() const { return numRecords; }
+
+  /**
+   * Get the number of pages started by this writer
+   */
+  std::size_t getNumPages() const { return numPages; }
+
+ private:
+  /**
+   * Manager owning the file
+   */
+  SpillManager* spill;
+
+  /**
+   * File written to
+   */
+  File* file;
+
+  /**
+   * Page being filled, unpinned when full
+   */
+  PageGuard page;
+
+  /**
+   * Number of records appended
+   */
+  std::size_t numRecords;
+
+  /**
+   * Number of pages started
+   */
+  std::size_t numPages;
+};
+
+/**
+ * @brief Reads the records of a temporary file back in the order they were
+ * appended, one pinned page at a time.
+ */
+class SpillReader {
+ public:
+  /**
+   * Constructor
+   *
+   * @param spill  Manager owning the file.
+   * @param file   File to read.
+   */
+  SpillReader(SpillManager* spill, File* file);
+
+  SpillReader(const SpillReader&) = delete;
+  SpillReader& operator=(const SpillReader&) = delete;
+
+  /**
+   * Reads the next record.
+   *
+   * @param record  Receives the record.
+   * @return  False once every record has been read
+   */
+  bool next(std::string& record);
+
+  /**
+   * Continues reading at the first record of a page.
+   *
+   * @param pageIndex  Index of the page among the pages of the file, in the
+   *                   order they were written.
+   */
+  void seek(std::size_t pageIndex);
+
+  /**
+   * Unpins the current page.
+   */
+  void close() { page.release(); }
+
+  /**
+   * Get the number of pages read so far
+   */
+  std::size_t getNumPagesRead() const { return numPagesRead; }
+
+ private:
+  /**
+   * Manager owning the file
+   */
+  SpillManager* spill;
+
+  /**
+   * File read
+   */
+  File* file;
+
+  /**
+   * Index of the next page in the entry of the file
+   */
+  std::size_t nextPage;
+
+  /**
+   * Number of pages read
+   */
+  std::size_t numPagesRead;
+
+  /**
+   * Page being read
+   */
+  PageGuard page;
+
+  /**
+   * Next record of the page
+   */
+  PageIterator record;
+};
+
+}  // namespace badgerdb
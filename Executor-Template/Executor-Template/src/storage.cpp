@@ -5,8 +5,16 @@
  */
 
 #include "storage.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <thread>
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
 #include "exceptions/invalid_record_exception.h"
+#include "exceptions/partition_exception.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
 
@@ -14,57 +22,854 @@ using namespace std;
 
 namespace badgerdb {
 
-RecordId HeapFileManager::insertTuple(const string& tuple,
-                                      File& file,
-                                      BufMgr* bufMgr) {
-  badgerdb::Page* buffered_page = nullptr;
+// order record ids by page, then by slot
+static bool recordIdLess(const RecordId& lhs, const RecordId& rhs) {
+  return lhs.page_number < rhs.page_number ||
+         (lhs.page_number == rhs.page_number &&
+          lhs.slot_number < rhs.slot_number);
+}
+
+namespace {
+
+/**
+ * Observers of the changes made through HeapFileManager
+ */
+std::mutex observerMutex;
+vector<TableObserver*> observers;
+
+/**
+ * Row locks taken by HeapFileManager calls, NULL if rows are not locked
+ */
+LockManager* rowLocks = NULL;
+
+/**
+ * Names of the partitioned tables opened as a PartitionedTable, by the name
+ * of their table file
+ */
+std::mutex partitionedMutex;
+map<string, string> partitionedTableFiles;
+
+/**
+ * Transaction id of the next HeapFileManager call
+ */
+std::atomic<TxnId> nextTxn(1);
+
+/**
+ * Row locks of one HeapFileManager call, a transaction of its own which ends
+ * with the call
+ */
+class CallLocks {
+ public:
+  explicit CallLocks(const File& file)
+      : txn(nextTxn++), filename(file.filename()) {}
+
+  ~CallLocks() {
+    if (rowLocks != NULL) {
+      rowLocks->unlockAll(txn);
+    }
+  }
+
+  // lock records in record id order, so that calls locking the same records
+  // do not wait for each other in a cycle
+  void lock(vector<RecordId> rids, const LockMode mode) {
+    if (rowLocks == NULL) {
+      return;
+    }
+    sort(rids.begin(), rids.end(), recordIdLess);
+    for (size_t i = 0; i < rids.size(); ++i) {
+      rowLocks->lock(txn, filename, rids[i], mode);
+    }
+  }
+
+  void lock(const RecordId& rid, const LockMode mode) {
+    lock(vector<RecordId>(1, rid), mode);
+  }
+
+ private:
+  const TxnId txn;
+  const string filename;
+};
+
+}  // namespace
+
+// the observers interested in changes to the file
+static vector<TableObserver*> observersOf(const File& file) {
+  std::lock_guard<std::mutex> lock(observerMutex);
+  vector<TableObserver*> watching;
+  for (size_t i = 0; i < observers.size(); ++i) {
+    if (observers[i]->observes(file)) {
+      watching.push_back(observers[i]);
+    }
+  }
+  return watching;
+}
+
+void HeapFileManager::addObserver(TableObserver* observer) {
+  std::lock_guard<std::mutex> lock(observerMutex);
+  observers.push_back(observer);
+}
+
+void HeapFileManager::removeObserver(TableObserver* observer) {
+  std::lock_guard<std::mutex> lock(observerMutex);
+  observers.erase(remove(observers.begin(), observers.end(), observer),
+                  observers.end());
+}
+
+void HeapFileManager::setLockManager(LockManager* lockManager) {
+  rowLocks = lockManager;
+}
+
+// write a changed page back to the file, unless a write-ahead log makes the
+// change durable and the page can be written lazily
+static void writeBack(File& file, BufMgr* bufMgr, const PageId page_number) {
+  if (!bufMgr->isLogged(&file)) {
+    bufMgr->flushPage(&file, page_number);
+  }
+}
+
+// make the logged changes of a call durable before it returns
+static void commit(File& file, BufMgr* bufMgr) {
+  if (bufMgr->isLogged(&file)) {
+    bufMgr->getLogManager()->commit();
+  }
+}
+
+// insert a tuple without reporting it to the observers.  With home set, the
+// tuple is inserted as the moved copy of the record at home; the caller then
+// holds the latch of the home page, so pages latched elsewhere are skipped
+// rather than waited for.
+static RecordId heapInsert(const string& tuple,
+                           File& file,
+                           BufMgr* bufMgr,
+                           const RecordId* home = NULL) {
   RecordId recordId = {};
   // iterate all the pages in the file
   for (badgerdb::FileIterator iter = file.begin(); iter != file.end(); ++iter) {
-    badgerdb::Page page = *iter;
+    if (home == NULL) {
+      // look for space under a shared latch first, so that full pages are
+      // passed over without waiting for their readers
+      PageGuard probe =
+          bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+      const bool fits = probe.read().hasSpaceForRecord(tuple);
+      probe.release();
+      if (!fits) {
+        continue;
+      }
+    }
+    // check the buffered copy, which may be newer than the page on disk;
+    // the space may have been taken since the shared check
+    PageGuard guard =
+        home != NULL ? bufMgr->tryFetchExclusive(&file, iter.page_number())
+                     : bufMgr->fetch(&file, iter.page_number(), LATCH_EXCLUSIVE);
+    if (!guard.isPinned()) {
+      continue;
+    }
     // find a page in the certain file that has enough space for the tuple
-    if (page.hasSpaceForRecord(tuple)) {
-      bufMgr->readPage(&file, page.page_number(), buffered_page);
-      recordId = buffered_page->insertRecord(tuple);
+    if (home != NULL ? guard.read().hasSpaceForMovedRecord(tuple)
+                     : guard.read().hasSpaceForRecord(tuple)) {
+      recordId = home != NULL ? guard.insertMovedRecord(tuple, *home)
+                              : guard.insertRecord(tuple);
       // unpin the page after we finished inserting the tuple
-      bufMgr->unPinPage(&file, buffered_page->page_number(), true);
+      guard.release();
       // write the change back to the file
-      bufMgr->flushFile(&file);
+      writeBack(file, bufMgr, recordId.page_number);
       return recordId;
     }
   }
   // no available page found in the file
   // then allocate a new page
-  badgerdb::Page new_page = file.allocatePage();
-  bufMgr->readPage(&file, new_page.page_number(), buffered_page);
-  recordId = buffered_page->insertRecord(tuple);
+  PageGuard guard = bufMgr->fetchNew(&file, LATCH_EXCLUSIVE);
+  recordId = home != NULL ? guard.insertMovedRecord(tuple, *home)
+                          : guard.insertRecord(tuple);
   // unpin the page after we finished inserting the tuple
-  bufMgr->unPinPage(&file, buffered_page->page_number(), true);
+  guard.release();
   // write the change back to the file
-  bufMgr->flushFile(&file);
+  writeBack(file, bufMgr, recordId.page_number);
   return recordId;
 }
 
-void HeapFileManager::deleteTuple(const RecordId& rid,
+RecordId HeapFileManager::insertTuple(const string& tuple,
+                                      File& file,
+                                      BufMgr* bufMgr) {
+  PartitionedTable::checkPlainFile(file);
+  CallLocks locks(file);
+  const RecordId recordId = heapInsert(tuple, file, bufMgr);
+  locks.lock(recordId, LOCK_EXCLUSIVE);
+  commit(file, bufMgr);
+  const vector<TableObserver*> watching = observersOf(file);
+  if (!watching.empty()) {
+    const vector<string> tuples(1, tuple);
+    for (size_t i = 0; i < watching.size(); ++i) {
+      watching[i]->tuplesInserted(file, tuples, bufMgr);
+    }
+  }
+  return recordId;
+}
+
+bool HeapFileManager::deleteTuple(const RecordId& rid,
                                   File& file,
                                   BufMgr* bufMgr) {
-  // iterate all the pages in the file
-  for (auto page : file) {
-    badgerdb::Page* page_i;
-    bufMgr->readPage(&file, page.page_number(), page_i);
+  vector<RecordId> rids(1, rid);
+  return deleteTuples(rids, file, bufMgr) == 1;
+}
+
+// delete the forwarding stub at home if it still points to the moved copy
+static void dropStub(const RecordId& home,
+                     const RecordId& copy,
+                     File& file,
+                     BufMgr* bufMgr) {
+  try {
+    PageGuard guard = bufMgr->fetch(&file, home.page_number, LATCH_EXCLUSIVE);
+    if (!guard.read().isForwarded(home) ||
+        guard.read().getForwardingAddress(home) != copy) {
+      return;
+    }
+    guard.deleteRecord(home);
+  } catch (InvalidPageException& e) {
+    return;
+  } catch (InvalidRecordException& e) {
+    return;
+  }
+  writeBack(file, bufMgr, home.page_number);
+}
+
+// delete tuples without reporting them to the observers.  A forwarding stub
+// takes its moved copy along, and with dropStubs set a moved copy takes its
+// stub along, so that no stub is left pointing to a reused slot.
+static int heapDelete(const vector<RecordId>& rids,
+                      File& file,
+                      BufMgr* bufMgr,
+                      const bool dropStubs = true) {
+  vector<RecordId> sorted_rids(rids);
+  sort(sorted_rids.begin(), sorted_rids.end(), recordIdLess);
+
+  int num_deleted = 0;
+  // new locations of moved tuples
+  vector<RecordId> moved_rids;
+  // stubs of the moved copies deleted, and the copies
+  vector<pair<RecordId, RecordId> > stub_rids;
+  size_t i = 0;
+  while (i < sorted_rids.size()) {
+    const PageId page_number = sorted_rids[i].page_number;
+    size_t page_end = i;
+    while (page_end < sorted_rids.size() &&
+           sorted_rids[page_end].page_number == page_number) {
+      ++page_end;
+    }
+    if (page_number == Page::INVALID_NUMBER) {
+      i = page_end;
+      continue;
+    }
+    // pin the page once for all of its records
+    PageGuard guard;
+    try {
+      guard = bufMgr->fetch(&file, page_number, LATCH_EXCLUSIVE);
+    } catch (InvalidPageException& e) {
+      // the page is not in use, so neither are its records
+      i = page_end;
+      continue;
+    }
+    for (; i < page_end; ++i) {
+      try {
+        // a moved tuple is deleted at its new location as well
+        if (guard.read().isForwarded(sorted_rids[i])) {
+          moved_rids.push_back(
+              guard.read().getForwardingAddress(sorted_rids[i]));
+        } else if (dropStubs && guard.read().isMoved(sorted_rids[i])) {
+          stub_rids.push_back(make_pair(
+              guard.read().getHomeAddress(sorted_rids[i]), sorted_rids[i]));
+        }
+        guard.deleteRecord(sorted_rids[i]);
+      } catch (InvalidRecordException& e) {
+        continue;  // already deleted (or listed twice)
+      }
+      ++num_deleted;
+    }
+    // write the changes back to the file
+    guard.release();
+    writeBack(file, bufMgr, page_number);
+  }
+  if (!moved_rids.empty()) {
+    heapDelete(moved_rids, file, bufMgr, false /* dropStubs */);
+  }
+  for (size_t j = 0; j < stub_rids.size(); ++j) {
+    dropStub(stub_rids[j].first, stub_rids[j].second, file, bufMgr);
+  }
+  return num_deleted;
+}
+
+// get a tuple without taking a row lock, following its forwarding stub
+static string heapGet(const RecordId& rid, File& file, BufMgr* bufMgr) {
+  PageGuard guard = bufMgr->fetch(&file, rid.page_number, LATCH_SHARED);
+  if (guard.read().isForwarded(rid)) {
+    const RecordId new_rid = guard.read().getForwardingAddress(rid);
+    guard.release();
+    return heapGet(new_rid, file, bufMgr);
+  }
+  return guard.read().getRecord(rid);
+}
+
+// the distinct record ids which refer to a tuple, and their tuples
+static void readTuples(const vector<RecordId>& rids,
+                       File& file,
+                       BufMgr* bufMgr,
+                       vector<RecordId>& found,
+                       vector<string>& tuples) {
+  vector<RecordId> sorted_rids(rids);
+  sort(sorted_rids.begin(), sorted_rids.end(), recordIdLess);
+  sorted_rids.erase(unique(sorted_rids.begin(), sorted_rids.end()),
+                    sorted_rids.end());
+  for (size_t i = 0; i < sorted_rids.size(); ++i) {
+    if (sorted_rids[i].page_number == Page::INVALID_NUMBER) {
+      continue;
+    }
     try {
-      page_i->deleteRecord(rid);
+      tuples.push_back(heapGet(sorted_rids[i], file, bufMgr));
+      found.push_back(sorted_rids[i]);
+    } catch (InvalidPageException& e) {
+      // not a tuple
     } catch (InvalidRecordException& e) {
-      // did not find the correspond rid in this page
-      bufMgr->unPinPage(&file, page_i->page_number(), false);
-      continue;  // try to find the record in the next page
-    };
-    // has deleted the record
-    bufMgr->unPinPage(&file, page_i->page_number(), true);
-    break;
+      // not a tuple
+    }
+  }
+}
+
+int HeapFileManager::deleteTuples(const vector<RecordId>& rids,
+                                  File& file,
+                                  BufMgr* bufMgr) {
+  CallLocks locks(file);
+  locks.lock(rids, LOCK_EXCLUSIVE);
+  const vector<TableObserver*> watching = observersOf(file);
+  if (watching.empty()) {
+    const int num_deleted = heapDelete(rids, file, bufMgr);
+    commit(file, bufMgr);
+    return num_deleted;
+  }
+  vector<RecordId> found;
+  vector<string> old_tuples;
+  readTuples(rids, file, bufMgr, found, old_tuples);
+  const int num_deleted = heapDelete(found, file, bufMgr);
+  commit(file, bufMgr);
+  for (size_t i = 0; i < watching.size(); ++i) {
+    watching[i]->tuplesDeleted(file, old_tuples, bufMgr);
+  }
+  return num_deleted;
+}
+
+string HeapFileManager::getTuple(const RecordId& rid,
+                                 File& file,
+                                 BufMgr* bufMgr) {
+  CallLocks locks(file);
+  locks.lock(rid, LOCK_SHARED);
+  return heapGet(rid, file, bufMgr);
+}
+
+// replace a tuple without reporting it to the observers
+static bool heapUpdate(const RecordId& rid,
+                       const string& tuple,
+                       File& file,
+                       BufMgr* bufMgr) {
+  if (rid.page_number == Page::INVALID_NUMBER) {
+    return false;
+  }
+  for (;;) {
+    PageGuard guard;
+    // page of the moved copy, if the tuple has been moved to another page
+    PageGuard copy_guard;
+    // the record holding the tuple: rid itself or its moved copy
+    RecordId copy_rid = rid;
+    try {
+      guard = bufMgr->fetch(&file, rid.page_number, LATCH_EXCLUSIVE);
+      if (guard.read().isMoved(rid)) {
+        // a moved copy is replaced in place, or moved again from its home
+        try {
+          guard.updateRecord(rid, tuple);
+        } catch (InsufficientSpaceException& e) {
+          const RecordId home = guard.read().getHomeAddress(rid);
+          guard.release();
+          return heapUpdate(home, tuple, file, bufMgr);
+        }
+        guard.release();
+        writeBack(file, bufMgr, rid.page_number);
+        return true;
+      }
+      if (guard.read().isForwarded(rid)) {
+        copy_rid = guard.read().getForwardingAddress(rid);
+        if (copy_rid.page_number != rid.page_number) {
+          // latches are taken home first, so the copy's page is only tried
+          // and the home page let go if it is busy
+          copy_guard = bufMgr->tryFetchExclusive(&file, copy_rid.page_number);
+          if (!copy_guard.isPinned()) {
+            guard.release();
+            std::this_thread::yield();
+            continue;
+          }
+        }
+      }
+      PageGuard& holder = copy_guard.isPinned() ? copy_guard : guard;
+      // fast path: the new version fits in the page
+      holder.updateRecord(copy_rid, tuple);
+      guard.release();
+      copy_guard.release();
+      writeBack(file, bufMgr, rid.page_number);
+      if (copy_rid.page_number != rid.page_number) {
+        writeBack(file, bufMgr, copy_rid.page_number);
+      }
+      return true;
+    } catch (InvalidPageException& e) {
+      return false;
+    } catch (InvalidRecordException& e) {
+      return false;
+    } catch (InsufficientSpaceException& e) {
+      // the page is left unchanged by a failed updateRecord
+    }
+    // move the tuple to another page and leave a forwarding stub behind.  The
+    // home page stays latched, so no other thread takes the space of the
+    // stub meanwhile.
+    const RecordId new_rid = heapInsert(tuple, file, bufMgr, &rid);
+    try {
+      guard.forwardRecord(rid, new_rid);
+      if (copy_rid != rid) {
+        PageGuard& holder = copy_guard.isPinned() ? copy_guard : guard;
+        holder.deleteRecord(copy_rid);
+      }
+    } catch (...) {
+      // do not leave the new copy behind as a second version of the tuple
+      guard.release();
+      copy_guard.release();
+      heapDelete(vector<RecordId>(1, new_rid), file, bufMgr,
+                 false /* dropStubs */);
+      throw;
+    }
+    guard.release();
+    copy_guard.release();
+    writeBack(file, bufMgr, rid.page_number);
+    if (copy_rid.page_number != rid.page_number) {
+      writeBack(file, bufMgr, copy_rid.page_number);
+    }
+    return true;
+  }
+}
+
+bool HeapFileManager::updateTuple(const RecordId& rid,
+                                  const string& tuple,
+                                  File& file,
+                                  BufMgr* bufMgr) {
+  CallLocks locks(file);
+  locks.lock(rid, LOCK_EXCLUSIVE);
+  const vector<TableObserver*> watching = observersOf(file);
+  if (watching.empty()) {
+    const bool updated = heapUpdate(rid, tuple, file, bufMgr);
+    commit(file, bufMgr);
+    return updated;
+  }
+  vector<RecordId> found;
+  vector<string> old_tuples;
+  readTuples(vector<RecordId>(1, rid), file, bufMgr, found, old_tuples);
+  if (found.empty() || !heapUpdate(rid, tuple, file, bufMgr)) {
+    return false;
+  }
+  commit(file, bufMgr);
+  const vector<string> new_tuples(1, tuple);
+  for (size_t i = 0; i < watching.size(); ++i) {
+    watching[i]->tuplesDeleted(file, old_tuples, bufMgr);
+    watching[i]->tuplesInserted(file, new_tuples, bufMgr);
+  }
+  return true;
+}
+
+// order updates by record id
+static bool updateLess(const pair<RecordId, string>* lhs,
+                       const pair<RecordId, string>* rhs) {
+  return recordIdLess(lhs->first, rhs->first);
+}
+
+// replace tuples without reporting them to the observers
+static int heapUpdateBatch(const vector<pair<RecordId, string> >& updates,
+                           File& file,
+                           BufMgr* bufMgr) {
+  vector<const pair<RecordId, string>*> sorted_updates;
+  for (size_t i = 0; i < updates.size(); ++i) {
+    sorted_updates.push_back(&updates[i]);
+  }
+  sort(sorted_updates.begin(), sorted_updates.end(), updateLess);
+
+  int num_updated = 0;
+  // updates which cannot be done in place
+  vector<const pair<RecordId, string>*> slow_updates;
+  size_t i = 0;
+  while (i < sorted_updates.size()) {
+    const PageId page_number = sorted_updates[i]->first.page_number;
+    size_t page_end = i;
+    while (page_end < sorted_updates.size() &&
+           sorted_updates[page_end]->first.page_number == page_number) {
+      ++page_end;
+    }
+    if (page_number == Page::INVALID_NUMBER) {
+      i = page_end;
+      continue;
+    }
+    PageGuard guard;
+    try {
+      guard = bufMgr->fetch(&file, page_number, LATCH_EXCLUSIVE);
+    } catch (InvalidPageException& e) {
+      i = page_end;
+      continue;
+    }
+    for (; i < page_end; ++i) {
+      const RecordId& rid = sorted_updates[i]->first;
+      try {
+        if (guard.read().isForwarded(rid)) {
+          slow_updates.push_back(sorted_updates[i]);
+          continue;
+        }
+        guard.updateRecord(rid, sorted_updates[i]->second);
+      } catch (InvalidRecordException& e) {
+        continue;
+      } catch (InsufficientSpaceException& e) {
+        slow_updates.push_back(sorted_updates[i]);
+        continue;
+      }
+      ++num_updated;
+    }
+    guard.release();
+    writeBack(file, bufMgr, page_number);
+  }
+
+  for (size_t j = 0; j < slow_updates.size(); ++j) {
+    if (heapUpdate(slow_updates[j]->first, slow_updates[j]->second, file,
+                   bufMgr)) {
+      ++num_updated;
+    }
+  }
+  return num_updated;
+}
+
+int HeapFileManager::updateTuples(
+    const vector<pair<RecordId, string> >& updates,
+    File& file,
+    BufMgr* bufMgr) {
+  CallLocks locks(file);
+  vector<RecordId> locked;
+  for (size_t i = 0; i < updates.size(); ++i) {
+    locked.push_back(updates[i].first);
+  }
+  locks.lock(locked, LOCK_EXCLUSIVE);
+  const vector<TableObserver*> watching = observersOf(file);
+  if (watching.empty()) {
+    const int num_updated = heapUpdateBatch(updates, file, bufMgr);
+    commit(file, bufMgr);
+    return num_updated;
+  }
+  vector<RecordId> rids;
+  for (size_t i = 0; i < updates.size(); ++i) {
+    rids.push_back(updates[i].first);
+  }
+  vector<RecordId> found;
+  vector<string> old_tuples;
+  readTuples(rids, file, bufMgr, found, old_tuples);
+  const int num_updated = heapUpdateBatch(updates, file, bufMgr);
+  commit(file, bufMgr);
+  // read the new versions back, as a record id may be listed twice
+  vector<RecordId> updated;
+  vector<string> new_tuples;
+  readTuples(found, file, bufMgr, updated, new_tuples);
+  for (size_t i = 0; i < watching.size(); ++i) {
+    watching[i]->tuplesDeleted(file, old_tuples, bufMgr);
+    watching[i]->tuplesInserted(file, new_tuples, bufMgr);
+  }
+  return num_updated;
+}
+
+// space and stubs of a page, gathered by vacuum
+struct VacuumPage {
+  PageId page_number;
+  size_t used_space;
+  size_t free_space;
+  bool has_stubs;
+};
+
+static bool vacuumPageLess(const VacuumPage& lhs, const VacuumPage& rhs) {
+  return lhs.page_number < rhs.page_number;
+}
+
+// measure every used page of a file and find its forwarding stubs, keyed by
+// the location of the moved copy they point to
+static void measurePages(File& file,
+                         BufMgr* bufMgr,
+                         vector<VacuumPage>& pages,
+                         map<pair<PageId, SlotId>, RecordId>& stubs) {
+  pages.clear();
+  stubs.clear();
+  for (badgerdb::FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    PageGuard guard = bufMgr->fetch(&file, iter.page_number(), LATCH_SHARED);
+    const Page& page = guard.read();
+    VacuumPage info;
+    info.page_number = iter.page_number();
+    info.free_space = page.getFreeSpace();
+    info.used_space = Page::DATA_SIZE - info.free_space;
+    info.has_stubs = false;
+    for (SlotId slot = 1; slot <= page.num_slots(); ++slot) {
+      const RecordId rid = {info.page_number, slot};
+      try {
+        if (page.isForwarded(rid)) {
+          const RecordId target = page.getForwardingAddress(rid);
+          stubs[make_pair(target.page_number, target.slot_number)] = rid;
+          info.has_stubs = true;
+        }
+      } catch (InvalidRecordException& e) {
+        continue;  // unused slot
+      }
+    }
+    pages.push_back(info);
+  }
+}
+
+// move tuples back from their moved copy into the slot of their stub
+// wherever the page of the stub has room again
+static int bringHome(File& file,
+                     BufMgr* bufMgr,
+                     const map<pair<PageId, SlotId>, RecordId>& stubs) {
+  int num_home = 0;
+  for (map<pair<PageId, SlotId>, RecordId>::const_iterator it = stubs.begin();
+       it != stubs.end(); ++it) {
+    const RecordId moved_rid = {it->first.first, it->first.second};
+    string tuple;
+    try {
+      PageGuard moved_guard =
+          bufMgr->fetch(&file, moved_rid.page_number, LATCH_SHARED);
+      // only the copy the stub was left for; a slot reused since is left
+      // alone
+      if (!moved_guard.read().isMoved(moved_rid) ||
+          moved_guard.read().getHomeAddress(moved_rid) != it->second) {
+        continue;
+      }
+      tuple = moved_guard.read().getRecord(moved_rid);
+    } catch (InvalidRecordException& e) {
+      continue;
+    }
+    PageGuard guard =
+        bufMgr->fetch(&file, it->second.page_number, LATCH_EXCLUSIVE);
+    try {
+      guard.updateRecord(it->second, tuple);
+    } catch (InsufficientSpaceException& e) {
+      continue;
+    }
+    guard.release();
+    writeBack(file, bufMgr, it->second.page_number);
+    PageGuard moved_guard =
+        bufMgr->fetch(&file, moved_rid.page_number, LATCH_EXCLUSIVE);
+    moved_guard.deleteRecord(moved_rid);
+    moved_guard.release();
+    writeBack(file, bufMgr, moved_rid.page_number);
+    ++num_home;
+  }
+  return num_home;
+}
+
+VacuumResult HeapFileManager::vacuum(File& file,
+                                     BufMgr* bufMgr,
+                                     const double fillFactor) {
+  VacuumResult result;
+  vector<VacuumPage> pages;
+  map<pair<PageId, SlotId>, RecordId> stubs;
+  measurePages(file, bufMgr, pages, stubs);
+  result.tuplesMoved = bringHome(file, bufMgr, stubs);
+  const int pages_before = static_cast<int>(pages.size());
+  if (result.tuplesMoved > 0) {
+    measurePages(file, bufMgr, pages, stubs);
+  }
+  sort(pages.begin(), pages.end(), vacuumPageLess);
+  result.pagesBefore = pages_before;
+
+  const size_t sparse_space =
+      static_cast<size_t>(fillFactor * Page::DATA_SIZE);
+  // relocations by the current location of the moved tuple
+  map<pair<PageId, SlotId>, size_t> relocated;
+  int pages_freed = 0;
+  // empty sparse pages from the end of the file into the first pages with
+  // free space
+  size_t target = 0;
+  size_t source = pages.size();
+  while (source > target + 1) {
+    --source;
+    const PageId source_page = pages[source].page_number;
+    if (pages[source].has_stubs || pages[source].used_space >= sparse_space) {
+      continue;
+    }
+    vector<pair<RecordId, string> > tuples;
+    // home slots of the moved copies among them, an invalid id for the others
+    vector<RecordId> homes;
+    {
+      PageGuard guard = bufMgr->fetch(&file, source_page, LATCH_SHARED);
+      const Page& page = guard.read();
+      for (SlotId slot = 1; slot <= page.num_slots(); ++slot) {
+        const RecordId rid = {source_page, slot};
+        try {
+          tuples.push_back(make_pair(rid, page.getRecord(rid)));
+          const RecordId no_home = {Page::INVALID_NUMBER, Page::INVALID_SLOT};
+          homes.push_back(page.isMoved(rid) ? page.getHomeAddress(rid)
+                                            : no_home);
+        } catch (InvalidRecordException& e) {
+          continue;
+        }
+      }
+    }
+    // place the tuples first-fit, counting a new slot for each
+    vector<size_t> free_space(source);
+    for (size_t i = target; i < source; ++i) {
+      free_space[i] = pages[i].free_space;
+    }
+    vector<size_t> destinations;
+    for (size_t i = 0; i < tuples.size(); ++i) {
+      // a moved copy keeps the record id of its home in front
+      const bool moved = homes[i].page_number != Page::INVALID_NUMBER;
+      const size_t needed =
+          Page::recordSpace(tuples[i].second.size() +
+                            (moved ? sizeof(PageId) + sizeof(SlotId) : 0)) +
+          sizeof(PageSlot);
+      size_t dest = target;
+      while (dest < source && free_space[dest] < needed) {
+        ++dest;
+      }
+      if (dest == source) {
+        break;
+      }
+      free_space[dest] -= needed;
+      destinations.push_back(dest);
+    }
+    if (destinations.size() < tuples.size()) {
+      break;  // the earlier pages are too full to take this page
+    }
+
+    vector<RecordId> moved;
+    for (size_t i = 0; i < tuples.size(); ++i) {
+      VacuumPage& dest = pages[destinations[i]];
+      PageGuard guard =
+          bufMgr->fetch(&file, dest.page_number, LATCH_EXCLUSIVE);
+      const bool copy = homes[i].page_number != Page::INVALID_NUMBER;
+      if (copy ? !guard.read().hasSpaceForMovedRecord(tuples[i].second)
+                : !guard.read().hasSpaceForRecord(tuples[i].second)) {
+        break;  // filled up concurrently
+      }
+      const RecordId new_rid =
+          copy ? guard.insertMovedRecord(tuples[i].second, homes[i])
+                : guard.insertRecord(tuples[i].second);
+      // the page may come up as a source later, so its measure is kept
+      // current
+      dest.free_space = guard.read().getFreeSpace();
+      dest.used_space = Page::DATA_SIZE - dest.free_space;
+      guard.release();
+      writeBack(file, bufMgr, dest.page_number);
+
+      const RecordId& old_rid = tuples[i].first;
+      const pair<PageId, SlotId> old_key(old_rid.page_number,
+                                         old_rid.slot_number);
+      const pair<PageId, SlotId> new_key(new_rid.page_number,
+                                         new_rid.slot_number);
+      if (copy) {
+        // a moved copy: repoint its stub, the record id stays the same
+        PageGuard stub_guard =
+            bufMgr->fetch(&file, homes[i].page_number, LATCH_EXCLUSIVE);
+        stub_guard.forwardRecord(homes[i], new_rid);
+        stub_guard.release();
+        writeBack(file, bufMgr, homes[i].page_number);
+      } else {
+        map<pair<PageId, SlotId>, size_t>::iterator earlier =
+            relocated.find(old_key);
+        if (earlier != relocated.end()) {
+          result.relocations[earlier->second].second = new_rid;
+          relocated[new_key] = earlier->second;
+          relocated.erase(earlier);
+        } else {
+          relocated[new_key] = result.relocations.size();
+          result.relocations.push_back(make_pair(old_rid, new_rid));
+        }
+      }
+      moved.push_back(old_rid);
+      ++result.tuplesMoved;
+    }
+
+    PageGuard guard = bufMgr->fetch(&file, source_page, LATCH_EXCLUSIVE);
+    for (size_t i = 0; i < moved.size(); ++i) {
+      guard.deleteRecord(moved[i]);
+    }
+    // the slot array shrinks to nothing once the last record is gone
+    const bool empty = guard.read().num_slots() == 0;
+    guard.release();
+    if (empty) {
+      bufMgr->disposePage(&file, source_page);
+      ++pages_freed;
+    } else {
+      writeBack(file, bufMgr, source_page);
+    }
+    if (moved.size() < tuples.size()) {
+      break;
+    }
+    while (target < source &&
+           pages[target].free_space <= sizeof(PageSlot)) {
+      ++target;
+    }
+  }
+
+  commit(file, bufMgr);
+  bufMgr->sortPageLists(&file);
+  result.pagesAfter = static_cast<int>(pages.size()) - pages_freed;
+  return result;
+}
+
+PartitionedTable::PartitionedTable(const Catalog* catalog,
+                                   const TableId& id,
+                                   bool create)
+    : catalog(catalog), id(id) {
+  if (!catalog->isPartitioned(id)) {
+    throw PartitionException(catalog->getTableSchema(id).getTableName(),
+                             "the table is not partitioned");
+  }
+  {
+    std::lock_guard<std::mutex> lock(partitionedMutex);
+    partitionedTableFiles[catalog->getTableFilename(id)] =
+        catalog->getTableSchema(id).getTableName();
+  }
+  const int num_partitions = catalog->getPartitionScheme(id).getPartitionCount();
+  for (int i = 0; i < num_partitions; ++i) {
+    const string& filename = catalog->getPartitionFilename(id, i);
+    files.push_back(create ? File::create(filename) : File::open(filename));
+  }
+}
+
+RecordId PartitionedTable::insertTuple(const string& tuple,
+                                       BufMgr* bufMgr,
+                                       int* partition) {
+  const int target =
+      getPartitionScheme().partitionOf(tuple, getTableSchema());
+  if (partition != NULL) {
+    *partition = target;
+  }
+  return HeapFileManager::insertTuple(tuple, files[target], bufMgr);
+}
+
+void PartitionedTable::checkPlainFile(const File& file,
+                                      const Catalog* catalog) {
+  string table;
+  {
+    std::lock_guard<std::mutex> lock(partitionedMutex);
+    map<string, string>::const_iterator it =
+        partitionedTableFiles.find(file.filename());
+    if (it != partitionedTableFiles.end()) {
+      table = it->second;
+    }
+  }
+  TableId id;
+  if (table.empty() && catalog != NULL &&
+      catalog->findPartitionedTable(file.filename(), id)) {
+    table = catalog->getTableSchema(id).getTableName();
+  }
+  if (!table.empty()) {
+    throw PartitionException(
+        table, "its tuples are in the files of its partitions, not in " +
+                   file.filename());
   }
-  // write the change back to the file
-  bufMgr->flushFile(&file);
 }
 
 string HeapFileManager::createTupleFromSQLStatement(const string& sql,
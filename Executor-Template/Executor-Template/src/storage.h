@@ -9,26 +9,202 @@
 #include "buffer.h"
 #include "catalog.h"
 #include "file.h"
+#include "lock_manager.h"
 #include "types.h"
 
+#include <utility>
+#include <vector>
+
 using namespace std;
 
 namespace badgerdb {
 
 /**
- * Heap file manager for inserting and deleting tuples
+ * Outcome of vacuuming a heap file
+ */
+struct VacuumResult {
+  /**
+   * Number of used pages before and after the vacuum
+   */
+  int pagesBefore;
+  int pagesAfter;
+
+  /**
+   * Number of tuples moved to another page or back to their stub
+   */
+  int tuplesMoved;
+
+  /**
+   * Old and new record ids of the moved tuples.  Tuples reached through a
+   * forwarding stub keep their record id and are not listed.  The vacuum
+   * does not apply these itself: whoever keeps record ids of the table, such
+   * as an index, must map them before using them again.  Table observers are
+   * not told about the moves, as the tuples themselves do not change, so
+   * materialized views, which hold tuples rather than record ids, stay
+   * valid.
+   */
+  vector<pair<RecordId, RecordId> > relocations;
+
+  VacuumResult() : pagesBefore(0), pagesAfter(0), tuplesMoved(0) {}
+};
+
+/**
+ * Receives the tuples inserted into and deleted from heap files through
+ * HeapFileManager, e.g. to keep data derived from a table current.  An update
+ * is reported as the deletion of the old version and the insertion of the
+ * new one.  The callbacks run after the change, on the thread making it.
+ */
+class TableObserver {
+ public:
+  virtual ~TableObserver() {}
+
+  /**
+   * Does the observer want to hear about changes to the file?
+   */
+  virtual bool observes(const File& file) const = 0;
+
+  /**
+   * Tuples have been inserted into the file
+   */
+  virtual void tuplesInserted(const File& file,
+                              const vector<string>& tuples,
+                              BufMgr* bufMgr) = 0;
+
+  /**
+   * Tuples have been deleted from the file
+   */
+  virtual void tuplesDeleted(const File& file,
+                             const vector<string>& tuples,
+                             BufMgr* bufMgr) = 0;
+};
+
+/**
+ * Heap file manager for inserting and deleting tuples.  Changed pages are
+ * written back to the file before each call returns, unless the buffer
+ * manager logs the file; then the changes are logged, each call ends with a
+ * commit which returns once the log is durable, and the pages are written
+ * lazily.  Concurrent callers share log syncs through group commit.  Pages
+ * are latched while they are read or changed, so several threads may work
+ * on the same table.
+ *
+ * If a lock manager is set, each call is also a transaction of its own under
+ * strict two-phase locking: it locks the record ids it is given, shared for
+ * getTuple() and exclusive otherwise (an inserted tuple is locked once it
+ * has its record id), and releases them once the call has committed.  Row
+ * locks are taken before any page is latched.  vacuum() takes no row locks.
  */
 class HeapFileManager {
  public:
   /**
    * Insert a tuple to a table
+   *
+   * @throws PartitionException If the file is the table file of a partitioned
+   *                            table; insert through PartitionedTable instead
    */
   static RecordId insertTuple(const string& tuple, File& file, BufMgr* bufMgr);
 
   /**
-   * Delete a tuple from a table
+   * Delete a tuple from a table.  Only the page named by the record id is
+   * read, plus the page of the forwarding stub when the record id names a
+   * tuple moved by an update; the stub is deleted with it.
+   *
+   * @return  True if the record existed and has been deleted
+   */
+  static bool deleteTuple(const RecordId& rid, File& file, BufMgr* bufMgr);
+
+  /**
+   * Delete a batch of tuples from a table.  The record ids are sorted by page
+   * so that every affected page is read, modified and written once.  Record
+   * ids which do not refer to a record are skipped.
+   *
+   * @return  Number of records deleted
+   */
+  static int deleteTuples(const vector<RecordId>& rids,
+                          File& file,
+                          BufMgr* bufMgr);
+
+  /**
+   * Get a tuple from a table, following the forwarding stub if the tuple has
+   * been moved by an update
+   *
+   * @throws InvalidRecordException If the record id does not refer to a tuple
+   */
+  static string getTuple(const RecordId& rid, File& file, BufMgr* bufMgr);
+
+  /**
+   * Replace a tuple.  The tuple is updated in place if the new version fits
+   * in its page; otherwise it is moved to another page and a forwarding stub
+   * is left behind, so the record id stays valid.  A moved tuple may also be
+   * named by the record id of its copy, e.g. as reported by a scan; if it
+   * has to move again, the stub is repointed and the copy's record id
+   * becomes invalid.
+   *
+   * @return  True if the record existed and has been updated
    */
-  static void deleteTuple(const RecordId& rid, File& file, BufMgr* bufMgr);
+  static bool updateTuple(const RecordId& rid,
+                          const string& tuple,
+                          File& file,
+                          BufMgr* bufMgr);
+
+  /**
+   * Replace a batch of tuples.  In-place updates are applied page by page,
+   * reading each page once; tuples which no longer fit are then moved as in
+   * updateTuple().  Record ids which do not refer to a tuple are skipped.
+   *
+   * @return  Number of tuples updated
+   */
+  static int updateTuples(const vector<pair<RecordId, string> >& updates,
+                          File& file,
+                          BufMgr* bufMgr);
+
+  /**
+   * Repack a heap file.  Tuples moved away by updates are first brought back
+   * into the slot of their forwarding stub where the page has room again.
+   * Then, starting from the end of the file, the tuples of pages filled below
+   * the fill factor are moved into free space on earlier pages, and every
+   * page emptied this way is returned to the free list.  The page lists are
+   * finally relinked in physical order, so that scans read fewer pages and
+   * read them sequentially.
+   *
+   * A moved tuple gets a new record id, reported in the result; a tuple
+   * reached through a forwarding stub keeps its record id, as the stub is
+   * repointed.  Pages still holding stubs are never emptied.  Each page is latched
+   * while it changes, but a scan running concurrently may miss or repeat a
+   * moved tuple, so the vacuum should run between queries on the table.
+   *
+   * With a write-ahead log, every tuple move and page disposal is logged,
+   * and the moves are committed before the page lists are relinked through
+   * BufMgr::sortPageLists(), which logs the relink so that recovery repeats
+   * it.  The log has no undo, though, so a crash in the middle of moving a
+   * tuple may leave it at both its old and its new place; the vacuum is
+   * crash-safe in that no tuple is lost and the page lists stay intact.
+   *
+   * @param fillFactor  Fraction of a page below which it is merged away.
+   */
+  static VacuumResult vacuum(File& file,
+                             BufMgr* bufMgr,
+                             const double fillFactor = 0.5);
+
+  /**
+   * Start reporting changes to an observer.  The tuples deleted from or
+   * replaced in an observed file are read before they change, which costs one
+   * page read per tuple.
+   */
+  static void addObserver(TableObserver* observer);
+
+  /**
+   * Stop reporting changes to an observer
+   */
+  static void removeObserver(TableObserver* observer);
+
+  /**
+   * Lock the rows changed or read through HeapFileManager in the given lock
+   * manager, NULL to stop locking.  Set it before the calls it should cover.
+   *
+   * @throws LockTimeoutException From a call which does not get its locks
+   * within the timeout of the lock manager.
+   */
+  static void setLockManager(LockManager* lockManager);
 
   /**
    * Create a tuple from an SQL statement
@@ -36,4 +212,82 @@ class HeapFileManager {
   static string createTupleFromSQLStatement(const string& sql,
                                             const Catalog* catalog);
 };
+
+/**
+ * Partitioned table, stored in one heap file per partition as registered in
+ * the catalog.  Tuples are inserted into the partition of their key.
+ */
+class PartitionedTable {
+ public:
+  /**
+   * Open the files of the partitions of a table
+   *
+   * @param create  Create the files instead of opening them
+   * @throws PartitionException If the table is not partitioned
+   */
+  PartitionedTable(const Catalog* catalog, const TableId& id,
+                   bool create = false);
+
+  /**
+   * Get the table schema
+   */
+  const TableSchema& getTableSchema() const {
+    return catalog->getTableSchema(id);
+  }
+
+  /**
+   * Get the partitioning of the table
+   */
+  const PartitionScheme& getPartitionScheme() const {
+    return catalog->getPartitionScheme(id);
+  }
+
+  /**
+   * Get the number of partitions
+   */
+  int getPartitionCount() const { return files.size(); }
+
+  /**
+   * Get the file of a partition
+   */
+  File& getPartition(int partition) { return files[partition]; }
+
+  /**
+   * Insert a tuple into the partition of its key
+   *
+   * @param partition  If not NULL, receives the partition of the tuple
+   * @return  Record id of the tuple within its partition
+   */
+  RecordId insertTuple(const string& tuple, BufMgr* bufMgr,
+                       int* partition = NULL);
+
+  /**
+   * Check that a file is not the table file of a partitioned table.  That
+   * file holds no tuples, so inserting into it or reading it as the table
+   * silently loses or misses the tuples of the partitions.
+   *
+   * @param catalog  If not NULL, the partitioned tables of the catalog are
+   *                 checked too, not only those opened as a PartitionedTable
+   * @throws PartitionException If the file is the table file of a partitioned
+   *                            table
+   */
+  static void checkPlainFile(const File& file, const Catalog* catalog = NULL);
+
+ private:
+  /**
+   * System catalog
+   */
+  const Catalog* catalog;
+
+  /**
+   * Table Id
+   */
+  TableId id;
+
+  /**
+   * Files of the partitions
+   */
+  vector<File> files;
+};
+
 }  // namespace badgerdb
\ No newline at end of file
@@ -0,0 +1,194 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "tuple_formatter.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace badgerdb {
+
+OutputBuffer::OutputBuffer(std::ostream& out, const std::size_t size)
+    : out(out), buffer(size > 0 ? size : 1), used(0) {
+  // nothing
+}
+
+OutputBuffer::~OutputBuffer() {
+  drain();
+}
+
+void OutputBuffer::appendInt(int value) {
+  char digits[12];
+  int pos = sizeof(digits);
+  // work on the magnitude as unsigned so that INT_MIN is handled too
+  std::uint32_t magnitude = value < 0 ? 0u - static_cast<std::uint32_t>(value)
+                                      : static_cast<std::uint32_t>(value);
+  do {
+    digits[--pos] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) {
+    digits[--pos] = '-';
+  }
+  append(digits + pos, sizeof(digits) - pos);
+}
+
+void OutputBuffer::flush() {
+  drain();
+  out.flush();
+}
+
+void OutputBuffer::appendSlow(const char* data, const std::size_t length) {
+  drain();
+  if (length >= buffer.size()) {
+    // too big to be worth copying
+    out.write(data, length);
+    return;
+  }
+  std::char_traits<char>::copy(&buffer[0], data, length);
+  used = length;
+}
+
+void OutputBuffer::drain() {
+  if (used > 0) {
+    out.write(&buffer[0], used);
+    used = 0;
+  }
+}
+
+int TupleFormatter::decodeInt(const char* data) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<std::int32_t>(
+      (static_cast<std::uint32_t>(bytes[0]) << 24) |
+      (static_cast<std::uint32_t>(bytes[1]) << 16) |
+      (static_cast<std::uint32_t>(bytes[2]) << 8) |
+      static_cast<std::uint32_t>(bytes[3]));
+}
+
+void DelimitedTupleFormatter::format(const std::string& tuple,
+                                     const TableSchema& schema,
+                                     OutputBuffer& out) const {
+  const char* data = tuple.data();
+  const std::size_t size = tuple.size();
+  std::size_t current_index = 0;
+  out.append(prefix);
+  for (int i = 0; i < schema.getAttrCount(); ++i) {
+    if (i > 0) {
+      out.append(separator);
+    }
+    switch (schema.getAttrType(i)) {
+      case INT: {
+        if (current_index + 4 <= size) {
+          out.appendInt(decodeInt(data + current_index));
+        }
+        current_index += 4;
+        break;
+      }
+      case CHAR: {
+        std::size_t max_len = schema.getAttrMaxSize(i);
+        if (current_index < size) {
+          appendString(data + current_index,
+                       std::min(max_len, size - current_index), out);
+        }
+        current_index += max_len;
+        current_index += (4 - (max_len % 4)) % 4;  // align to the multiple of 4
+        break;
+      }
+      case VARCHAR: {
+        std::size_t actual_len = 0;
+        if (current_index < size) {
+          actual_len = static_cast<unsigned char>(data[current_index]);
+        }
+        current_index++;
+        if (current_index < size) {
+          appendString(data + current_index,
+                       std::min(actual_len, size - current_index), out);
+        }
+        current_index += actual_len;
+        current_index +=
+            (4 - ((actual_len + 1) % 4)) % 4;  // align to the multiple of 4
+        break;
+      }
+    }
+  }
+  out.append(suffix);
+}
+
+void DelimitedTupleFormatter::appendString(const char* data,
+                                           std::size_t length,
+                                           OutputBuffer& out) const {
+  if (escaping == ESCAPE_BACKSLASH) {
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+      char escaped;
+      switch (data[i]) {
+        case '\\': escaped = '\\'; break;
+        case '\t': escaped = 't'; break;
+        case '\n': escaped = 'n'; break;
+        case '\r': escaped = 'r'; break;
+        default:
+          if (data[i] != separator) {
+            continue;
+          }
+          escaped = separator;
+      }
+      out.append(data + start, i - start);
+      out.append('\\');
+      out.append(escaped);
+      start = i + 1;
+    }
+    out.append(data + start, length - start);
+    return;
+  }
+  bool needs_quote = false;
+  if (escaping == ESCAPE_QUOTE) {
+    for (std::size_t i = 0; i < length; ++i) {
+      if (data[i] == separator || data[i] == '"' || data[i] == '\n' ||
+          data[i] == '\r') {
+        needs_quote = true;
+        break;
+      }
+    }
+  }
+  if (!needs_quote) {
+    out.append(data, length);
+    return;
+  }
+  out.append('"');
+  for (std::size_t i = 0; i < length; ++i) {
+    if (data[i] == '"') {
+      out.append('"');  // quotes are escaped by doubling them
+    }
+    out.append(data[i]);
+  }
+  out.append('"');
+}
+
+void CsvTupleFormatter::begin(const TableSchema& schema,
+                              OutputBuffer& out) const {
+  if (!header) {
+    return;
+  }
+  for (int i = 0; i < schema.getAttrCount(); ++i) {
+    if (i > 0) {
+      out.append(separator);
+    }
+    const std::string& name = schema.getAttrName(i);
+    appendString(name.data(), name.size(), out);
+  }
+  out.append('\n');
+}
+
+void BinaryTupleFormatter::format(const std::string& tuple,
+                                  const TableSchema& /* schema */,
+                                  OutputBuffer& out) const {
+  const std::uint32_t length = static_cast<std::uint32_t>(tuple.size());
+  out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+  out.append(tuple);
+}
+
+}  // namespace badgerdb
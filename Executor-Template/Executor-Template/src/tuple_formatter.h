@@ -0,0 +1,264 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "schema.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Buffered writer over any output stream (stdout, a file stream or a
+ * string stream).  Output is collected in a large buffer and handed to the
+ * stream in big blocks, so writing a row never flushes the stream.
+ *
+ * @warning This class is not threadsafe.
+ */
+class OutputBuffer {
+ public:
+  /**
+   * Default buffer size in bytes.
+   */
+  static const std::size_t DEFAULT_SIZE = 1 << 20;
+
+  /**
+   * Constructs a buffer writing to the given stream.
+   *
+   * @param out   Stream receiving the output.
+   * @param size  Buffer size in bytes.
+   */
+  explicit OutputBuffer(std::ostream& out,
+                        const std::size_t size = DEFAULT_SIZE);
+
+  /**
+   * Destructor that writes out any buffered data.
+   */
+  ~OutputBuffer();
+
+  OutputBuffer(const OutputBuffer&) = delete;
+  OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+  /**
+   * Appends bytes to the buffer.
+   */
+  void append(const char* data, const std::size_t length) {
+    if (used + length > buffer.size()) {
+      appendSlow(data, length);
+      return;
+    }
+    std::char_traits<char>::copy(&buffer[used], data, length);
+    used += length;
+  }
+
+  /**
+   * Appends a single byte to the buffer.
+   */
+  void append(const char c) {
+    if (used == buffer.size()) {
+      drain();
+    }
+    buffer[used++] = c;
+  }
+
+  /**
+   * Appends a string to the buffer.
+   */
+  void append(const std::string& data) { append(data.data(), data.size()); }
+
+  /**
+   * Appends the decimal representation of an integer to the buffer.
+   */
+  void appendInt(int value);
+
+  /**
+   * Writes buffered data to the stream and flushes the stream.
+   */
+  void flush();
+
+ private:
+  /**
+   * Appends data which does not fit in the remaining space.
+   */
+  void appendSlow(const char* data, const std::size_t length);
+
+  /**
+   * Writes buffered data to the stream without flushing it.
+   */
+  void drain();
+
+  /**
+   * Stream receiving the output.
+   */
+  std::ostream& out;
+
+  /**
+   * Buffered bytes.
+   */
+  std::vector<char> buffer;
+
+  /**
+   * Number of bytes in use in the buffer.
+   */
+  std::size_t used;
+};
+
+/**
+ * @brief Converts stored tuples into an output representation.
+ */
+class TupleFormatter {
+ public:
+  virtual ~TupleFormatter() {}
+
+  /**
+   * Writes whatever precedes the first tuple (such as a header row).
+   *
+   * @param schema  Schema of the tuples.
+   * @param out     Output buffer.
+   */
+  virtual void begin(const TableSchema& /* schema */,
+                     OutputBuffer& /* out */) const {}
+
+  /**
+   * Writes one tuple.
+   *
+   * @param tuple   Tuple as stored in the heap file.
+   * @param schema  Schema of the tuple.
+   * @param out     Output buffer.
+   */
+  virtual void format(const std::string& tuple,
+                      const TableSchema& schema,
+                      OutputBuffer& out) const = 0;
+
+  /**
+   * Decodes a 4-byte INT attribute as stored by
+   * HeapFileManager::createTupleFromSQLStatement (most significant byte
+   * first).
+   */
+  static int decodeInt(const char* data);
+};
+
+/**
+ * @brief Writes each tuple as one line of attribute values separated by a
+ * delimiter, optionally enclosed in a prefix and suffix.
+ */
+class DelimitedTupleFormatter : public TupleFormatter {
+ public:
+  /**
+   * How CHAR and VARCHAR values are kept from being read as separators or
+   * line breaks.
+   */
+  enum Escaping {
+    /**
+     * Written as they are
+     */
+    ESCAPE_NONE,
+
+    /**
+     * Enclosed in quotes if they contain the separator, quotes or line
+     * breaks, with quotes doubled (CSV style)
+     */
+    ESCAPE_QUOTE,
+
+    /**
+     * Tab, line feed, carriage return, backslash and the separator written
+     * as a backslash followed by t, n, r, a backslash and the separator
+     * (TSV style)
+     */
+    ESCAPE_BACKSLASH
+  };
+
+  /**
+   * Constructor
+   *
+   * @param prefix     Written before the first value of a tuple.
+   * @param separator  Written between two values.
+   * @param suffix     Written after the last value of a tuple.
+   * @param escaping   How CHAR and VARCHAR values are escaped.
+   */
+  DelimitedTupleFormatter(const std::string& prefix,
+                          char separator,
+                          const std::string& suffix,
+                          Escaping escaping)
+      : prefix(prefix),
+        separator(separator),
+        suffix(suffix),
+        escaping(escaping) {
+    // nothing
+  }
+
+  void format(const std::string& tuple,
+              const TableSchema& schema,
+              OutputBuffer& out) const;
+
+ protected:
+  /**
+   * Writes a string value, escaped as required.
+   */
+  void appendString(const char* data, std::size_t length, OutputBuffer& out)
+      const;
+
+  std::string prefix;
+  char separator;
+  std::string suffix;
+  Escaping escaping;
+};
+
+/**
+ * @brief Writes tuples as "(v1,v2,...)" lines, the format of
+ * TableScanner::print().
+ */
+class TextTupleFormatter : public DelimitedTupleFormatter {
+ public:
+  TextTupleFormatter() : DelimitedTupleFormatter("(", ',', ")\n", ESCAPE_NONE) {}
+};
+
+/**
+ * @brief Writes tuples as comma-separated values.
+ */
+class CsvTupleFormatter : public DelimitedTupleFormatter {
+ public:
+  /**
+   * Constructor
+   *
+   * @param header  Write a row with the attribute names first.
+   */
+  explicit CsvTupleFormatter(bool header = false)
+      : DelimitedTupleFormatter("", ',', "\n", ESCAPE_QUOTE), header(header) {}
+
+  void begin(const TableSchema& schema, OutputBuffer& out) const;
+
+ private:
+  bool header;
+};
+
+/**
+ * @brief Writes tuples as tab-separated values; tabs, line breaks and
+ * backslashes inside values are escaped with a backslash.
+ */
+class TsvTupleFormatter : public DelimitedTupleFormatter {
+ public:
+  TsvTupleFormatter()
+      : DelimitedTupleFormatter("", '\t', "\n", ESCAPE_BACKSLASH) {}
+};
+
+/**
+ * @brief Writes the stored bytes of each tuple preceded by their length as a
+ * 4-byte integer in host byte order.
+ */
+class BinaryTupleFormatter : public TupleFormatter {
+ public:
+  void format(const std::string& tuple,
+              const TableSchema& schema,
+              OutputBuffer& out) const;
+};
+
+}  // namespace badgerdb